@@ -0,0 +1,48 @@
+#!/bin/sh
+# Replays noise through audio thread loop of rostik_sound on CPU backend with default --ce-async;
+# fails unless every file is processed to its end, stereo pair and microphone array alike
+
+sound=${ROSTIK_SOUND:-./rostik_sound}
+
+dir=$(mktemp -d) || exit 99
+trap 'rm -rf "$dir"' EXIT
+
+# channels geometry
+for setup in "2 -" "4 circle:50"; do
+  set -- $setup
+  channels=$1
+  geometry=$2
+
+  # one second at 44.1 kHz, s16le
+  head -c $((44100 * channels * 2)) /dev/urandom > "$dir/noise.raw" || exit 99
+
+  set -- --headless --ce-backend cpu --capture-thread 0 \
+         --audio-source raw --audio-file "$dir/noise.raw" --audio-pace fast \
+         --alsa-channels "$channels" \
+         --rc-fifo-in "$dir/in.fifo" --rc-fifo-out "$dir/out.fifo" --rc-socket "$dir/rc.sock"
+  [ "$geometry" = "-" ] || set -- "$@" --mic-geometry "$geometry"
+
+  "$sound" "$@" > "$dir/log" 2>&1 &
+  pid=$!
+  ( sleep 60; kill $pid 2>/dev/null ) &
+  watchdog=$!
+
+  # nothing is captured until frame size is set, like the controlling app does on start
+  tries=0
+  while [ ! -p "$dir/in.fifo" ] && [ $tries -lt 50 ] && kill -0 $pid 2>/dev/null; do
+    sleep 1
+    tries=$((tries + 1))
+  done
+  [ -p "$dir/in.fifo" ] && printf 'micdist 100\nnumsamples 2048\n' > "$dir/in.fifo"
+
+  wait $pid
+  res=$?
+  kill $watchdog 2>/dev/null
+  cat "$dir/log"
+
+  [ $res -eq 0 ] || exit 1
+  grep -q 'Audio file is over' "$dir/log" || exit 1
+  grep -q 'threadAudioSelectLoop() failed' "$dir/log" && exit 1
+done
+
+exit 0
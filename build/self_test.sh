@@ -0,0 +1,9 @@
+#!/bin/sh
+# Kernel self-test of rostik_bench; fails unless every kernel matches plain C reference bit for bit
+
+bench=${ROSTIK_BENCH:-./rostik_bench}
+
+result=$("$bench" --self-test) || { echo "$result"; exit 1; }
+echo "$result"
+
+echo "$result" | grep -q '"mismatches": 0,' || exit 1
@@ -0,0 +1,56 @@
+#ifndef TRIK_V4L2_DSP_FB_INTERNAL_AUDIO_SOURCE_H_
+#define TRIK_V4L2_DSP_FB_INTERNAL_AUDIO_SOURCE_H_
+
+#include <stdbool.h>
+
+#include "internal/common.h"
+#include "internal/module_alsa.h"
+#include "internal/module_file.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+
+typedef enum AudioSourceKind
+{
+  AUDIO_SOURCE_ALSA = 0,
+  AUDIO_SOURCE_WAV,
+  AUDIO_SOURCE_RAW  // headerless S16_LE in AlsaConfig rate and channels
+} AudioSourceKind;
+
+typedef struct AudioSourceConfig // what user wants to set
+{
+  AudioSourceKind m_kind;
+  const char*     m_filePath;
+  bool            m_fileRealtime;
+  bool            m_fileLoop;
+} AudioSourceConfig;
+
+/*
+ * Capture threads read frames through this, so recorded input replays through
+ * the same pipeline as live ALSA capture. Format always comes from AlsaConfig.
+ */
+typedef struct AudioSource
+{
+  AudioSourceKind m_kind;
+  bool            m_opened;
+  AlsaInput       m_alsa;
+  FileInput       m_file;
+} AudioSource;
+
+
+int audioSourceOpen(AudioSource* _src, const AudioSourceConfig* _config, const AlsaConfig* _alsaConfig);
+int audioSourceClose(AudioSource* _src);
+int audioSourceStart(AudioSource* _src);
+int audioSourceStop(AudioSource* _src);
+
+int audioSourceGetFrameSize(const AudioSource* _src, size_t* _frameSize);
+int audioSourceReadFrames(AudioSource* _src, void* _dstPtr, size_t _frames); // ENODATA once file is over
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // !TRIK_V4L2_DSP_FB_INTERNAL_AUDIO_SOURCE_H_
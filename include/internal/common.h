@@ -18,12 +18,32 @@ typedef struct ImageDescription
   uint32_t m_format;
 } ImageDescription;
 
+typedef struct AudioDescription
+{
+  unsigned int m_rate;
+  unsigned int m_channels;
+} AudioDescription;
+
+#define TARGET_CHANNELS_MAX 8
+
+typedef enum TargetDetectAlgorithm
+{
+  TARGET_DETECT_ALGORITHM_XCORR = 0,
+  TARGET_DETECT_ALGORITHM_GCC_PHAT
+} TargetDetectAlgorithm;
+
 typedef struct TargetDetectParams
 {
 	unsigned int m_volumeCoefficient;
 	unsigned int m_micDistance;
 	unsigned int m_windowSize;
 	unsigned int m_numSamples;
+	unsigned int m_hopSize;
+	TargetDetectAlgorithm m_algorithm;
+	unsigned int m_gateThreshold;  // dB above noise floor to localize, 0 - every frame is localized
+	unsigned int m_gateHysteresis; // dB below threshold to stop localizing
+	unsigned int m_trackGain;      // bearing tracker gain in percent, 0 - no tracking
+	unsigned int m_trackConfidence; // percent, less confident frames are not trusted by tracker
 } TargetDetectParams;
 
 typedef struct TargetDetectCommand
@@ -36,6 +56,11 @@ typedef struct TargetLocation
 	int m_targetAngle;
 	unsigned int m_targetLeftVolume;
 	unsigned int m_targetRightVolume;
+	unsigned int m_confidence;   // percent, 0 if backend does not estimate it
+	uint64_t     m_timestampNs;  // CLOCK_MONOTONIC when frame capture was completed
+	bool         m_gated;        // too quiet, no target searched for; volumes are RMS based
+	unsigned int m_channels;     // number of valid m_channelVolume entries, first two are left and right volume
+	unsigned int m_channelVolume[TARGET_CHANNELS_MAX];
 } TargetLocation;
 
 
@@ -0,0 +1,69 @@
+#ifndef TRIK_V4L2_DSP_FB_INTERNAL_MIC_ARRAY_H_
+#define TRIK_V4L2_DSP_FB_INTERNAL_MIC_ARRAY_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "internal/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+
+#define MIC_ARRAY_PAIRS_MAX (TARGET_CHANNELS_MAX * (TARGET_CHANNELS_MAX - 1) / 2)
+
+/*
+ * Microphone positions in millimeters, x to the right and y forward, one per input channel.
+ * Empty geometry means classic stereo pair, spaced by micDistance of detect params.
+ */
+typedef struct MicArrayGeometry
+{
+  size_t m_count; // 0 - stereo pair
+  int    m_x[TARGET_CHANNELS_MAX];
+  int    m_y[TARGET_CHANNELS_MAX];
+} MicArrayGeometry;
+
+typedef struct MicArrayPair
+{
+  size_t m_first;
+  size_t m_second;
+  size_t m_maxLag;  // samples
+  double m_delayX;  // second channel delay in samples is delayX*ux + delayY*uy for unit direction u
+  double m_delayY;
+} MicArrayPair;
+
+/*
+ * Every microphone pair is correlated, and bearing is the direction whose far field delays
+ * fit measured pair delays best in least squares sense. Collinear arrays (stereo included)
+ * only resolve angle to their axis, such bearing is reported in front half-plane.
+ */
+typedef struct MicArray
+{
+  size_t       m_channels;
+  size_t       m_pairCount;
+  MicArrayPair m_pairs[MIC_ARRAY_PAIRS_MAX];
+  size_t       m_maxLag; // over all pairs
+  bool         m_planar;
+  double       m_axisX;  // unit vector along collinear array
+  double       m_axisY;
+} MicArray;
+
+
+// "x,y;x,y;..." in millimeters, or "circle:<radius>" with microphone 0 in front and the rest clockwise
+int micArrayParseGeometry(MicArrayGeometry* _geometry, const char* _spec, size_t _channels);
+
+int micArraySetup(MicArray* _array, const MicArrayGeometry* _geometry, unsigned int _micDistance, unsigned int _rate);
+
+// Degrees, 0 is forward and positive is to the right; pairs with zero weight are ignored
+int micArrayBearing(const MicArray* _array, const double* _lags, const double* _weights, int* _angle);
+
+// Lag in samples pair would measure for far field source at bearing _angle, in degrees
+double micArrayPairLag(const MicArray* _array, size_t _pair, double _angle);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // !TRIK_V4L2_DSP_FB_INTERNAL_MIC_ARRAY_H_
@@ -0,0 +1,74 @@
+#ifndef TRIK_V4L2_DSP_FB_INTERNAL_MODULE_ALSA_H_
+#define TRIK_V4L2_DSP_FB_INTERNAL_MODULE_ALSA_H_
+
+#include <stdbool.h>
+
+#include <alsa/asoundlib.h>
+
+#include "internal/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+
+typedef enum AlsaFormat
+{
+  ALSA_FORMAT_S16_LE = 0,
+  ALSA_FORMAT_S32_LE  // e.g. I2S codecs without 16-bit mode; upper half is kept
+} AlsaFormat;
+
+typedef struct AlsaConfig // what user wants to set
+{
+  const char*  m_path;
+  unsigned int m_rate;
+  unsigned int m_channels;
+  bool         m_mmap;
+  AlsaFormat   m_format;
+  size_t       m_periodFrames;   // 0 - driver default
+  unsigned int m_periods;        // 0 - driver default
+  size_t       m_availMin;       // 0 - one period
+  size_t       m_startThreshold; // 0 - driver default; first start is explicit anyway
+  bool         m_autoTune;       // probe for smallest period without xruns on start
+} AlsaConfig;
+
+/*
+ * Samples are always handed out as S16 interleaved, whatever format device captures in.
+ */
+typedef struct AlsaInput
+{
+  snd_pcm_t*         m_handle;
+  unsigned int       m_rate;
+  unsigned int       m_channels;
+  size_t             m_frameSize;
+  bool               m_mmap;
+  long long          m_xrunCounter;
+
+  AlsaFormat         m_format;
+  size_t             m_hwFrameSize;
+  size_t             m_periodFrames;
+  size_t             m_bufferFrames;
+  void*              m_convertBuffer; // rw access in non-S16 format, one period
+} AlsaInput;
+
+
+int alsaInputInit(bool _verbose);
+int alsaInputFini();
+
+int alsaInputOpen(AlsaInput* _alsa, const AlsaConfig* _config);
+int alsaInputClose(AlsaInput* _alsa);
+int alsaInputStart(AlsaInput* _alsa);
+int alsaInputStop(AlsaInput* _alsa);
+
+int alsaInputGetFrameSize(const AlsaInput* _alsa, size_t* _frameSize);
+int alsaInputReadFrames(AlsaInput* _alsa, void* _dstPtr, size_t _frames);
+
+// Closed input is opened with growing period sizes, first one captured for a while without xruns wins
+int alsaInputTunePeriod(AlsaInput* _alsa, const AlsaConfig* _config, size_t* _periodFrames);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // !TRIK_V4L2_DSP_FB_INTERNAL_MODULE_ALSA_H_
@@ -10,28 +10,62 @@
 #include <ti/sdo/ce/vidtranscode/vidtranscode.h>
 
 #include "internal/common.h"
+#include "internal/module_ce_cpu.h"
+#include "internal/stats.h"
+#include "internal/thread_attr.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif // __cplusplus
 
 
+// Codec allows single outstanding call, so one frame is processed while next one is captured
+#define CODEC_ENGINE_PIPELINE_MAX 2
+
+typedef enum CodecEngineBackend
+{
+  CODEC_ENGINE_BACKEND_AUTO = 0, // DSP with fallback to CPU; for opened engine - not opened yet
+  CODEC_ENGINE_BACKEND_DSP,
+  CODEC_ENGINE_BACKEND_CPU
+} CodecEngineBackend;
+
 typedef struct CodecEngineConfig // what user wants to set
 {
-  const char* m_serverPath;
-  const char* m_codecName;
+  const char*        m_serverPath;
+  const char*        m_codecName;
+  bool               m_async;
+  CodecEngineBackend m_backend;
+  const char*        m_micGeometry; // CPU backend only, NULL for stereo pair
+  unsigned int       m_workers;     // CPU backend only, 0 - one per online CPU
+  ThreadAttrConfig   m_workerThreadAttr; // CPU backend only, applies to every pool thread
 } CodecEngineConfig;
 
+struct CodecEngineFrame;
+
 typedef struct CodecEngine
 {
+  CodecEngineBackend m_backend;
   Engine_Handle m_handle;
+  CPUEngine     m_cpu;
 
   Memory_AllocParams m_allocParams;
   size_t     m_srcBufferSize;
-  void*      m_srcBuffer;
+  void*      m_srcBuffers[CODEC_ENGINE_PIPELINE_MAX];
+  size_t     m_srcDataSizes[CODEC_ENGINE_PIPELINE_MAX];
 
   size_t     m_dstBufferSize;
-  void*      m_dstBuffer;
+  void*      m_dstBuffers[CODEC_ENGINE_PIPELINE_MAX];
+
+  size_t                   m_pipelineDepth;
+  struct CodecEngineFrame* m_frames;
+  size_t                   m_frameNext;
+  size_t                   m_framePendingIndex;
+  bool                     m_framePending;
+
+  unsigned long long       m_cacheFrames;
+  unsigned long long       m_cacheWbInvBytes;
+  unsigned long long       m_cacheInvBytes;
+  LatencyStats*            m_stats; // optional, set by owner
 
   VIDTRANSCODE_Handle m_vidtranscodeHandle;
 
@@ -48,9 +82,27 @@ int codecEngineOpen(CodecEngine* _ce, const CodecEngineConfig* _config);
 int codecEngineClose(CodecEngine* _ce);
 int codecEngineStart(CodecEngine* _ce, const CodecEngineConfig* _config,
                      const ImageDescription* _srcImageDesc,
-                     const ImageDescription* _dstImageDesc);
+                     const ImageDescription* _dstImageDesc,
+                     const AudioDescription* _srcAudioDesc);
 int codecEngineStop(CodecEngine* _ce);
 
+int codecEngineGetSrcBuffer(CodecEngine* _ce, void** _srcBufferPtr, size_t* _srcBufferSize);
+// Data captured into src buffer is dropped without submitting; keeps track of what next frame has to flush
+int codecEngineDiscardSrcBuffer(CodecEngine* _ce, size_t _srcDataSize);
+
+int codecEngineSubmitFrame(CodecEngine* _ce,
+                           const void* _srcFramePtr, size_t _srcFrameSize, size_t _srcDataSize,
+                           size_t _dstFrameSize,
+                           const TargetDetectParams* _targetDetectParams,
+                           const TargetDetectCommand* _targetDetectCommand);
+int codecEngineCompleteFrame(CodecEngine* _ce,
+                             void* _dstFramePtr, size_t _dstFrameSize, size_t* _dstFrameUsed,
+                             TargetLocation* _targetLocation,
+                             TargetDetectParams* _targetDetectParamsResult);
+bool codecEngineFramePending(const CodecEngine* _ce);
+// Pipeline of started engine overlaps frames; CPU backend and sync DSP are never async whatever config says
+bool codecEngineIsAsync(const CodecEngine* _ce);
+
 int codecEngineTranscodeFrame(CodecEngine* _ce,
                               const void* _srcFramePtr, size_t _srcFrameSize,
                               void* _dstFramePtr, size_t _dstFrameSize, size_t* _dstFrameUsed,
@@ -60,7 +112,7 @@ int codecEngineTranscodeFrame(CodecEngine* _ce,
                               TargetDetectParams* _targetDetectParamsResult);
 
 
-int codecEngineReportLoad(const CodecEngine* _ce, long long _ms);
+int codecEngineReportLoad(CodecEngine* _ce, long long _ms);
 
 
 #ifdef __cplusplus
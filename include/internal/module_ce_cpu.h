@@ -0,0 +1,100 @@
+#ifndef TRIK_V4L2_DSP_FB_INTERNAL_MODULE_CE_CPU_H_
+#define TRIK_V4L2_DSP_FB_INTERNAL_MODULE_CE_CPU_H_
+
+#include <stdbool.h>
+
+#include "internal/common.h"
+#include "internal/mic_array.h"
+#include "internal/sound_fft.h"
+#include "internal/target_tracker.h"
+#include "internal/worker_pool.h"
+#include "internal/xcorr_kernels.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+
+// Pair correlation is split into at most this many tasks
+#define CPU_ENGINE_PARTS_MAX WORKER_POOL_SIZE_MAX
+#define CPU_ENGINE_TASKS_MAX (MIC_ARRAY_PAIRS_MAX * CPU_ENGINE_PARTS_MAX)
+
+// While bearing is tracked, only lags this close to predicted pair delay are searched
+#define CPU_ENGINE_TRACK_LAG_RADIUS 3
+
+// FFT buffers of single worker
+typedef struct CPUEngineScratch
+{
+  SoundFFT           m_fft; // GCC-PHAT only, sized for current window
+  float*             m_fftRe;
+  float*             m_fftIm;
+} CPUEngineScratch;
+
+/*
+ * Host implementation of sound localization, used by CodecEngine when DSP backend is not available.
+ * Input is S16 interleaved, stereo as fed to DSP or any microphone array up to TARGET_CHANNELS_MAX.
+ * Every microphone pair is split into parts, by lag range for time domain correlation and by window
+ * for GCC-PHAT, so that even single stereo pair keeps all workers busy. Partial correlations are
+ * summed per pair after workers are done.
+ * With tracking enabled, peak is searched only around delays predicted from tracked bearing,
+ * time domain correlation skips the other lags. Full search is repeated in the same frame
+ * when narrow one is not confident or its peak sits on the range boundary.
+ */
+typedef struct CPUEngine
+{
+  AudioDescription   m_audioDesc;
+  MicArrayGeometry   m_geometry;
+  MicArray           m_array;
+  unsigned int       m_arrayMicDistance; // stereo pair spacing m_array was set up for
+
+  size_t             m_capacity; // frames
+  int16_t*           m_channelData[TARGET_CHANNELS_MAX];
+
+  XCorrKernel        m_xcorrKernel; // time domain correlation for current window size and array
+  TargetTracker      m_tracker;
+
+  WorkerPool         m_pool;
+  CPUEngineScratch   m_scratch[WORKER_POOL_SIZE_MAX];
+
+  // current frame, shared with workers
+  const TargetDetectParams* m_frameParams;
+  size_t             m_frameFrames;
+  size_t             m_frameWindow;
+  size_t             m_frameParts; // tasks per pair
+  double*            m_partXcorr;  // per task, lags -maxLag..maxLag of widest pair
+  size_t             m_partXcorrSize;
+  double             m_partNorm[CPU_ENGINE_TASKS_MAX];
+  size_t             m_pairSearchBegin[MIC_ARRAY_PAIRS_MAX]; // lag indices 0..2*maxLag of pair searched for peak
+  size_t             m_pairSearchEnd[MIC_ARRAY_PAIRS_MAX];
+  size_t             m_frameSearchWidth; // over all pairs
+  bool               m_pairPeakOnEdge[MIC_ARRAY_PAIRS_MAX]; // true delay may lie outside narrowed range
+  double             m_pairLag[MIC_ARRAY_PAIRS_MAX];
+  double             m_pairConfidence[MIC_ARRAY_PAIRS_MAX];
+  double             m_pairWeight[MIC_ARRAY_PAIRS_MAX]; // 0 - pair is too wide for window
+
+  long long          m_processedFrames;
+  long long          m_processedNs;
+  long long          m_narrowFrames; // localized by narrow search alone
+  long long          m_fullFrames;
+} CPUEngine;
+
+
+// _micGeometry is parsed by micArrayParseGeometry(), NULL for stereo pair; 0 _workers - one per online CPU;
+// NULL _workerThreadAttr - pool threads inherit caller scheduling
+int cpuEngineOpen(CPUEngine* _cpu, const AudioDescription* _audioDesc, size_t _capacityFrames, const char* _micGeometry,
+                  size_t _workers, const ThreadAttrConfig* _workerThreadAttr);
+int cpuEngineClose(CPUEngine* _cpu);
+
+int cpuEngineProcess(CPUEngine* _cpu,
+                     const void* _srcPtr, size_t _srcDataSize,
+                     const TargetDetectParams* _targetDetectParams,
+                     TargetLocation* _targetLocation);
+
+int cpuEngineReportLoad(CPUEngine* _cpu, long long _ms);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // !TRIK_V4L2_DSP_FB_INTERNAL_MODULE_CE_CPU_H_
@@ -0,0 +1,60 @@
+#ifndef TRIK_V4L2_DSP_FB_INTERNAL_MODULE_FILE_H_
+#define TRIK_V4L2_DSP_FB_INTERNAL_MODULE_FILE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "internal/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+
+typedef struct FileInputConfig
+{
+  const char*  m_path;
+  bool         m_raw;      // headerless S16_LE, otherwise WAV
+  bool         m_realtime; // paced by sample rate, otherwise as fast as consumer reads
+  bool         m_loop;
+  unsigned int m_rate;     // format expected by pipeline; WAV must match, raw is assumed to
+  unsigned int m_channels;
+} FileInputConfig;
+
+/*
+ * Replay of recorded S16_LE samples in place of ALSA capture.
+ * Without loop reading past the end fails with ENODATA.
+ */
+typedef struct FileInput
+{
+  int                m_fd;
+  unsigned int       m_rate;
+  unsigned int       m_channels;
+  size_t             m_frameSize;
+  off_t              m_dataOffset;
+  off_t              m_dataSize;
+  off_t              m_dataPos;
+  bool               m_realtime;
+  bool               m_loop;
+
+  struct timespec    m_startTime;
+  unsigned long long m_framesRead;
+} FileInput;
+
+
+int fileInputOpen(FileInput* _file, const FileInputConfig* _config);
+int fileInputClose(FileInput* _file);
+int fileInputStart(FileInput* _file);
+int fileInputStop(FileInput* _file);
+
+int fileInputGetFrameSize(const FileInput* _file, size_t* _frameSize);
+int fileInputReadFrames(FileInput* _file, void* _dstPtr, size_t _frames);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // !TRIK_V4L2_DSP_FB_INTERNAL_MODULE_FILE_H_
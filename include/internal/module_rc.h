@@ -4,17 +4,28 @@
 #include <stdbool.h>
 
 #include "internal/common.h"
+#include "internal/result_queue.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif // __cplusplus
 
 
+// Binary records are written in batches not exceeding PIPE_BUF, so each batch is atomic
+#define RC_OUTPUT_BATCH_MAX 16
+
 typedef struct RCConfig // what user wants to set
 {
   const char* m_fifoInput;
   const char* m_fifoOutput;
   bool m_videoOutEnable;
+  unsigned int m_hopSize;
+  TargetDetectAlgorithm m_algorithm;
+  bool m_outputBinary;
+  unsigned int m_gateThreshold;
+  unsigned int m_gateHysteresis;
+  unsigned int m_trackGain;
+  unsigned int m_trackConfidence;
 } RCConfig;
 
 typedef struct RCInput
@@ -27,6 +38,7 @@ typedef struct RCInput
 
   int                      m_fifoOutputFd;
   char*                    m_fifoOutputName;
+  bool                     m_fifoOutputBinary;
 
   bool                     m_targetDetectParamsUpdated;
 
@@ -34,12 +46,20 @@ typedef struct RCInput
   unsigned int				m_micDistance;
   unsigned int				m_windowSize;
   unsigned int				m_numSamples;
+  unsigned int				m_hopSize;
+  TargetDetectAlgorithm			m_algorithm;
+  unsigned int				m_gateThreshold;
+  unsigned int				m_gateHysteresis;
+  unsigned int				m_trackGain;
+  unsigned int				m_trackConfidence;
 
   bool                     m_targetDetectCommandUpdated;
   int                      m_targetDetectCommand;
 
   bool                     m_videoOutParamsUpdated;
   bool                     m_videoOutEnable;
+
+  bool                     m_statsRequested;
 } RCInput;
 
 
@@ -54,14 +74,24 @@ int rcInputStart(RCInput* _rc);
 int rcInputStop(RCInput* _rc);
 
 int rcInputReadFifoInput(RCInput* _rc);
+int rcInputParseCommand(RCInput* _rc, char* _line);
 
 int rcInputGetTargetDetectParams(RCInput* _rc, TargetDetectParams* _targetDetectParams);
 int rcInputGetTargetDetectCommand(RCInput* _rc, TargetDetectCommand* _targetDetectCommand);
 
 int rcInputGetVideoOutParams(RCInput* _rc, bool *_videoOutEnable);
+int rcInputGetStatsRequest(RCInput* _rc);
+
+/*
+ * Output fifo is opened, written and closed by publish thread only; input thread works with
+ * the rest of RCInput.
+ */
+int rcInputOpenOutput(RCInput* _rc, const RCConfig* _config);
+int rcInputCloseOutput(RCInput* _rc);
 
 int rcInputUnsafeReportTargetLocation(RCInput* _rc, const TargetLocation* _targetLocation);
 int rcInputUnsafeReportTargetDetectParams(RCInput* _rc, const TargetDetectParams* _targetDetectParams);
+int rcInputUnsafeReportResults(RCInput* _rc, const ResultRecord* _records, size_t _count);
 
 #ifdef __cplusplus
 } // extern "C"
@@ -0,0 +1,76 @@
+#ifndef TRIK_V4L2_DSP_FB_INTERNAL_MODULE_RC_SERVER_H_
+#define TRIK_V4L2_DSP_FB_INTERNAL_MODULE_RC_SERVER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "internal/common.h"
+#include "internal/module_rc.h"
+#include "internal/result_queue.h"
+#include "internal/stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+
+#define RC_SERVER_CLIENTS_MAX		8
+#define RC_SERVER_READ_BUFFER_SIZE	1000
+#define RC_SERVER_SEND_BUFFER_SIZE	4096
+
+typedef struct RCServerConfig // what user wants to set
+{
+  const char* m_socketPath; // NULL disables socket, input fifo is still served
+} RCServerConfig;
+
+typedef struct RCServerClient
+{
+  int                m_fd;
+  bool               m_subscribed;
+  bool               m_binary;
+  bool               m_sendPending; // waiting for EPOLLOUT
+
+  char               m_readBuffer[RC_SERVER_READ_BUFFER_SIZE];
+  size_t             m_readBufferUsed;
+  char               m_sendBuffer[RC_SERVER_SEND_BUFFER_SIZE];
+  size_t             m_sendBufferUsed;
+
+  unsigned long long m_dropCounter;
+} RCServerClient;
+
+/*
+ * Unix socket endpoint for control commands and results, plus epoll loop of input thread.
+ * Any client may send the same text commands as input fifo; 'subscribe [text|binary]' starts
+ * results delivery and 'unsubscribe' stops it. Results come from publisher thread and go to
+ * bounded per-client send buffers; what does not fit is dropped for that client only.
+ * Poll blocks until there is input or wakeup fd becomes readable; wakeup fd is never read here.
+ * 'stats' is answered to the asking client when latency stats are attached.
+ */
+typedef struct RCServer
+{
+  int             m_epollFd;
+  int             m_listenFd;
+  char*           m_socketPath;
+  int             m_watchedFifoFd;
+  int             m_wakeupFd;
+  LatencyStats*   m_stats; // optional, set by owner
+
+  pthread_mutex_t m_mutex; // guards clients against publisher thread
+  RCServerClient  m_clients[RC_SERVER_CLIENTS_MAX];
+} RCServer;
+
+
+int rcServerOpen(RCServer* _server, const RCServerConfig* _config);
+int rcServerClose(RCServer* _server);
+
+int rcServerAddWakeup(RCServer* _server, int _fd);
+int rcServerPoll(RCServer* _server, RCInput* _rc, int _timeoutMs);
+int rcServerReportResults(RCServer* _server, const ResultRecord* _records, size_t _count);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // !TRIK_V4L2_DSP_FB_INTERNAL_MODULE_RC_SERVER_H_
@@ -0,0 +1,55 @@
+#ifndef TRIK_V4L2_DSP_FB_INTERNAL_PCM_RING_H_
+#define TRIK_V4L2_DSP_FB_INTERNAL_PCM_RING_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <semaphore.h>
+
+#include "internal/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+
+/*
+ * Single-producer/single-consumer ring of fixed-size PCM periods.
+ * Head is advanced by producer only, tail by consumer only; data path is lock-free.
+ * Semaphore is used only to let consumer sleep while ring is empty.
+ */
+typedef struct PCMRing
+{
+  char*              m_buffer;
+  size_t             m_slotSize;
+  size_t             m_slotCount;
+
+  unsigned int       m_head;
+  unsigned int       m_tail;
+  sem_t              m_filled;
+
+  unsigned int       m_highWaterMark;
+  unsigned long long m_overrunCounter;
+} PCMRing;
+
+
+int pcmRingInit(PCMRing* _ring, size_t _slotSize, size_t _slotCount);
+int pcmRingFini(PCMRing* _ring);
+
+int pcmRingPushBegin(PCMRing* _ring, void** _slotPtr);
+int pcmRingPushCommit(PCMRing* _ring);
+int pcmRingPushOverrun(PCMRing* _ring);
+
+int pcmRingPopBegin(PCMRing* _ring, const void** _slotPtr, long _timeoutMs);
+int pcmRingPopCommit(PCMRing* _ring);
+
+int pcmRingWakeup(PCMRing* _ring);
+
+int pcmRingGetSlotSize(const PCMRing* _ring, size_t* _slotSize);
+int pcmRingReportStats(PCMRing* _ring);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // !TRIK_V4L2_DSP_FB_INTERNAL_PCM_RING_H_
@@ -0,0 +1,80 @@
+#ifndef TRIK_V4L2_DSP_FB_INTERNAL_RESULT_QUEUE_H_
+#define TRIK_V4L2_DSP_FB_INTERNAL_RESULT_QUEUE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <semaphore.h>
+
+#include "sound_sensor_result.h"
+#include "internal/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+
+typedef enum ResultKind
+{
+  RESULT_KIND_TARGET_LOCATION = 0,
+  RESULT_KIND_TARGET_DETECT_PARAMS
+} ResultKind;
+
+typedef struct ResultRecord
+{
+  ResultKind         m_kind;
+  unsigned int       m_sequence; // assigned on report, so dropped results leave gaps
+  TargetLocation     m_targetLocation;
+  TargetDetectParams m_targetDetectParams;
+} ResultRecord;
+
+typedef enum ResultQueuePolicy // what happens to new result when queue is full
+{
+  RESULT_QUEUE_DROP_OLDEST = 0,
+  RESULT_QUEUE_DROP_NEWEST,
+  RESULT_QUEUE_COALESCE      // queue of single latest result
+} ResultQueuePolicy;
+
+/*
+ * Bounded single-producer/single-consumer queue of results, lock-free on both sides.
+ * To drop oldest record producer advances tail itself, so consumer claims records with CAS on tail
+ * and discards its copy if the record was dropped meanwhile.
+ * Producer never wakes consumer, so push makes no syscall; consumer sleeps for bounded time
+ * between drains, and semaphore only cuts the sleep short on resultQueueWakeup().
+ */
+typedef struct ResultQueue
+{
+  ResultRecord*      m_records;
+  size_t             m_capacity; // power of 2
+  ResultQueuePolicy  m_policy;
+
+  unsigned int       m_head;
+  unsigned int       m_tail;
+  sem_t              m_wakeup;
+
+  unsigned long long m_pushCounter;
+  unsigned long long m_dropCounter;
+} ResultQueue;
+
+
+int resultQueueInit(ResultQueue* _queue, size_t _capacity, ResultQueuePolicy _policy);
+int resultQueueFini(ResultQueue* _queue);
+
+int resultQueuePush(ResultQueue* _queue, const ResultRecord* _record);
+int resultQueuePop(ResultQueue* _queue, ResultRecord* _record);
+int resultQueueWait(ResultQueue* _queue, long _timeoutMs);
+int resultQueueWakeup(ResultQueue* _queue);
+
+int resultQueueReportStats(ResultQueue* _queue);
+
+void resultRecordPack(const ResultRecord* _record, SoundSensorResult* _packed);
+
+// Text output line: "sound: <angle> <left> <right>" or "silence: <left> <right>", volumes of channels past
+// the first two are appended; returns snprintf() result
+int  resultLocationFormat(const TargetLocation* _location, char* _text, size_t _size);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // !TRIK_V4L2_DSP_FB_INTERNAL_RESULT_QUEUE_H_
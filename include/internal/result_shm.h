@@ -0,0 +1,40 @@
+#ifndef TRIK_V4L2_DSP_FB_INTERNAL_RESULT_SHM_H_
+#define TRIK_V4L2_DSP_FB_INTERNAL_RESULT_SHM_H_
+
+#include <stdbool.h>
+
+#include "sound_sensor_shm.h"
+#include "internal/result_queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+
+typedef struct ResultShmConfig
+{
+  const char*     m_name; // NULL disables shared memory output
+} ResultShmConfig;
+
+/*
+ * Writer side of shared memory results, layout is in sound_sensor_shm.h.
+ * Publishing is plain memory stores, so it is done right from the audio thread.
+ */
+typedef struct ResultShm
+{
+  char*           m_name;
+  SoundSensorShm* m_shm;
+} ResultShm;
+
+
+int resultShmOpen(ResultShm* _shm, const ResultShmConfig* _config);
+int resultShmClose(ResultShm* _shm);
+
+int resultShmPublish(ResultShm* _shm, const ResultRecord* _record);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // !TRIK_V4L2_DSP_FB_INTERNAL_RESULT_SHM_H_
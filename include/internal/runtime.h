@@ -8,6 +8,14 @@
 #include "internal/module_fb.h"
 #include "internal/module_v4l2.h"
 #include "internal/module_rc.h"
+#include "internal/module_rc_server.h"
+#include "internal/module_alsa.h"
+#include "internal/audio_source.h"
+#include "internal/pcm_ring.h"
+#include "internal/result_queue.h"
+#include "internal/result_shm.h"
+#include "internal/stats.h"
+#include "internal/thread_attr.h"
 
 
 #ifdef __cplusplus
@@ -15,14 +23,46 @@ extern "C" {
 #endif // __cplusplus
 
 
+typedef struct CaptureConfig
+{
+  bool               m_threaded;
+  size_t             m_periodFrames;
+  size_t             m_ringPeriods;
+} CaptureConfig;
+
+typedef struct PublishConfig
+{
+  ResultQueuePolicy  m_policy;
+  size_t             m_queueSize;
+} PublishConfig;
+
+typedef enum RuntimeThreadId
+{
+  RUNTIME_THREAD_INPUT = 0,
+  RUNTIME_THREAD_AUDIO,
+  RUNTIME_THREAD_CAPTURE,
+  RUNTIME_THREAD_PUBLISH,
+  RUNTIME_THREAD_WORKER,
+  RUNTIME_THREAD_COUNT
+} RuntimeThreadId;
+
 typedef struct RuntimeConfig
 {
   bool               m_verbose;
+  bool               m_headless;
 
   CodecEngineConfig  m_codecEngineConfig;
   V4L2Config         m_v4l2Config;
   FBConfig           m_fbConfig;
   RCConfig           m_rcConfig;
+  RCServerConfig     m_rcServerConfig;
+  AlsaConfig         m_alsaConfig;
+  AudioSourceConfig  m_audioSourceConfig;
+  CaptureConfig      m_captureConfig;
+  PublishConfig      m_publishConfig;
+  ResultShmConfig    m_resultShmConfig;
+  ThreadAttrConfig   m_threadAttrConfig[RUNTIME_THREAD_COUNT];
+  bool               m_lockMemory;
 } RuntimeConfig;
 
 typedef struct RuntimeModules
@@ -31,22 +71,44 @@ typedef struct RuntimeModules
   V4L2Input    m_v4l2Input;
   FBOutput     m_fbOutput;
   RCInput      m_rcInput;
+  RCServer     m_rcServer;
+  AudioSource  m_audioSource;
+  PCMRing      m_captureRing;
+  ResultQueue  m_resultQueue;
+  ResultShm    m_resultShm;
+  LatencyStats m_stats;
 } RuntimeModules;
 
 typedef struct RuntimeThreads
 {
   volatile bool           m_terminate;
+  int                     m_terminateFd; // eventfd, never read while running so it stays readable once set
 
   pthread_t               m_inputThread;
   pthread_t               m_videoThread;
+  pthread_t               m_captureThread;
+  pthread_t               m_publishThread;
 } RuntimeThreads;
 
+// Settings audio thread picks up every frame, published as a whole
+typedef struct RuntimeSnapshot
+{
+  TargetDetectParams      m_targetDetectParams;
+  bool                    m_videoOutEnable;
+} RuntimeSnapshot;
+
+/*
+ * Snapshot is guarded by seqlock: sequence is odd while writer updates it, reader retries
+ * if sequence was odd or changed during copy. Readers never block; mutex only serializes writers.
+ * Command is consumed with atomic exchange.
+ */
 typedef struct RuntimeState
 {
   pthread_mutex_t         m_mutex;
-  TargetDetectParams      m_targetDetectParams;
+  unsigned int            m_snapshotSeq;
+  RuntimeSnapshot         m_snapshot;
   TargetDetectCommand     m_targetDetectCommand;
-  bool                    m_videoOutEnable;
+  unsigned int            m_resultSequence;
 } RuntimeState;
 
 typedef struct Runtime
@@ -70,23 +132,40 @@ int runtimeStop(Runtime* _runtime);
 
 
 bool                     runtimeCfgVerbose(const Runtime* _runtime);
+bool                     runtimeCfgHeadless(const Runtime* _runtime);
 const CodecEngineConfig* runtimeCfgCodecEngine(const Runtime* _runtime);
 const V4L2Config*        runtimeCfgV4L2Input(const Runtime* _runtime);
 const FBConfig*          runtimeCfgFBOutput(const Runtime* _runtime);
 const RCConfig*          runtimeCfgRCInput(const Runtime* _runtime);
+const RCServerConfig*    runtimeCfgRCServer(const Runtime* _runtime);
+const AlsaConfig*        runtimeCfgAlsaInput(const Runtime* _runtime);
+const AudioSourceConfig* runtimeCfgAudioSource(const Runtime* _runtime);
+const CaptureConfig*     runtimeCfgCapture(const Runtime* _runtime);
+const PublishConfig*     runtimeCfgPublish(const Runtime* _runtime);
+const ResultShmConfig*   runtimeCfgResultShm(const Runtime* _runtime);
+const ThreadAttrConfig*  runtimeCfgThreadAttr(const Runtime* _runtime, RuntimeThreadId _thread);
+bool                     runtimeCfgLockMemory(const Runtime* _runtime);
 
 CodecEngine*  runtimeModCodecEngine(Runtime* _runtime);
 V4L2Input*    runtimeModV4L2Input(Runtime* _runtime);
 FBOutput*     runtimeModFBOutput(Runtime* _runtime);
 RCInput*      runtimeModRCInput(Runtime* _runtime);
+RCServer*     runtimeModRCServer(Runtime* _runtime);
+AudioSource*  runtimeModAudioSource(Runtime* _runtime);
+PCMRing*      runtimeModCaptureRing(Runtime* _runtime);
+ResultQueue*  runtimeModResultQueue(Runtime* _runtime);
+ResultShm*    runtimeModResultShm(Runtime* _runtime);
+LatencyStats* runtimeModStats(Runtime* _runtime);
 
 
 bool runtimeGetTerminate(Runtime* _runtime);
 void runtimeSetTerminate(Runtime* _runtime);
+int  runtimeGetTerminateFd(Runtime* _runtime);
 int  runtimeGetTargetDetectParams(Runtime* _runtime, TargetDetectParams* _targetDetectParams);
 int  runtimeSetTargetDetectParams(Runtime* _runtime, const TargetDetectParams* _targetDetectParams);
 int  runtimeFetchTargetDetectCommand(Runtime* _runtime, TargetDetectCommand* _targetDetectCommand);
 int  runtimeSetTargetDetectCommand(Runtime* _runtime, const TargetDetectCommand* _targetDetectCommand);
+int  runtimeGetSnapshot(Runtime* _runtime, RuntimeSnapshot* _snapshot);
 
 int runtimeGetVideoOutParams(Runtime* _runtime, bool* _videoOutEnable);
 int runtimeSetVideoOutParams(Runtime* _runtime, const bool* _videoOutEnable);
@@ -0,0 +1,35 @@
+#ifndef TRIK_V4L2_DSP_FB_INTERNAL_SOUND_FFT_H_
+#define TRIK_V4L2_DSP_FB_INTERNAL_SOUND_FFT_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+
+/*
+ * In-place radix-2 complex FFT on split real/imaginary arrays.
+ * Twiddles and bit-reversal permutation are precomputed for a single size.
+ */
+typedef struct SoundFFT
+{
+  size_t    m_size;
+  float*    m_cos;
+  float*    m_sin;
+  unsigned* m_bitReverse;
+} SoundFFT;
+
+
+int soundFFTInit(SoundFFT* _fft, size_t _size);
+int soundFFTFini(SoundFFT* _fft);
+
+int soundFFTForward(const SoundFFT* _fft, float* _re, float* _im);
+int soundFFTInverse(const SoundFFT* _fft, float* _re, float* _im); // unscaled
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // !TRIK_V4L2_DSP_FB_INTERNAL_SOUND_FFT_H_
@@ -0,0 +1,59 @@
+#ifndef TRIK_V4L2_DSP_FB_INTERNAL_SOUND_GATE_H_
+#define TRIK_V4L2_DSP_FB_INTERNAL_SOUND_GATE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <inttypes.h>
+
+#include "internal/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+
+#define SOUND_GATE_CHANNELS_MAX  8
+#define SOUND_GATE_THRESHOLD_MAX 60 // dB; keeps fixed point comparison within 64 bits
+
+/*
+ * Energy gate in front of localization. Loudest channel mean square is compared with noise floor:
+ * gate opens when it exceeds floor by threshold and closes when it falls below threshold minus hysteresis.
+ * Floor follows the signal while gate is closed and only creeps up while it is open.
+ * Single writer (audio thread); counters may be read from elsewhere.
+ */
+typedef struct SoundGate
+{
+  unsigned int m_thresholdDb; // 0 - gate disabled, every frame passes
+  unsigned int m_hysteresisDb;
+  uint64_t     m_openRatioQ8;
+  uint64_t     m_closeRatioQ8;
+
+  uint64_t     m_noiseFloor;  // mean square, 0 until first frame
+  bool         m_open;
+
+  unsigned int m_gatedFrames;
+  unsigned int m_passedFrames;
+} SoundGate;
+
+typedef struct SoundGateLevels
+{
+  size_t       m_channels;
+  uint32_t     m_rms[SOUND_GATE_CHANNELS_MAX];
+  uint32_t     m_peak[SOUND_GATE_CHANNELS_MAX];
+} SoundGateLevels;
+
+
+void soundGateReset(SoundGate* _gate);
+void soundGateConfigure(SoundGate* _gate, unsigned int _thresholdDb, unsigned int _hysteresisDb);
+
+// True if frame should be localized
+bool soundGateUpdate(SoundGate* _gate, const int16_t* _src, size_t _frames, size_t _channels, SoundGateLevels* _levels);
+
+int  soundGateReport(const SoundGate* _gate);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // !TRIK_V4L2_DSP_FB_INTERNAL_SOUND_GATE_H_
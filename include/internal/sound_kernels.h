@@ -0,0 +1,40 @@
+#ifndef TRIK_V4L2_DSP_FB_INTERNAL_SOUND_KERNELS_H_
+#define TRIK_V4L2_DSP_FB_INTERNAL_SOUND_KERNELS_H_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+
+/*
+ * Basic signal kernels used by CPU processing path.
+ * NEON or SSE2 implementation is picked at compile time, with plain C fallback;
+ * without vector unit ARMv5TE DSP instructions are used if configure found them.
+ * All implementations give bit-exact results.
+ */
+
+const char* soundKernelsName();
+
+void     soundKernelDeinterleaveS16(const int16_t* _src, size_t _frames, int16_t* _left, int16_t* _right);
+// Any channel count up to 8; 2, 4 and 8 channels are vectorized
+void     soundKernelDeinterleaveNS16(const int16_t* _src, size_t _frames, size_t _channels, int16_t* const* _dst);
+
+int64_t  soundKernelDotS16(const int16_t* _a, const int16_t* _b, size_t _count);
+uint64_t soundKernelEnergyS16(const int16_t* _a, size_t _count);
+uint64_t soundKernelSumAbsS16(const int16_t* _a, size_t _count);
+
+// Subtracts truncated mean with saturation
+void     soundKernelRemoveDCS16(int16_t* _a, size_t _count);
+
+// Per channel sum of squares and peak magnitude of interleaved samples; stereo is vectorized
+void     soundKernelLevelsS16(const int16_t* _src, size_t _frames, size_t _channels, uint64_t* _energy, uint32_t* _peak);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // !TRIK_V4L2_DSP_FB_INTERNAL_SOUND_KERNELS_H_
@@ -0,0 +1,60 @@
+#ifndef TRIK_V4L2_DSP_FB_INTERNAL_STATS_H_
+#define TRIK_V4L2_DSP_FB_INTERNAL_STATS_H_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+
+typedef enum StatsStage
+{
+  STATS_STAGE_CAPTURE_WAIT = 0, // waiting for ALSA or capture ring
+  STATS_STAGE_PACK,             // sliding window and capture ring copies
+  STATS_STAGE_CMEM_COPY,        // copy of frame into codec buffer
+  STATS_STAGE_CACHE,            // cache write-back and invalidate
+  STATS_STAGE_PROCESS,          // VIDTRANSCODE_process, its wait when async, or CPU backend
+  STATS_STAGE_FB_COPY,          // codec output into framebuffer
+  STATS_STAGE_REPORT,           // handing result over to publisher
+  STATS_STAGE_FRAME,            // whole audio loop cycle
+  STATS_STAGE_COUNT
+} StatsStage;
+
+/*
+ * Log-linear histogram of nanoseconds: values below 8 have own buckets, every next power of 2
+ * is split into 8 linear buckets, so any value is off by 12.5% at most.
+ * Single writer (audio thread); readers may race with it and get slightly stale numbers.
+ */
+#define STATS_HISTOGRAM_SUB_BITS	3
+#define STATS_HISTOGRAM_BUCKETS		((40 - STATS_HISTOGRAM_SUB_BITS + 1) << STATS_HISTOGRAM_SUB_BITS)
+
+typedef struct StatsHistogram
+{
+  unsigned int m_buckets[STATS_HISTOGRAM_BUCKETS];
+  unsigned int m_count;
+  uint32_t     m_maxNs; // saturates at ~4s
+} StatsHistogram;
+
+typedef struct LatencyStats
+{
+  StatsHistogram m_stages[STATS_STAGE_COUNT];
+} LatencyStats;
+
+
+uint64_t statsNowNs();
+
+void     statsReset(LatencyStats* _stats);
+void     statsRecord(LatencyStats* _stats, StatsStage _stage, uint64_t _ns);
+
+size_t   statsFormat(const LatencyStats* _stats, char* _buffer, size_t _size);
+uint64_t statsPercentileNs(const StatsHistogram* _histogram, unsigned int _permille); // 0 if empty
+int      statsReport(const LatencyStats* _stats);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // !TRIK_V4L2_DSP_FB_INTERNAL_STATS_H_
@@ -0,0 +1,49 @@
+#ifndef TRIK_V4L2_DSP_FB_INTERNAL_TARGET_TRACKER_H_
+#define TRIK_V4L2_DSP_FB_INTERNAL_TARGET_TRACKER_H_
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+
+#define TARGET_TRACKER_GAIN_MAX     100 // percent
+#define TARGET_TRACKER_COAST_FRAMES 3   // unconfident frames before lock is dropped
+#define TARGET_TRACKER_RATE_MAX     45.0 // degrees per frame
+
+/*
+ * Alpha-beta filter on target bearing with constant angular rate model, time step is one frame.
+ * Gain is alpha in percent, beta follows from it as alpha^2/(2-alpha), which is optimal for
+ * this model in Benedict-Bordner sense. Filter locks on first confident measurement, coasts
+ * over few unconfident ones and drops lock after that.
+ */
+typedef struct TargetTracker
+{
+  unsigned int m_gain;          // 0 - tracking disabled, measurements pass through
+  unsigned int m_minConfidence; // percent
+  double       m_alpha;
+  double       m_beta;
+
+  bool         m_locked;
+  double       m_angle;         // degrees, -180..180
+  double       m_rate;          // degrees per frame
+  unsigned int m_misses;
+} TargetTracker;
+
+
+void targetTrackerReset(TargetTracker* _tracker);
+void targetTrackerConfigure(TargetTracker* _tracker, unsigned int _gain, unsigned int _minConfidence);
+
+// Bearing expected for next measurement; false if filter is not locked
+bool targetTrackerPredict(const TargetTracker* _tracker, double* _angle);
+
+// Feeds measurement of next frame, returns bearing to report
+int  targetTrackerUpdate(TargetTracker* _tracker, int _angle, unsigned int _confidence);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // !TRIK_V4L2_DSP_FB_INTERNAL_TARGET_TRACKER_H_
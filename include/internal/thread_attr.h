@@ -0,0 +1,50 @@
+#ifndef TRIK_V4L2_DSP_FB_INTERNAL_THREAD_ATTR_H_
+#define TRIK_V4L2_DSP_FB_INTERNAL_THREAD_ATTR_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "internal/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+
+typedef enum ThreadPolicy
+{
+  THREAD_POLICY_DEFAULT = 0, // inherited from creator
+  THREAD_POLICY_OTHER,
+  THREAD_POLICY_FIFO,
+  THREAD_POLICY_RR
+} ThreadPolicy;
+
+typedef struct ThreadAttrConfig // what user wants to set
+{
+  ThreadPolicy m_policy;
+  int          m_priority;  // 1..99 for FIFO and RR
+  uint32_t     m_cpuMask;   // 0 - any CPU
+  size_t       m_stackSize; // 0 - libc default
+} ThreadAttrConfig;
+
+
+/*
+ * Creates thread with requested policy, affinity and stack, and reports what it actually got.
+ * Real-time policy refused for lack of privileges falls back to default scheduling with a warning.
+ */
+int threadAttrCreate(pthread_t* _thread, const char* _name, const ThreadAttrConfig* _config,
+                     void* (*_routine)(void*), void* _arg);
+
+int threadAttrParsePolicy(ThreadAttrConfig* _config, const char* _arg);   // fifo:80, rr:10, other
+int threadAttrParseCpuList(ThreadAttrConfig* _config, const char* _arg);  // 0,2-3
+
+// Locks current and future pages and pre-faults heap and stack so they never page fault later
+int threadAttrLockMemory(size_t _prefaultHeap, size_t _prefaultStack);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // !TRIK_V4L2_DSP_FB_INTERNAL_THREAD_ATTR_H_
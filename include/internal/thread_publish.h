@@ -0,0 +1,16 @@
+#ifndef TRIK_V4L2_DSP_FB_INTERNAL_THREAD_PUBLISH_H_
+#define TRIK_V4L2_DSP_FB_INTERNAL_THREAD_PUBLISH_H_
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+void* threadPublish(void* _arg);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+
+#endif // !TRIK_V4L2_DSP_FB_INTERNAL_THREAD_PUBLISH_H_
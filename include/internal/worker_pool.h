@@ -0,0 +1,76 @@
+#ifndef TRIK_V4L2_DSP_FB_INTERNAL_WORKER_POOL_H_
+#define TRIK_V4L2_DSP_FB_INTERNAL_WORKER_POOL_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <inttypes.h>
+#include <pthread.h>
+
+#include "internal/thread_attr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+
+#define WORKER_POOL_SIZE_MAX 16
+#define WORKER_POOL_CACHE_LINE 64
+
+// Called once per task; _worker is 0 for calling thread and 1..size-1 for pool threads
+typedef void (*WorkerPoolTask)(void* _ctx, size_t _task, size_t _worker);
+
+struct WorkerPool;
+
+// Packed [next, end) range of task indices, owner takes from the front and thieves from the back
+typedef uint64_t WorkerPoolQueue;
+
+typedef struct WorkerPoolThread
+{
+  WorkerPoolQueue    m_queue __attribute__((aligned(WORKER_POOL_CACHE_LINE)));
+  struct WorkerPool* m_pool;
+  size_t             m_index;
+  pthread_t          m_thread;
+} WorkerPoolThread;
+
+/*
+ * Fork/join pool for per-frame work of CPU backend. Caller of workerPoolRun() takes part in
+ * processing and returns when all tasks are done. Every worker starts with contiguous share of
+ * tasks and, once it runs dry, steals half of what is left in another worker's queue, so uneven
+ * tasks balance out without contending on a shared counter. Threads take scheduling, affinity and
+ * stack from given attributes; without them they inherit owner thread scheduling and libc stack.
+ */
+typedef struct WorkerPool
+{
+  WorkerPoolThread m_threads[WORKER_POOL_SIZE_MAX]; // [0] is the caller, only its queue is used
+  size_t           m_size; // including caller; 0 - not opened
+
+  pthread_mutex_t  m_mutex;
+  pthread_cond_t   m_startCond;
+  pthread_cond_t   m_doneCond;
+  unsigned int     m_generation;
+  size_t           m_running;
+  bool             m_terminate;
+
+  WorkerPoolTask   m_task;
+  void*            m_ctx;
+  size_t           m_taskCount;
+  unsigned long    m_steals; // since last workerPoolTakeSteals()
+} WorkerPool;
+
+
+// _threadAttr applies to every pool thread, NULL - defaults
+int    workerPoolOpen(WorkerPool* _pool, size_t _size, const ThreadAttrConfig* _threadAttr);
+int    workerPoolClose(WorkerPool* _pool);
+
+int    workerPoolRun(WorkerPool* _pool, size_t _taskCount, WorkerPoolTask _task, void* _ctx);
+size_t workerPoolSize(const WorkerPool* _pool);
+unsigned long workerPoolTakeSteals(WorkerPool* _pool);
+
+size_t workerPoolOnlineCPUs();
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // !TRIK_V4L2_DSP_FB_INTERNAL_WORKER_POOL_H_
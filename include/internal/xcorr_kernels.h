@@ -0,0 +1,51 @@
+#ifndef TRIK_V4L2_DSP_FB_INTERNAL_XCORR_KERNELS_H_
+#define TRIK_V4L2_DSP_FB_INTERNAL_XCORR_KERNELS_H_
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+
+// Lag ranges split between workers should be multiples of this
+#define XCORR_KERNEL_LAG_BLOCK 4
+
+/*
+ * Accumulates cross-correlation of one window into _xcorr, which holds lags -maxLag..maxLag;
+ * only entries [_lagBegin, _lagEnd) are touched. Positive lag means second channel is late.
+ * Window must be longer than 2*maxLag.
+ */
+typedef void (*XCorrWindowFunc)(const int16_t* _first, const int16_t* _second, size_t _window, size_t _maxLag,
+                                size_t _lagBegin, size_t _lagEnd, double* _xcorr);
+
+/*
+ * Time domain correlation for one window size and widest pair, picked when detect parameters
+ * or microphone array change. Deployed window sizes have specializations with window and lag
+ * bound fixed at compile time, others use generic loop. All variants give bit-exact results,
+ * rostik_bench --self-test checks that.
+ */
+typedef struct XCorrKernel
+{
+  size_t          m_window; // 0 - not selected yet
+  size_t          m_maxLag; // pairs up to this lag are served
+  XCorrWindowFunc m_correlate;
+  const char*     m_name;
+} XCorrKernel;
+
+
+int xcorrKernelSelect(XCorrKernel* _kernel, size_t _window, size_t _maxLag);
+int xcorrKernelGeneric(XCorrKernel* _kernel, size_t _window, size_t _maxLag);
+// Compiled specializations one by one, ENOENT past the last one
+int xcorrKernelSpecialization(XCorrKernel* _kernel, size_t _index);
+
+// Value perfectly correlated window would add at peak
+double xcorrWindowNorm(const int16_t* _first, const int16_t* _second, size_t _window, size_t _maxLag);
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // !TRIK_V4L2_DSP_FB_INTERNAL_XCORR_KERNELS_H_
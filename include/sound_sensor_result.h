@@ -0,0 +1,54 @@
+#ifndef TRIK_V4L2_DSP_FB_SOUND_SENSOR_RESULT_H_
+#define TRIK_V4L2_DSP_FB_SOUND_SENSOR_RESULT_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+
+/*
+ * Record written to output FIFO with --rc-out-format=binary.
+ * Fields are little-endian as on target; readers must check magic, version and size,
+ * and skip m_size bytes for records of unknown newer versions.
+ * Gaps in m_sequence mean results were dropped before reaching FIFO.
+ * Version 2 appended per-channel volumes.
+ */
+#define SOUND_SENSOR_RESULT_MAGIC	0x52444e53u // "SNDR"
+#define SOUND_SENSOR_RESULT_VERSION	2
+
+#define SOUND_SENSOR_RESULT_CHANNELS_MAX	8
+
+typedef enum SoundSensorResultKind
+{
+  SOUND_SENSOR_RESULT_LOCATION = 0,
+  SOUND_SENSOR_RESULT_PARAMS   = 1  // reply to 'detect' command, no payload yet
+} SoundSensorResultKind;
+
+#define SOUND_SENSOR_RESULT_FLAG_GATED	0x0001u // below energy gate, no target; angle is meaningless
+
+typedef struct __attribute__((packed)) SoundSensorResult
+{
+  uint32_t m_magic;
+  uint16_t m_version;
+  uint16_t m_size;        // of whole record
+  uint16_t m_kind;
+  uint16_t m_flags;       // SOUND_SENSOR_RESULT_FLAG_*, zero in older writers
+  uint32_t m_sequence;
+  uint64_t m_timestampNs; // CLOCK_MONOTONIC at capture
+  int32_t  m_angle;       // degrees, positive to the right; -180..180 with planar microphone array
+  uint32_t m_leftVolume;
+  uint32_t m_rightVolume;
+  uint32_t m_confidence;  // percent, 0 if unknown
+  uint16_t m_channels;    // valid entries of m_channelVolume
+  uint16_t m_reserved;
+  uint32_t m_channelVolume[SOUND_SENSOR_RESULT_CHANNELS_MAX];
+} SoundSensorResult;
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // !TRIK_V4L2_DSP_FB_SOUND_SENSOR_RESULT_H_
@@ -0,0 +1,142 @@
+#ifndef TRIK_V4L2_DSP_FB_SOUND_SENSOR_SHM_H_
+#define TRIK_V4L2_DSP_FB_SOUND_SENSOR_SHM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "sound_sensor_result.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif // __cplusplus
+
+
+/*
+ * Shared memory segment with localization results, see --shm-name.
+ * Writer is the sensor audio thread; any number of readers poll it without syscalls and without
+ * ever blocking the writer. Every entry is guarded by its own seqlock: m_seq is odd while entry
+ * is being written, reader retries if m_seq was odd or changed while it copied the entry.
+ *
+ * m_latest always holds the most recent result. m_ring keeps history: result number N
+ * (counted from 0) is stored in m_ring[N % SOUND_SENSOR_SHM_RING_SIZE] with m_index == N.
+ * m_writeIndex is the number of results written so far.
+ */
+#define SOUND_SENSOR_SHM_MAGIC		0x4d485353u // "SSHM"
+#define SOUND_SENSOR_SHM_VERSION	2
+#define SOUND_SENSOR_SHM_RING_SIZE	256
+#define SOUND_SENSOR_SHM_READ_RETRIES	64
+
+typedef struct SoundSensorShmEntry
+{
+  uint32_t          m_seq;
+  uint32_t          m_index;
+  SoundSensorResult m_result;
+} SoundSensorShmEntry;
+
+typedef struct SoundSensorShm
+{
+  uint32_t            m_magic;
+  uint16_t            m_version;
+  uint16_t            m_entrySize;
+  uint32_t            m_ringSize;
+  uint32_t            m_writeIndex;
+
+  SoundSensorShmEntry m_latest;
+  SoundSensorShmEntry m_ring[SOUND_SENSOR_SHM_RING_SIZE];
+} SoundSensorShm;
+
+
+static inline int soundSensorShmOpen(const char* _name, const SoundSensorShm** _shm)
+{
+  int res;
+
+  if (_name == NULL || _shm == NULL)
+    return EINVAL;
+
+  const int fd = shm_open(_name, O_RDONLY, 0);
+  if (fd < 0)
+    return errno;
+
+  void* ptr = mmap(NULL, sizeof(SoundSensorShm), PROT_READ, MAP_SHARED, fd, 0);
+  res = errno;
+  close(fd);
+  if (ptr == MAP_FAILED)
+    return res;
+
+  const SoundSensorShm* shm = (const SoundSensorShm*)ptr;
+  if (   shm->m_magic != SOUND_SENSOR_SHM_MAGIC || shm->m_version != SOUND_SENSOR_SHM_VERSION
+      || shm->m_entrySize != sizeof(SoundSensorShmEntry) || shm->m_ringSize != SOUND_SENSOR_SHM_RING_SIZE)
+  {
+    munmap(ptr, sizeof(SoundSensorShm));
+    return EPROTO;
+  }
+
+  *_shm = shm;
+  return 0;
+}
+
+static inline void soundSensorShmClose(const SoundSensorShm* _shm)
+{
+  if (_shm != NULL)
+    munmap((void*)_shm, sizeof(SoundSensorShm));
+}
+
+static inline uint32_t soundSensorShmWriteIndex(const SoundSensorShm* _shm)
+{
+  return __atomic_load_n(&_shm->m_writeIndex, __ATOMIC_ACQUIRE);
+}
+
+// Returns false if entry was being rewritten all the time, which should not happen unless writer is much faster
+static inline bool soundSensorShmReadEntry(const SoundSensorShmEntry* _entry, uint32_t* _index, SoundSensorResult* _result)
+{
+  int retry;
+
+  for (retry = 0; retry < SOUND_SENSOR_SHM_READ_RETRIES; ++retry)
+  {
+    const uint32_t seq = __atomic_load_n(&_entry->m_seq, __ATOMIC_ACQUIRE);
+    if (seq & 1)
+      continue;
+
+    *_index  = _entry->m_index;
+    *_result = _entry->m_result;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    if (__atomic_load_n(&_entry->m_seq, __ATOMIC_RELAXED) == seq)
+      return true;
+  }
+
+  return false;
+}
+
+// Latest result; returns false if nothing was published yet
+static inline bool soundSensorShmReadLatest(const SoundSensorShm* _shm, SoundSensorResult* _result)
+{
+  uint32_t index;
+
+  if (soundSensorShmWriteIndex(_shm) == 0)
+    return false;
+
+  return soundSensorShmReadEntry(&_shm->m_latest, &index, _result);
+}
+
+// Result number _index; returns false if it is not written yet or already overwritten
+static inline bool soundSensorShmReadAt(const SoundSensorShm* _shm, uint32_t _index, SoundSensorResult* _result)
+{
+  uint32_t index;
+
+  if (!soundSensorShmReadEntry(&_shm->m_ring[_index % SOUND_SENSOR_SHM_RING_SIZE], &index, _result))
+    return false;
+
+  return index == _index && (int32_t)(soundSensorShmWriteIndex(_shm) - _index) > 0;
+}
+
+
+#ifdef __cplusplus
+} // extern "C"
+#endif // __cplusplus
+
+#endif // !TRIK_V4L2_DSP_FB_SOUND_SENSOR_SHM_H_
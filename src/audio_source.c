@@ -0,0 +1,131 @@
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "internal/audio_source.h"
+
+
+int audioSourceOpen(AudioSource* _src, const AudioSourceConfig* _config, const AlsaConfig* _alsaConfig)
+{
+  int res;
+
+  if (_src == NULL || _config == NULL || _alsaConfig == NULL)
+    return EINVAL;
+  if (_src->m_opened)
+    return EALREADY;
+
+  switch (_config->m_kind)
+  {
+    case AUDIO_SOURCE_ALSA:
+      if ((res = alsaInputOpen(&_src->m_alsa, _alsaConfig)) != 0)
+      {
+        fprintf(stderr, "alsaInputOpen() failed: %d\n", res);
+        return res;
+      }
+      break;
+
+    case AUDIO_SOURCE_WAV:
+    case AUDIO_SOURCE_RAW:
+    {
+      FileInputConfig fileConfig;
+
+      if (_config->m_filePath == NULL)
+      {
+        fprintf(stderr, "No audio file specified\n");
+        return EINVAL;
+      }
+
+      fileConfig.m_path     = _config->m_filePath;
+      fileConfig.m_raw      = _config->m_kind == AUDIO_SOURCE_RAW;
+      fileConfig.m_realtime = _config->m_fileRealtime;
+      fileConfig.m_loop     = _config->m_fileLoop;
+      fileConfig.m_rate     = _alsaConfig->m_rate;
+      fileConfig.m_channels = _alsaConfig->m_channels;
+
+      if ((res = fileInputOpen(&_src->m_file, &fileConfig)) != 0)
+      {
+        fprintf(stderr, "fileInputOpen() failed: %d\n", res);
+        return res;
+      }
+      break;
+    }
+
+    default:
+      return EINVAL;
+  }
+
+  _src->m_kind   = _config->m_kind;
+  _src->m_opened = true;
+
+  return 0;
+}
+
+int audioSourceClose(AudioSource* _src)
+{
+  int res;
+
+  if (_src == NULL)
+    return EINVAL;
+  if (!_src->m_opened)
+    return EALREADY;
+
+  if (_src->m_kind == AUDIO_SOURCE_ALSA)
+    res = alsaInputClose(&_src->m_alsa);
+  else
+    res = fileInputClose(&_src->m_file);
+
+  _src->m_opened = false;
+
+  return res;
+}
+
+int audioSourceStart(AudioSource* _src)
+{
+  if (_src == NULL)
+    return EINVAL;
+  if (!_src->m_opened)
+    return ENOTCONN;
+
+  if (_src->m_kind == AUDIO_SOURCE_ALSA)
+    return alsaInputStart(&_src->m_alsa);
+  return fileInputStart(&_src->m_file);
+}
+
+int audioSourceStop(AudioSource* _src)
+{
+  if (_src == NULL)
+    return EINVAL;
+  if (!_src->m_opened)
+    return ENOTCONN;
+
+  if (_src->m_kind == AUDIO_SOURCE_ALSA)
+    return alsaInputStop(&_src->m_alsa);
+  return fileInputStop(&_src->m_file);
+}
+
+int audioSourceGetFrameSize(const AudioSource* _src, size_t* _frameSize)
+{
+  if (_src == NULL)
+    return EINVAL;
+  if (!_src->m_opened)
+    return ENOTCONN;
+
+  if (_src->m_kind == AUDIO_SOURCE_ALSA)
+    return alsaInputGetFrameSize(&_src->m_alsa, _frameSize);
+  return fileInputGetFrameSize(&_src->m_file, _frameSize);
+}
+
+int audioSourceReadFrames(AudioSource* _src, void* _dstPtr, size_t _frames)
+{
+  if (_src == NULL)
+    return EINVAL;
+  if (!_src->m_opened)
+    return ENOTCONN;
+
+  if (_src->m_kind == AUDIO_SOURCE_ALSA)
+    return alsaInputReadFrames(&_src->m_alsa, _dstPtr, _frames);
+  return fileInputReadFrames(&_src->m_file, _dstPtr, _frames);
+}
+
@@ -0,0 +1,850 @@
+#include "config.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sysexits.h>
+#include <errno.h>
+#include <math.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "internal/common.h"
+#include "internal/mic_array.h"
+#include "internal/module_file.h"
+#include "internal/module_ce_cpu.h"
+#include "internal/sound_kernels.h"
+#include "internal/stats.h"
+
+/*
+ * Offline benchmark: replays audio file through the host backend with every combination
+ * of swept parameters and prints results as JSON on stdout. Progress goes to stderr.
+ */
+
+#define BENCH_SWEEP_MAX 16
+
+typedef struct BenchSweep
+{
+  unsigned int m_values[BENCH_SWEEP_MAX];
+  size_t       m_count;
+} BenchSweep;
+
+typedef struct BenchConfig
+{
+  const char*  m_filePath;  // synthetic noise if NULL
+  bool         m_fileRaw;
+  unsigned int m_rate;
+  unsigned int m_channels;
+  const char*  m_micGeometry;
+  unsigned int m_synthDelay;
+  int          m_synthAngle;
+  unsigned int m_frames;
+  unsigned int m_warmupFrames;
+  unsigned int m_micDistance;
+  unsigned int m_volumeCoefficient;
+  unsigned int m_trackConfidence;
+  bool         m_selfTest;
+
+  BenchSweep   m_windowSizes;
+  BenchSweep   m_numSamples;
+  BenchSweep   m_hopSizes;
+  BenchSweep   m_algorithms;
+  BenchSweep   m_workers;
+  BenchSweep   m_trackGains;
+} BenchConfig;
+
+typedef struct BenchResult
+{
+  double             m_wallSeconds;
+  double             m_userSeconds;
+  double             m_systemSeconds;
+  long               m_peakRssKb;
+  unsigned long long m_audioFrames;
+  int                m_lastAngle;
+  const char*        m_xcorrKernel;
+  size_t             m_workers;
+  unsigned long      m_steals;
+  long long          m_narrowFrames;
+  LatencyStats       m_stats;
+} BenchResult;
+
+
+static const char* do_algorithmName(unsigned int _algorithm)
+{
+  switch (_algorithm)
+  {
+    case TARGET_DETECT_ALGORITHM_XCORR:		return "xcorr";
+    case TARGET_DETECT_ALGORITHM_GCC_PHAT:	return "gccphat";
+    default:					return "unknown";
+  }
+}
+
+static bool do_parseSweep(BenchSweep* _sweep, const char* _arg, bool _algorithms)
+{
+  char buffer[256];
+  char* savePtr = NULL;
+  char* token;
+
+  if (strlen(_arg) >= sizeof(buffer))
+    return false;
+  strcpy(buffer, _arg);
+
+  _sweep->m_count = 0;
+  for (token = strtok_r(buffer, ",", &savePtr); token != NULL; token = strtok_r(NULL, ",", &savePtr))
+  {
+    unsigned int value;
+
+    if (_sweep->m_count == BENCH_SWEEP_MAX)
+      return false;
+
+    if (!_algorithms)
+      value = strtoul(token, NULL, 0);
+    else if (!strcasecmp(token, "xcorr"))
+      value = TARGET_DETECT_ALGORITHM_XCORR;
+    else if (!strcasecmp(token, "gccphat"))
+      value = TARGET_DETECT_ALGORITHM_GCC_PHAT;
+    else
+    {
+      fprintf(stderr, "Unknown algorithm '%s'\n"
+                      "Known algorithms: xcorr, gccphat\n",
+              token);
+      return false;
+    }
+
+    _sweep->m_values[_sweep->m_count++] = value;
+  }
+
+  return _sweep->m_count > 0;
+}
+
+static bool do_parseArgs(BenchConfig* _config, int _argc, char* const _argv[], const char** _outputPath)
+{
+  int opt;
+  int longopt;
+
+  static const char* s_optstring = "h";
+  static const struct option s_longopts[] =
+  {
+    { "audio-source",		1,	NULL,	0   }, // 0
+    { "audio-file",		1,	NULL,	0   },
+    { "rate",			1,	NULL,	0   }, // 2
+    { "synth-delay",		1,	NULL,	0   },
+    { "frames",			1,	NULL,	0   }, // 4
+    { "warmup",			1,	NULL,	0   },
+    { "mic-distance",		1,	NULL,	0   }, // 6
+    { "volume",			1,	NULL,	0   },
+    { "window",			1,	NULL,	0   }, // 8
+    { "samples",		1,	NULL,	0   },
+    { "hop",			1,	NULL,	0   },
+    { "alg",			1,	NULL,	0   },
+    { "output",			1,	NULL,	0   }, // 12
+    { "channels",		1,	NULL,	0   },
+    { "mic-geometry",		1,	NULL,	0   }, // 14
+    { "synth-angle",		1,	NULL,	0   },
+    { "self-test",		0,	NULL,	0   }, // 16
+    { "workers",		1,	NULL,	0   },
+    { "track",			1,	NULL,	0   }, // 18
+    { "track-confidence",	1,	NULL,	0   },
+    { "help",			0,	NULL,	'h' },
+    { NULL,			0,	NULL,	0   }
+  };
+
+  while ((opt = getopt_long(_argc, _argv, s_optstring, s_longopts, &longopt)) != -1)
+  {
+    if (opt != 0)
+      return false;
+
+    switch (longopt)
+    {
+      case 0:
+        if      (!strcasecmp(optarg, "wav"))	_config->m_fileRaw = false;
+        else if (!strcasecmp(optarg, "raw"))	_config->m_fileRaw = true;
+        else
+        {
+          fprintf(stderr, "Unknown audio source '%s'\n"
+                          "Known sources: wav, raw\n",
+                  optarg);
+          return false;
+        }
+        break;
+      case 0+1: _config->m_filePath = optarg;				break;
+
+      case 2  : _config->m_rate = atoi(optarg);				break;
+      case 2+1: _config->m_synthDelay = atoi(optarg);			break;
+
+      case 4  : _config->m_frames = atoi(optarg);				break;
+      case 4+1: _config->m_warmupFrames = atoi(optarg);			break;
+
+      case 6  : _config->m_micDistance = atoi(optarg);			break;
+      case 6+1: _config->m_volumeCoefficient = atoi(optarg);		break;
+
+      case 8  : if (!do_parseSweep(&_config->m_windowSizes, optarg, false))	return false;	break;
+      case 8+1: if (!do_parseSweep(&_config->m_numSamples,  optarg, false))	return false;	break;
+      case 8+2: if (!do_parseSweep(&_config->m_hopSizes,    optarg, false))	return false;	break;
+      case 8+3: if (!do_parseSweep(&_config->m_algorithms,  optarg, true))	return false;	break;
+
+      case 12  : *_outputPath = optarg;					break;
+      case 12+1: _config->m_channels = atoi(optarg);			break;
+
+      case 14  : _config->m_micGeometry = optarg;			break;
+      case 14+1: _config->m_synthAngle = atoi(optarg);			break;
+
+      case 16  : _config->m_selfTest = true;				break;
+      case 16+1: if (!do_parseSweep(&_config->m_workers, optarg, false))	return false;	break;
+
+      case 18  : if (!do_parseSweep(&_config->m_trackGains, optarg, false))	return false;	break;
+      case 18+1: _config->m_trackConfidence = atoi(optarg);		break;
+
+      default:
+        return false;
+    }
+  }
+
+  return _config->m_rate > 0 && _config->m_frames > 0
+      && _config->m_channels >= 2 && _config->m_channels <= TARGET_CHANNELS_MAX;
+}
+
+static void do_helpMessage(const char* _arg0)
+{
+  fprintf(stderr, "Usage:\n"
+                  "    %s <opts>\n"
+                  " where opts are:\n"
+                  "   --audio-source   <wav|raw>\n"
+                  "   --audio-file     <replayed-file-path, synthetic noise if omitted>\n"
+                  "   --rate           <sample-rate, raw and synthetic input>\n"
+                  "   --channels       <channels, raw and synthetic input>\n"
+                  "   --mic-geometry   <x,y;x,y;... in mm or circle:<radius-mm>, required above 2 channels>\n"
+                  "   --synth-delay    <right-channel-delay-in-samples, synthetic stereo input>\n"
+                  "   --synth-angle    <source-bearing-degrees, synthetic microphone array input>\n"
+                  "   --frames         <measured-frames-per-run>\n"
+                  "   --warmup         <unmeasured-frames-per-run>\n"
+                  "   --mic-distance   <mic-distance-mm>\n"
+                  "   --volume         <volume-coefficient>\n"
+                  "   --window         <list, e.g. 256,512>\n"
+                  "   --samples        <list, e.g. 1024,2048>\n"
+                  "   --hop            <list, 0 disables sliding window>\n"
+                  "   --alg            <list of xcorr|gccphat>\n"
+                  "   --workers        <list, 0 for one per online cpu>\n"
+                  "   --track          <list of bearing tracker gains in percent, 0 disables tracking>\n"
+                  "   --track-confidence <percent-below-which-tracker-coasts>\n"
+                  "   --output         <json-path, stdout by default>\n"
+                  "   --self-test      <check kernels against reference and time them, no replay>\n"
+                  "   --help\n",
+          _arg0);
+}
+
+// Per channel delay of plane wave from given bearing; stereo without geometry just has right channel lagging
+static size_t do_synthDelays(const BenchConfig* _config, const MicArrayGeometry* _geometry, size_t* _delays)
+{
+  size_t channel;
+  size_t maxDelay = 0;
+
+  if (_geometry->m_count == 0)
+  {
+    _delays[0] = 0;
+    _delays[1] = _config->m_synthDelay;
+    return _config->m_synthDelay;
+  }
+
+  const double ux = sin(_config->m_synthAngle * M_PI / 180.0);
+  const double uy = cos(_config->m_synthAngle * M_PI / 180.0);
+  double nearest = -INFINITY;
+  for (channel = 0; channel < _geometry->m_count; ++channel)
+    if (_geometry->m_x[channel] * ux + _geometry->m_y[channel] * uy > nearest)
+      nearest = _geometry->m_x[channel] * ux + _geometry->m_y[channel] * uy;
+
+  for (channel = 0; channel < _geometry->m_count; ++channel)
+  {
+    const double path = nearest - (_geometry->m_x[channel] * ux + _geometry->m_y[channel] * uy);
+    _delays[channel] = (size_t)lround(path / 1000.0 / 343.0 * _config->m_rate);
+    if (_delays[channel] > maxDelay)
+      maxDelay = _delays[channel];
+  }
+
+  return maxDelay;
+}
+
+// Broadband noise arriving at channels with different delays, so correlation has a clear peak
+static int do_synthesize(const BenchConfig* _config, char* _path, size_t _pathSize)
+{
+  int res = 0;
+  int fd;
+  size_t idx;
+  size_t channel;
+  const size_t frames = _config->m_rate;
+  const size_t channels = _config->m_channels;
+  size_t delays[TARGET_CHANNELS_MAX];
+  MicArrayGeometry geometry;
+  int16_t* samples;
+  int16_t* noise;
+  unsigned int seed = 1;
+
+  if ((res = micArrayParseGeometry(&geometry, _config->m_micGeometry, channels)) != 0)
+    return res;
+  const size_t delay = do_synthDelays(_config, &geometry, delays);
+
+  snprintf(_path, _pathSize, "/tmp/rostik-bench.XXXXXX");
+  if ((fd = mkstemp(_path)) < 0)
+  {
+    res = errno;
+    fprintf(stderr, "mkstemp(%s) failed: %d\n", _path, res);
+    return res;
+  }
+
+  samples = malloc(frames * channels * sizeof(*samples));
+  noise   = malloc((frames + delay) * sizeof(*noise));
+  if (samples == NULL || noise == NULL)
+  {
+    res = ENOMEM;
+    goto exit_free;
+  }
+
+  for (idx = 0; idx < frames + delay; ++idx)
+    noise[idx] = (int16_t)((rand_r(&seed) % 16384) - 8192);
+
+  for (idx = 0; idx < frames; ++idx)
+    for (channel = 0; channel < channels; ++channel)
+      samples[channels*idx + channel] = noise[idx + delay - delays[channel]];
+
+  if (write(fd, samples, frames * channels * sizeof(*samples)) != (ssize_t)(frames * channels * sizeof(*samples)))
+  {
+    res = errno ? errno : EIO;
+    fprintf(stderr, "write(%s) failed: %d\n", _path, res);
+  }
+
+ exit_free:
+  free(noise);
+  free(samples);
+  close(fd);
+  if (res != 0)
+    unlink(_path);
+  return res;
+}
+
+// Peak RSS since last reset; falls back to process lifetime peak on kernels without clear_refs
+static void do_resetPeakRss()
+{
+  const int fd = open("/proc/self/clear_refs", O_WRONLY|O_CLOEXEC);
+  if (fd < 0)
+    return;
+
+  if (write(fd, "5", 1) != 1)
+    fprintf(stderr, "Peak RSS reset is not supported, reporting process peak\n");
+  close(fd);
+}
+
+static long do_peakRssKb()
+{
+  char line[128];
+  long peakKb = -1;
+  FILE* status = fopen("/proc/self/status", "r");
+
+  if (status != NULL)
+  {
+    while (fgets(line, sizeof(line), status) != NULL)
+      if (sscanf(line, "VmHWM: %ld kB", &peakKb) == 1)
+        break;
+    fclose(status);
+  }
+
+  if (peakKb < 0)
+  {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    peakKb = usage.ru_maxrss;
+  }
+
+  return peakKb;
+}
+
+static double do_timevalSeconds(const struct timeval* _tv)
+{
+  return _tv->tv_sec + _tv->tv_usec / 1e6;
+}
+
+// Same steps as audio thread: read hop into sliding window, then process whole window
+static int do_run(const BenchConfig* _config, const char* _path, const TargetDetectParams* _params,
+                  unsigned int _workers, BenchResult* _result)
+{
+  int res;
+  unsigned int frame;
+  FileInput file;
+  CPUEngine cpu;
+  char* window = NULL;
+  size_t frameSize;
+  struct rusage usageStart;
+  struct rusage usageEnd;
+  TargetLocation location;
+  const FileInputConfig fileConfig = { _path, _config->m_filePath == NULL || _config->m_fileRaw,
+                                       false, true, _config->m_rate, _config->m_channels };
+  const AudioDescription audioDesc = { _config->m_rate, _config->m_channels };
+  const size_t windowFrames = _params->m_numSamples;
+  const size_t hopFrames = _params->m_hopSize == 0 || _params->m_hopSize > windowFrames ? windowFrames
+                                                                                       : _params->m_hopSize;
+
+  memset(&file, 0, sizeof(file));
+  file.m_fd = -1;
+  memset(&cpu, 0, sizeof(cpu));
+  memset(&location, 0, sizeof(location));
+
+  if ((res = fileInputOpen(&file, &fileConfig)) != 0)
+  {
+    fprintf(stderr, "fileInputOpen() failed: %d\n", res);
+    return res;
+  }
+
+  if ((res = cpuEngineOpen(&cpu, &audioDesc, windowFrames, _config->m_micGeometry, _workers, NULL)) != 0)
+  {
+    fprintf(stderr, "cpuEngineOpen() failed: %d\n", res);
+    goto exit_file_close;
+  }
+
+  fileInputGetFrameSize(&file, &frameSize);
+  if ((window = malloc(windowFrames * frameSize)) == NULL)
+  {
+    res = ENOMEM;
+    goto exit_cpu_close;
+  }
+
+  if (   (res = fileInputStart(&file)) != 0
+      || (res = fileInputReadFrames(&file, window, windowFrames)) != 0)
+  {
+    fprintf(stderr, "fileInputReadFrames() failed: %d\n", res);
+    goto exit_free;
+  }
+
+  statsReset(&_result->m_stats);
+  for (frame = 0; frame < _config->m_warmupFrames + _config->m_frames; ++frame)
+  {
+    if (frame == _config->m_warmupFrames)
+    {
+      statsReset(&_result->m_stats);
+      workerPoolTakeSteals(&cpu.m_pool);
+      cpu.m_narrowFrames = 0;
+      do_resetPeakRss();
+      getrusage(RUSAGE_SELF, &usageStart);
+      _result->m_wallSeconds = statsNowNs() / 1e9;
+    }
+
+    const uint64_t frameStartNs = statsNowNs();
+
+    memmove(window, window + hopFrames * frameSize, (windowFrames - hopFrames) * frameSize);
+    const uint64_t readStartNs = statsNowNs();
+    if ((res = fileInputReadFrames(&file, window + (windowFrames - hopFrames) * frameSize, hopFrames)) != 0)
+    {
+      fprintf(stderr, "fileInputReadFrames() failed: %d\n", res);
+      goto exit_free;
+    }
+    const uint64_t processStartNs = statsNowNs();
+
+    if ((res = cpuEngineProcess(&cpu, window, windowFrames * frameSize, _params, &location)) != 0)
+    {
+      fprintf(stderr, "cpuEngineProcess() failed: %d\n", res);
+      goto exit_free;
+    }
+    const uint64_t frameEndNs = statsNowNs();
+
+    statsRecord(&_result->m_stats, STATS_STAGE_PACK,         readStartNs - frameStartNs);
+    statsRecord(&_result->m_stats, STATS_STAGE_CAPTURE_WAIT, processStartNs - readStartNs);
+    statsRecord(&_result->m_stats, STATS_STAGE_PROCESS,      frameEndNs - processStartNs);
+    statsRecord(&_result->m_stats, STATS_STAGE_FRAME,        frameEndNs - frameStartNs);
+  }
+
+  getrusage(RUSAGE_SELF, &usageEnd);
+  _result->m_wallSeconds   = statsNowNs() / 1e9 - _result->m_wallSeconds;
+  _result->m_userSeconds   = do_timevalSeconds(&usageEnd.ru_utime) - do_timevalSeconds(&usageStart.ru_utime);
+  _result->m_systemSeconds = do_timevalSeconds(&usageEnd.ru_stime) - do_timevalSeconds(&usageStart.ru_stime);
+  _result->m_peakRssKb     = do_peakRssKb();
+  _result->m_audioFrames   = (unsigned long long)_config->m_frames * hopFrames;
+  _result->m_lastAngle     = location.m_targetAngle;
+  _result->m_xcorrKernel   = cpu.m_xcorrKernel.m_name != NULL ? cpu.m_xcorrKernel.m_name : "none";
+  _result->m_workers       = workerPoolSize(&cpu.m_pool);
+  _result->m_steals        = workerPoolTakeSteals(&cpu.m_pool);
+  _result->m_narrowFrames  = cpu.m_narrowFrames;
+
+ exit_free:
+  free(window);
+
+ exit_cpu_close:
+  cpuEngineClose(&cpu);
+
+ exit_file_close:
+  fileInputClose(&file);
+  return res;
+}
+
+#define BENCH_SELF_TEST_SAMPLES 4096
+#define BENCH_SELF_TEST_REPEAT  2000
+#define BENCH_SELF_TEST_LAG_MAX 64
+#define BENCH_SELF_TEST_WINDOW  1024
+
+// Reference results are computed in double precision, which is exact for these sizes
+static size_t do_selfTestCheck(const int16_t* _a, const int16_t* _b, size_t* _checks)
+{
+  static const size_t s_sizes[] = { 0, 1, 2, 3, 7, 8, 9, 31, 64, 255, 1024, BENCH_SELF_TEST_SAMPLES };
+  int16_t dc[BENCH_SELF_TEST_SAMPLES];
+  size_t sizeIdx, offsetA, offsetB, idx;
+  size_t mismatches = 0;
+
+  for (sizeIdx = 0; sizeIdx < sizeof(s_sizes)/sizeof(*s_sizes); ++sizeIdx)
+    for (offsetA = 0; offsetA < 2; ++offsetA)
+    {
+      const size_t count = s_sizes[sizeIdx];
+      const int16_t* a = _a + offsetA;
+      double energy = 0.0;
+      double sum = 0.0;
+
+      for (idx = 0; idx < count; ++idx)
+      {
+        energy += (double)a[idx] * a[idx];
+        sum    += a[idx];
+      }
+      ++*_checks;
+      if ((double)soundKernelEnergyS16(a, count) != energy)
+        ++mismatches;
+
+      for (offsetB = 0; offsetB < 4; ++offsetB)
+      {
+        const int16_t* b = _b + offsetB;
+        double dot = 0.0;
+
+        for (idx = 0; idx < count; ++idx)
+          dot += (double)a[idx] * b[idx];
+        ++*_checks;
+        if ((double)soundKernelDotS16(a, b, count) != dot)
+          ++mismatches;
+      }
+
+      if (count == 0 || count > BENCH_SELF_TEST_SAMPLES)
+        continue;
+
+      const double mean = trunc(sum / count);
+      memcpy(dc, a, count * sizeof(*dc));
+      soundKernelRemoveDCS16(dc, count);
+      ++*_checks;
+      for (idx = 0; idx < count; ++idx)
+      {
+        const double expected = fmax(INT16_MIN, fmin(INT16_MAX, a[idx] - mean));
+        if (dc[idx] != expected)
+        {
+          ++mismatches;
+          break;
+        }
+      }
+    }
+
+  return mismatches;
+}
+
+static double do_selfTestTime(const int16_t* _a, const int16_t* _b, bool _reference)
+{
+  float a[BENCH_SELF_TEST_SAMPLES];
+  float b[BENCH_SELF_TEST_SAMPLES];
+  volatile double sink = 0.0;
+  size_t repeat, idx;
+
+  for (idx = 0; idx < BENCH_SELF_TEST_SAMPLES; ++idx)
+  {
+    a[idx] = _a[idx];
+    b[idx] = _b[idx];
+  }
+
+  const uint64_t startNs = statsNowNs();
+  for (repeat = 0; repeat < BENCH_SELF_TEST_REPEAT; ++repeat)
+  {
+    if (_reference)
+    {
+      float dot = 0.0f;
+      for (idx = 0; idx < BENCH_SELF_TEST_SAMPLES; ++idx)
+        dot += a[idx] * b[idx];
+      sink += dot;
+    }
+    else
+      sink += soundKernelDotS16(_a, _b + (repeat & 1), BENCH_SELF_TEST_SAMPLES);
+  }
+
+  return (double)(statsNowNs() - startNs) / ((double)BENCH_SELF_TEST_REPEAT * BENCH_SELF_TEST_SAMPLES);
+}
+
+// Every correlation specialization against generic loop: own lag bound and narrower pairs, whole and partial lag ranges
+static size_t do_selfTestXCorr(const int16_t* _a, const int16_t* _b, size_t* _checks)
+{
+  double expected[2*BENCH_SELF_TEST_LAG_MAX + 1];
+  double actual[2*BENCH_SELF_TEST_LAG_MAX + 1];
+  XCorrKernel generic;
+  XCorrKernel fixed;
+  size_t index, lagIdx, rangeIdx, offsetB, idx;
+  size_t mismatches = 0;
+
+  for (index = 0; xcorrKernelSpecialization(&fixed, index) == 0; ++index)
+  {
+    const size_t lags[] = { fixed.m_maxLag, fixed.m_maxLag - 1, fixed.m_maxLag / 2 + 1, 1 };
+
+    for (lagIdx = 0; lagIdx < sizeof(lags)/sizeof(*lags); ++lagIdx)
+    {
+      const size_t maxLag = lags[lagIdx];
+      const size_t lagCount = 2*maxLag + 1;
+      const size_t ranges[][2] = { { 0, lagCount }, { 1, lagCount - 1 }, { maxLag, maxLag + 1 } };
+
+      ++*_checks;
+      if (maxLag > BENCH_SELF_TEST_LAG_MAX || fixed.m_window > BENCH_SELF_TEST_SAMPLES)
+      {
+        ++mismatches; // self-test buffers are too small to check it
+        continue;
+      }
+      xcorrKernelGeneric(&generic, fixed.m_window, maxLag);
+
+      for (rangeIdx = 0; rangeIdx < sizeof(ranges)/sizeof(*ranges); ++rangeIdx)
+        for (offsetB = 0; offsetB < 2; ++offsetB)
+        {
+          memset(expected, 0, sizeof(expected));
+          memset(actual, 0, sizeof(actual));
+          generic.m_correlate(_a, _b + offsetB, fixed.m_window, maxLag, ranges[rangeIdx][0], ranges[rangeIdx][1], expected);
+          fixed.m_correlate(_a, _b + offsetB, fixed.m_window, maxLag, ranges[rangeIdx][0], ranges[rangeIdx][1], actual);
+
+          ++*_checks;
+          for (idx = 0; idx < lagCount; ++idx)
+            if (actual[idx] != expected[idx])
+            {
+              ++mismatches;
+              break;
+            }
+        }
+    }
+  }
+
+  return mismatches;
+}
+
+static double do_selfTestXCorrTime(const int16_t* _a, const int16_t* _b, const XCorrKernel* _kernel)
+{
+  double xcorr[2*BENCH_SELF_TEST_LAG_MAX + 1];
+  size_t repeat;
+
+  memset(xcorr, 0, sizeof(xcorr));
+
+  const uint64_t startNs = statsNowNs();
+  for (repeat = 0; repeat < BENCH_SELF_TEST_REPEAT; ++repeat)
+    _kernel->m_correlate(_a, _b + (repeat & 1), _kernel->m_window, _kernel->m_maxLag, 0, 2*_kernel->m_maxLag + 1, xcorr);
+
+  return (double)(statsNowNs() - startNs) / BENCH_SELF_TEST_REPEAT;
+}
+
+// Kernels against plain C reference: exact results on edge sizes, alignments and extreme values, then speed
+static int do_selfTest(FILE* _out)
+{
+  int16_t a[BENCH_SELF_TEST_SAMPLES + 4];
+  int16_t b[BENCH_SELF_TEST_SAMPLES + 4];
+  unsigned int seed = 1;
+  size_t checks = 0;
+  size_t mismatches;
+  size_t idx;
+
+  for (idx = 0; idx < BENCH_SELF_TEST_SAMPLES + 4; ++idx)
+  {
+    a[idx] = (int16_t)((rand_r(&seed) % 65536) - 32768);
+    b[idx] = (int16_t)((rand_r(&seed) % 65536) - 32768);
+  }
+  mismatches  = do_selfTestCheck(a, b, &checks);
+  mismatches += do_selfTestXCorr(a, b, &checks);
+
+  // saturated input, worst case for accumulators and for DC removal clamping
+  for (idx = 0; idx < BENCH_SELF_TEST_SAMPLES + 4; ++idx)
+  {
+    a[idx] = idx % 3 ? INT16_MIN : INT16_MAX;
+    b[idx] = INT16_MIN;
+  }
+  mismatches += do_selfTestCheck(a, b, &checks);
+  mismatches += do_selfTestCheck(b, b, &checks);
+  mismatches += do_selfTestXCorr(a, b, &checks);
+
+  // stereo pair spaced by 10 cm at 44.1 kHz
+  const size_t maxLag = 13;
+  XCorrKernel generic;
+  XCorrKernel selected;
+  xcorrKernelGeneric(&generic, BENCH_SELF_TEST_WINDOW, maxLag);
+  xcorrKernelSelect(&selected, BENCH_SELF_TEST_WINDOW, maxLag);
+
+  fprintf(_out, "{\n  \"kernels\": \"%s\", \"checks\": %zu, \"mismatches\": %zu,\n"
+                "  \"dot_ns_per_sample\": %.3f, \"float_reference_ns_per_sample\": %.3f,\n"
+                "  \"xcorr_kernel\": \"%s\", \"xcorr_ns_per_window\": %.1f, \"xcorr_generic_ns_per_window\": %.1f\n}\n",
+          soundKernelsName(), checks, mismatches,
+          do_selfTestTime(a, b, false), do_selfTestTime(a, b, true),
+          selected.m_name, do_selfTestXCorrTime(a, b, &selected), do_selfTestXCorrTime(a, b, &generic));
+
+  return mismatches == 0 ? EX_OK : EX_SOFTWARE;
+}
+
+// Quoted JSON string; file paths may contain anything but NUL
+static void do_printString(FILE* _out, const char* _text)
+{
+  const unsigned char* at;
+
+  fputc('"', _out);
+  for (at = (const unsigned char*)_text; *at != '\0'; ++at)
+  {
+    if (*at == '"' || *at == '\\')
+      fprintf(_out, "\\%c", *at);
+    else if (*at < 0x20)
+      fprintf(_out, "\\u%04x", *at);
+    else
+      fputc(*at, _out);
+  }
+  fputc('"', _out);
+}
+
+static void do_printLatency(FILE* _out, const char* _name, const StatsHistogram* _histogram, bool _last)
+{
+  fprintf(_out, "        \"%s\": { \"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"max\": %.1f }%s\n",
+          _name,
+          statsPercentileNs(_histogram, 500) / 1000.0,
+          statsPercentileNs(_histogram, 900) / 1000.0,
+          statsPercentileNs(_histogram, 990) / 1000.0,
+          _histogram->m_maxNs / 1000.0,
+          _last ? "" : ",");
+}
+
+static void do_printResult(FILE* _out, const BenchConfig* _config, const TargetDetectParams* _params,
+                           const BenchResult* _result, bool _first)
+{
+  const double audioSeconds = (double)_result->m_audioFrames / _config->m_rate;
+
+  fprintf(_out, "%s    {\n", _first ? "" : ",\n");
+  fprintf(_out, "      \"backend\": \"cpu\", \"alg\": \"%s\", \"xcorr_kernel\": \"%s\",\n",
+          do_algorithmName(_params->m_algorithm), _result->m_xcorrKernel);
+  fprintf(_out, "      \"window_size\": %u, \"num_samples\": %u, \"hop\": %u, \"workers\": %zu, \"steals\": %lu,\n",
+          _params->m_windowSize, _params->m_numSamples, _params->m_hopSize, _result->m_workers, _result->m_steals);
+  fprintf(_out, "      \"track\": %u, \"track_confidence\": %u, \"narrow_frames\": %lld,\n",
+          _params->m_trackGain, _params->m_trackConfidence, _result->m_narrowFrames);
+  fprintf(_out, "      \"frames\": %u, \"wall_s\": %.6f, \"frames_per_s\": %.2f, \"realtime_factor\": %.2f,\n",
+          _config->m_frames, _result->m_wallSeconds,
+          _result->m_wallSeconds > 0 ? _config->m_frames / _result->m_wallSeconds : 0.0,
+          _result->m_wallSeconds > 0 ? audioSeconds / _result->m_wallSeconds : 0.0);
+  fprintf(_out, "      \"cpu_user_s\": %.6f, \"cpu_system_s\": %.6f, \"peak_rss_kb\": %ld, \"last_angle\": %d,\n",
+          _result->m_userSeconds, _result->m_systemSeconds, _result->m_peakRssKb, _result->m_lastAngle);
+  fprintf(_out, "      \"latency_us\": {\n");
+  do_printLatency(_out, "frame",   &_result->m_stats.m_stages[STATS_STAGE_FRAME],        false);
+  do_printLatency(_out, "process", &_result->m_stats.m_stages[STATS_STAGE_PROCESS],      false);
+  do_printLatency(_out, "read",    &_result->m_stats.m_stages[STATS_STAGE_CAPTURE_WAIT], false);
+  do_printLatency(_out, "pack",    &_result->m_stats.m_stages[STATS_STAGE_PACK],         true);
+  fprintf(_out, "      }\n");
+  fprintf(_out, "    }");
+}
+
+
+
+
+int main(int _argc, char* const _argv[])
+{
+  int res = 0;
+  int exit_code = EX_OK;
+  const char* outputPath = NULL;
+  FILE* out = stdout;
+  char synthPath[64];
+  const char* path;
+  size_t windowIdx, samplesIdx, hopIdx, algIdx, workersIdx, trackIdx;
+  bool first = true;
+  BenchResult result;
+  BenchConfig config = {
+    .m_filePath = NULL,
+    .m_fileRaw = false,
+    .m_rate = 44100,
+    .m_channels = 2,
+    .m_micGeometry = NULL,
+    .m_synthDelay = 5,
+    .m_synthAngle = 0,
+    .m_frames = 500,
+    .m_warmupFrames = 20,
+    .m_micDistance = 100,
+    .m_volumeCoefficient = 100,
+    .m_trackConfidence = 30,
+    .m_selfTest = false,
+    .m_windowSizes = { { 0 }, 1 },
+    .m_numSamples = { { 2048 }, 1 },
+    .m_hopSizes = { { 0 }, 1 },
+    .m_algorithms = { { TARGET_DETECT_ALGORITHM_XCORR, TARGET_DETECT_ALGORITHM_GCC_PHAT }, 2 },
+    .m_workers = { { 0 }, 1 },
+    .m_trackGains = { { 0 }, 1 }
+  };
+
+  if (!do_parseArgs(&config, _argc, _argv, &outputPath))
+  {
+    do_helpMessage(_argv[0]);
+    return EX_USAGE;
+  }
+
+  if (config.m_selfTest)
+    return do_selfTest(stdout);
+
+  if (config.m_filePath != NULL)
+    path = config.m_filePath;
+  else if ((res = do_synthesize(&config, synthPath, sizeof(synthPath))) == 0)
+    path = synthPath;
+  else
+  {
+    fprintf(stderr, "do_synthesize() failed: %d\n", res);
+    return EX_CANTCREAT;
+  }
+
+  if (outputPath != NULL && (out = fopen(outputPath, "w")) == NULL)
+  {
+    fprintf(stderr, "fopen(%s) failed: %d\n", outputPath, errno);
+    exit_code = EX_CANTCREAT;
+    goto exit_unlink;
+  }
+
+  fprintf(out, "{\n  \"kernels\": \"%s\", \"rate\": %u, \"channels\": %u, \"source\": ",
+          soundKernelsName(), config.m_rate, config.m_channels);
+  do_printString(out, config.m_filePath != NULL ? config.m_filePath : "synthetic");
+  fprintf(out, ",\n  \"runs\": [\n");
+
+  for (trackIdx = 0; trackIdx < config.m_trackGains.m_count; ++trackIdx)
+    for (workersIdx = 0; workersIdx < config.m_workers.m_count; ++workersIdx)
+      for (algIdx = 0; algIdx < config.m_algorithms.m_count; ++algIdx)
+        for (samplesIdx = 0; samplesIdx < config.m_numSamples.m_count; ++samplesIdx)
+          for (windowIdx = 0; windowIdx < config.m_windowSizes.m_count; ++windowIdx)
+            for (hopIdx = 0; hopIdx < config.m_hopSizes.m_count; ++hopIdx)
+            {
+              const unsigned int workers = config.m_workers.m_values[workersIdx];
+              TargetDetectParams params;
+              params.m_volumeCoefficient = config.m_volumeCoefficient;
+              params.m_micDistance       = config.m_micDistance;
+              params.m_windowSize        = config.m_windowSizes.m_values[windowIdx];
+              params.m_numSamples        = config.m_numSamples.m_values[samplesIdx];
+              params.m_hopSize           = config.m_hopSizes.m_values[hopIdx];
+              params.m_algorithm         = config.m_algorithms.m_values[algIdx];
+              params.m_gateThreshold     = 0;
+              params.m_gateHysteresis    = 0;
+              params.m_trackGain         = config.m_trackGains.m_values[trackIdx];
+              params.m_trackConfidence   = config.m_trackConfidence;
+
+              fprintf(stderr, "bench: %s window=%u samples=%u hop=%u workers=%u track=%u\n", do_algorithmName(params.m_algorithm),
+                      params.m_windowSize, params.m_numSamples, params.m_hopSize, workers, params.m_trackGain);
+
+              res = params.m_numSamples == 0 || workers > WORKER_POOL_SIZE_MAX ? EINVAL
+                                                                               : do_run(&config, path, &params, workers, &result);
+              if (res != 0)
+              {
+                fprintf(stderr, "bench run failed: %d\n", res);
+                exit_code = EX_SOFTWARE;
+                continue;
+              }
+
+              do_printResult(out, &config, &params, &result, first);
+              first = false;
+            }
+
+  fprintf(out, "\n  ]\n}\n");
+
+  if (out != stdout)
+    fclose(out);
+
+ exit_unlink:
+  if (config.m_filePath == NULL)
+    unlink(synthPath);
+
+  return exit_code;
+}
@@ -6,30 +6,76 @@
 #include <sysexits.h>
 #include <errno.h>
 #include <signal.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/signalfd.h>
 
 #include "internal/runtime.h"
 
-static sig_atomic_t s_signalTerminate = false;
-static void sigterm_action(int _signal, siginfo_t* _siginfo, void* _context)
+// Termination and stats dump signals are blocked in all threads and delivered through signalfd to main
+static int sigactions_setup()
 {
-  (void)_signal;
-  (void)_siginfo;
-  (void)_context;
-  s_signalTerminate = true;
+  int res;
+  int signalFd;
+  sigset_t signals;
+
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGTERM);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGUSR1);
+
+  if ((res = pthread_sigmask(SIG_BLOCK, &signals, NULL)) != 0)
+  {
+    fprintf(stderr, "pthread_sigmask() failed: %d\n", res);
+    return -1;
+  }
+
+  if ((signalFd = signalfd(-1, &signals, SFD_NONBLOCK|SFD_CLOEXEC)) < 0)
+  {
+    fprintf(stderr, "signalfd() failed: %d\n", errno);
+    return -1;
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+
+  return signalFd;
 }
-static void sigactions_setup()
+
+// Sleeps until termination signal or until runtime terminates by itself
+static void wait_terminate(Runtime* _runtime, int _signalFd)
 {
-  struct sigaction action;
-  memset(&action, 0, sizeof(action));
-  action.sa_sigaction = &sigterm_action;
-  action.sa_flags = SA_SIGINFO|SA_RESTART;
+  int res;
+  struct pollfd fds[2];
+  struct signalfd_siginfo siginfo;
 
-  if (sigaction(SIGTERM, &action, NULL) != 0)
-    fprintf(stderr, "sigaction(SIGTERM) failed: %d\n", errno);
-  if (sigaction(SIGINT,  &action, NULL) != 0)
-    fprintf(stderr, "sigaction(SIGINT) failed: %d\n", errno);
+  fds[0].fd     = _signalFd;
+  fds[0].events = POLLIN;
+  fds[1].fd     = runtimeGetTerminateFd(_runtime);
+  fds[1].events = POLLIN;
 
-  signal(SIGPIPE, SIG_IGN);
+  while (!runtimeGetTerminate(_runtime))
+  {
+    if (poll(fds, 2, -1) < 0)
+    {
+      res = errno;
+      if (res == EINTR)
+        continue;
+      fprintf(stderr, "poll() failed: %d\n", res);
+      return;
+    }
+
+    if ((fds[0].revents & POLLIN) && read(_signalFd, &siginfo, sizeof(siginfo)) == sizeof(siginfo))
+    {
+      if (siginfo.ssi_signo == SIGUSR1)
+      {
+        statsReport(runtimeModStats(_runtime));
+        continue;
+      }
+
+      printf("Got signal %u\n", siginfo.ssi_signo);
+      return;
+    }
+  }
 }
 
 int main(int _argc, char* const _argv[])
@@ -38,22 +84,27 @@ int main(int _argc, char* const _argv[])
   int exit_code = EX_OK;
   Runtime runtime;
   const char* arg0 = _argv[0];
+  int signalFd;
 
-  sigactions_setup();
+  if ((signalFd = sigactions_setup()) < 0)
+  {
+    exit_code = EX_OSERR;
+    goto exit;
+  }
 
   runtimeReset(&runtime);
   if (!runtimeParseArgs(&runtime, _argc, _argv))
   {
     runtimeArgsHelpMessage(&runtime, arg0);
     exit_code = EX_USAGE;
-    goto exit;
+    goto exit_close_signalfd;
   }
 
   if ((res = runtimeInit(&runtime)) != 0)
   {
     fprintf(stderr, "runtimeInit() failed: %d\n", res);
     exit_code = EX_SOFTWARE;
-    goto exit;
+    goto exit_close_signalfd;
   }
 
   if ((res = runtimeStart(&runtime)) != 0)
@@ -64,8 +115,7 @@ int main(int _argc, char* const _argv[])
   }
 
   printf("Running\n");
-  while (!s_signalTerminate && !runtimeGetTerminate(&runtime))
-    sleep(1);
+  wait_terminate(&runtime, signalFd);
   printf("Terminating\n");
 
 
@@ -77,6 +127,9 @@ int main(int _argc, char* const _argv[])
   if ((res = runtimeFini(&runtime)) != 0)
     fprintf(stderr, "runtimeStop() failed: %d\n", res);
 
+ exit_close_signalfd:
+  close(signalFd);
+
  exit:
   return exit_code;
 }
@@ -0,0 +1,277 @@
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <errno.h>
+
+#include "internal/mic_array.h"
+
+
+#define MIC_ARRAY_SOUND_SPEED 343.0 // m/s
+
+
+static int do_parseCircle(MicArrayGeometry* _geometry, const char* _arg, size_t _channels)
+{
+  char* end;
+  size_t idx;
+
+  const long radius = strtol(_arg, &end, 10);
+  if (end == _arg || *end != '\0' || radius <= 0)
+    return EINVAL;
+
+  for (idx = 0; idx < _channels; ++idx)
+  {
+    const double angle = 2.0 * M_PI * idx / _channels;
+    _geometry->m_x[idx] = (int)lround(radius * sin(angle));
+    _geometry->m_y[idx] = (int)lround(radius * cos(angle));
+  }
+  _geometry->m_count = _channels;
+
+  return 0;
+}
+
+static int do_parseList(MicArrayGeometry* _geometry, const char* _arg, size_t _channels)
+{
+  const char* pos = _arg;
+  size_t count = 0;
+
+  while (*pos != '\0')
+  {
+    char* end;
+
+    if (count >= TARGET_CHANNELS_MAX)
+      return EINVAL;
+
+    _geometry->m_x[count] = strtol(pos, &end, 10);
+    if (end == pos || *end != ',')
+      return EINVAL;
+    pos = end + 1;
+
+    _geometry->m_y[count] = strtol(pos, &end, 10);
+    if (end == pos || (*end != ';' && *end != '\0'))
+      return EINVAL;
+    pos = *end == ';' ? end + 1 : end;
+
+    ++count;
+  }
+
+  if (count != _channels)
+  {
+    fprintf(stderr, "Microphone geometry has %zu positions for %zu channels\n", count, _channels);
+    return EINVAL;
+  }
+  _geometry->m_count = count;
+
+  return 0;
+}
+
+// Far field delay of second microphone against first along unit direction, in samples per unit
+static void do_setupPair(MicArrayPair* _pair, size_t _first, size_t _second,
+                         const double* _x, const double* _y, unsigned int _rate)
+{
+  const double scale = _rate / (1000.0 * MIC_ARRAY_SOUND_SPEED);
+  const double dx = _x[_first] - _x[_second];
+  const double dy = _y[_first] - _y[_second];
+
+  _pair->m_first  = _first;
+  _pair->m_second = _second;
+  _pair->m_delayX = dx * scale;
+  _pair->m_delayY = dy * scale;
+  _pair->m_maxLag = (size_t)ceil(sqrt(dx*dx + dy*dy) * scale);
+}
+
+static int do_axisBearing(const MicArray* _array, double _axisX, double _axisY,
+                          const double* _lags, const double* _weights)
+{
+  double num = 0.0;
+  double den = 0.0;
+  size_t idx;
+
+  for (idx = 0; idx < _array->m_pairCount; ++idx)
+  {
+    const MicArrayPair* pair = &_array->m_pairs[idx];
+    const double delay = pair->m_delayX * _axisX + pair->m_delayY * _axisY;
+    num += _weights[idx] * delay * _lags[idx];
+    den += _weights[idx] * delay * delay;
+  }
+
+  double sine = den > 0.0 ? num / den : 0.0;
+  if (sine > 1.0)
+    sine = 1.0;
+  else if (sine < -1.0)
+    sine = -1.0;
+
+  // normal to the axis pointing to front half-plane, or to the right for array along y
+  double normalX = -_axisY;
+  double normalY = _axisX;
+  if (normalY < 0.0 || (normalY == 0.0 && normalX < 0.0))
+  {
+    normalX = -normalX;
+    normalY = -normalY;
+  }
+
+  const double cosine = sqrt(1.0 - sine*sine);
+  const double ux = sine * _axisX + cosine * normalX;
+  const double uy = sine * _axisY + cosine * normalY;
+
+  return (int)lround(atan2(ux, uy) * 180.0 / M_PI);
+}
+
+
+
+
+int micArrayParseGeometry(MicArrayGeometry* _geometry, const char* _spec, size_t _channels)
+{
+  if (_geometry == NULL || _channels > TARGET_CHANNELS_MAX)
+    return EINVAL;
+
+  memset(_geometry, 0, sizeof(*_geometry));
+
+  if (_spec == NULL || *_spec == '\0')
+  {
+    if (_channels == 2)
+      return 0;
+
+    fprintf(stderr, "%zu channel input needs microphone geometry\n", _channels);
+    return EINVAL;
+  }
+
+  if (_channels < 2)
+  {
+    fprintf(stderr, "Microphone array needs at least 2 channels, got %zu\n", _channels);
+    return EINVAL;
+  }
+
+  if (!strncasecmp(_spec, "circle:", 7))
+    return do_parseCircle(_geometry, _spec + 7, _channels);
+
+  return do_parseList(_geometry, _spec, _channels);
+}
+
+int micArraySetup(MicArray* _array, const MicArrayGeometry* _geometry, unsigned int _micDistance, unsigned int _rate)
+{
+  double x[TARGET_CHANNELS_MAX];
+  double y[TARGET_CHANNELS_MAX];
+  size_t first;
+  size_t second;
+
+  if (_array == NULL || _geometry == NULL || _rate == 0)
+    return EINVAL;
+
+  memset(_array, 0, sizeof(*_array));
+
+  if (_geometry->m_count == 0)
+  {
+    _array->m_channels = 2;
+    x[0] = -(double)_micDistance / 2.0;
+    x[1] =  (double)_micDistance / 2.0;
+    y[0] = y[1] = 0.0;
+  }
+  else
+  {
+    _array->m_channels = _geometry->m_count;
+    for (first = 0; first < _geometry->m_count; ++first)
+    {
+      x[first] = _geometry->m_x[first];
+      y[first] = _geometry->m_y[first];
+    }
+  }
+
+  // normal matrix of unweighted fit tells whether array resolves both coordinates
+  double sxx = 0.0, sxy = 0.0, syy = 0.0;
+  double longest = 0.0;
+  for (first = 0; first < _array->m_channels; ++first)
+    for (second = first + 1; second < _array->m_channels; ++second)
+    {
+      MicArrayPair* pair = &_array->m_pairs[_array->m_pairCount++];
+      do_setupPair(pair, first, second, x, y, _rate);
+
+      if (pair->m_maxLag > _array->m_maxLag)
+        _array->m_maxLag = pair->m_maxLag;
+
+      sxx += pair->m_delayX * pair->m_delayX;
+      sxy += pair->m_delayX * pair->m_delayY;
+      syy += pair->m_delayY * pair->m_delayY;
+
+      const double length = hypot(pair->m_delayX, pair->m_delayY);
+      if (length > longest)
+      {
+        longest = length;
+        _array->m_axisX = -pair->m_delayX / length;
+        _array->m_axisY = -pair->m_delayY / length;
+      }
+    }
+
+  const double trace = sxx + syy;
+  _array->m_planar = trace > 0.0 && sxx*syy - sxy*sxy > 1e-6 * trace * trace;
+
+  return 0;
+}
+
+int micArrayBearing(const MicArray* _array, const double* _lags, const double* _weights, int* _angle)
+{
+  size_t idx;
+
+  if (_array == NULL || _lags == NULL || _weights == NULL || _angle == NULL)
+    return EINVAL;
+  if (_array->m_pairCount == 0)
+    return ENODATA;
+
+  if (!_array->m_planar)
+  {
+    *_angle = do_axisBearing(_array, _array->m_axisX, _array->m_axisY, _lags, _weights);
+    return 0;
+  }
+
+  // weighted least squares for direction vector v: sum of w * (delay . v - lag)^2 is minimal
+  double sxx = 0.0, sxy = 0.0, syy = 0.0, bx = 0.0, by = 0.0;
+  for (idx = 0; idx < _array->m_pairCount; ++idx)
+  {
+    const MicArrayPair* pair = &_array->m_pairs[idx];
+    const double weight = _weights[idx];
+    sxx += weight * pair->m_delayX * pair->m_delayX;
+    sxy += weight * pair->m_delayX * pair->m_delayY;
+    syy += weight * pair->m_delayY * pair->m_delayY;
+    bx  += weight * pair->m_delayX * _lags[idx];
+    by  += weight * pair->m_delayY * _lags[idx];
+  }
+
+  const double trace = sxx + syy;
+  if (trace <= 0.0)
+    return ENODATA;
+
+  // too few usable pairs left to tell both coordinates, resolve along the most trusted one
+  const double det = sxx*syy - sxy*sxy;
+  if (det <= 1e-6 * trace * trace)
+  {
+    size_t best = 0;
+    for (idx = 1; idx < _array->m_pairCount; ++idx)
+      if (  _weights[idx] * hypot(_array->m_pairs[idx].m_delayX, _array->m_pairs[idx].m_delayY)
+          > _weights[best] * hypot(_array->m_pairs[best].m_delayX, _array->m_pairs[best].m_delayY))
+        best = idx;
+
+    const double length = hypot(_array->m_pairs[best].m_delayX, _array->m_pairs[best].m_delayY);
+    *_angle = do_axisBearing(_array, -_array->m_pairs[best].m_delayX / length,
+                             -_array->m_pairs[best].m_delayY / length, _lags, _weights);
+    return 0;
+  }
+
+  const double vx = (syy*bx - sxy*by) / det;
+  const double vy = (sxx*by - sxy*bx) / det;
+  *_angle = (int)lround(atan2(vx, vy) * 180.0 / M_PI);
+
+  return 0;
+}
+
+double micArrayPairLag(const MicArray* _array, size_t _pair, double _angle)
+{
+  if (_array == NULL || _pair >= _array->m_pairCount)
+    return 0.0;
+
+  const MicArrayPair* pair = &_array->m_pairs[_pair];
+  const double radians = _angle * M_PI / 180.0;
+
+  return pair->m_delayX * sin(radians) + pair->m_delayY * cos(radians);
+}
@@ -0,0 +1,555 @@
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <errno.h>
+
+#include <alsa/asoundlib.h>
+
+#include "internal/module_alsa.h"
+
+
+static bool s_verbose = false;
+
+
+static snd_pcm_format_t do_pcmFormat(AlsaFormat _format)
+{
+  return _format == ALSA_FORMAT_S32_LE ? SND_PCM_FORMAT_S32_LE : SND_PCM_FORMAT_S16_LE;
+}
+
+static int do_alsaInputOpen(AlsaInput* _alsa, const char* _path)
+{
+  int err;
+
+  if (_alsa == NULL || _path == NULL)
+    return EINVAL;
+
+  if ((err = snd_pcm_open(&_alsa->m_handle, _path, SND_PCM_STREAM_CAPTURE, 0)) < 0)
+  {
+    fprintf(stderr, "snd_pcm_open(%s) failed: %s (%d)\n", _path, snd_strerror(err), err);
+    _alsa->m_handle = NULL;
+    return -err;
+  }
+
+  return 0;
+}
+
+static int do_alsaInputClose(AlsaInput* _alsa)
+{
+  int err;
+
+  if (_alsa == NULL)
+    return EINVAL;
+
+  if ((err = snd_pcm_close(_alsa->m_handle)) < 0)
+  {
+    fprintf(stderr, "snd_pcm_close() failed: %s (%d)\n", snd_strerror(err), err);
+    _alsa->m_handle = NULL;
+    return -err;
+  }
+  _alsa->m_handle = NULL;
+
+  return 0;
+}
+
+static int do_alsaInputSetFormat(AlsaInput* _alsa, const AlsaConfig* _config)
+{
+  int err;
+  int res = 0;
+  snd_pcm_hw_params_t* hwParams;
+  const snd_pcm_access_t access = _config->m_mmap ? SND_PCM_ACCESS_MMAP_INTERLEAVED
+                                                  : SND_PCM_ACCESS_RW_INTERLEAVED;
+
+  if ((err = snd_pcm_hw_params_malloc(&hwParams)) < 0)
+  {
+    fprintf(stderr, "snd_pcm_hw_params_malloc() failed: %s (%d)\n", snd_strerror(err), err);
+    return -err;
+  }
+
+  if ((err = snd_pcm_hw_params_any(_alsa->m_handle, hwParams)) < 0)
+  {
+    fprintf(stderr, "snd_pcm_hw_params_any() failed: %s (%d)\n", snd_strerror(err), err);
+    res = -err;
+    goto exit_free;
+  }
+
+  if ((err = snd_pcm_hw_params_set_access(_alsa->m_handle, hwParams, access)) < 0)
+  {
+    fprintf(stderr, "snd_pcm_hw_params_set_access(%s) failed: %s (%d)\n",
+            _config->m_mmap ? "mmap" : "rw", snd_strerror(err), err);
+    res = -err;
+    goto exit_free;
+  }
+
+  if ((err = snd_pcm_hw_params_set_format(_alsa->m_handle, hwParams, do_pcmFormat(_config->m_format))) < 0)
+  {
+    fprintf(stderr, "snd_pcm_hw_params_set_format(%s) failed: %s (%d)\n",
+            snd_pcm_format_name(do_pcmFormat(_config->m_format)), snd_strerror(err), err);
+    res = -err;
+    goto exit_free;
+  }
+
+  _alsa->m_rate = _config->m_rate;
+  if ((err = snd_pcm_hw_params_set_rate_near(_alsa->m_handle, hwParams, &_alsa->m_rate, 0)) < 0)
+  {
+    fprintf(stderr, "snd_pcm_hw_params_set_rate_near(%u) failed: %s (%d)\n",
+            _config->m_rate, snd_strerror(err), err);
+    res = -err;
+    goto exit_free;
+  }
+
+  _alsa->m_channels = _config->m_channels;
+  if ((err = snd_pcm_hw_params_set_channels(_alsa->m_handle, hwParams, _alsa->m_channels)) < 0)
+  {
+    fprintf(stderr, "snd_pcm_hw_params_set_channels(%u) failed: %s (%d)\n",
+            _config->m_channels, snd_strerror(err), err);
+    res = -err;
+    goto exit_free;
+  }
+
+  if (_config->m_periodFrames != 0)
+  {
+    snd_pcm_uframes_t periodFrames = _config->m_periodFrames;
+    if ((err = snd_pcm_hw_params_set_period_size_near(_alsa->m_handle, hwParams, &periodFrames, 0)) < 0)
+    {
+      fprintf(stderr, "snd_pcm_hw_params_set_period_size_near(%zu) failed: %s (%d)\n",
+              _config->m_periodFrames, snd_strerror(err), err);
+      res = -err;
+      goto exit_free;
+    }
+  }
+
+  if (_config->m_periods != 0)
+  {
+    unsigned int periods = _config->m_periods;
+    if ((err = snd_pcm_hw_params_set_periods_near(_alsa->m_handle, hwParams, &periods, 0)) < 0)
+    {
+      fprintf(stderr, "snd_pcm_hw_params_set_periods_near(%u) failed: %s (%d)\n",
+              _config->m_periods, snd_strerror(err), err);
+      res = -err;
+      goto exit_free;
+    }
+  }
+
+  if ((err = snd_pcm_hw_params(_alsa->m_handle, hwParams)) < 0)
+  {
+    fprintf(stderr, "snd_pcm_hw_params() failed: %s (%d)\n", snd_strerror(err), err);
+    res = -err;
+    goto exit_free;
+  }
+
+  snd_pcm_uframes_t periodFrames;
+  snd_pcm_uframes_t bufferFrames;
+  snd_pcm_hw_params_get_period_size(hwParams, &periodFrames, NULL);
+  snd_pcm_hw_params_get_buffer_size(hwParams, &bufferFrames);
+
+  _alsa->m_mmap         = _config->m_mmap;
+  _alsa->m_format       = _config->m_format;
+  _alsa->m_frameSize    = _alsa->m_channels * sizeof(int16_t);
+  _alsa->m_hwFrameSize  = _alsa->m_channels * (_alsa->m_format == ALSA_FORMAT_S32_LE ? sizeof(int32_t) : sizeof(int16_t));
+  _alsa->m_periodFrames = periodFrames;
+  _alsa->m_bufferFrames = bufferFrames;
+
+  if (s_verbose)
+    fprintf(stderr, "ALSA capture %u Hz, %u channels, %s, %s access, period %zu, buffer %zu frames\n",
+            _alsa->m_rate, _alsa->m_channels, snd_pcm_format_name(do_pcmFormat(_alsa->m_format)),
+            _alsa->m_mmap ? "mmap" : "rw", _alsa->m_periodFrames, _alsa->m_bufferFrames);
+
+ exit_free:
+  snd_pcm_hw_params_free(hwParams);
+  return res;
+}
+
+static int do_alsaInputSetSwParams(AlsaInput* _alsa, const AlsaConfig* _config)
+{
+  int err;
+  int res = 0;
+  snd_pcm_sw_params_t* swParams;
+
+  if ((err = snd_pcm_sw_params_malloc(&swParams)) < 0)
+  {
+    fprintf(stderr, "snd_pcm_sw_params_malloc() failed: %s (%d)\n", snd_strerror(err), err);
+    return -err;
+  }
+
+  if ((err = snd_pcm_sw_params_current(_alsa->m_handle, swParams)) < 0)
+  {
+    fprintf(stderr, "snd_pcm_sw_params_current() failed: %s (%d)\n", snd_strerror(err), err);
+    res = -err;
+    goto exit_free;
+  }
+
+  const snd_pcm_uframes_t availMin = _config->m_availMin != 0 ? _config->m_availMin : _alsa->m_periodFrames;
+  if ((err = snd_pcm_sw_params_set_avail_min(_alsa->m_handle, swParams, availMin)) < 0)
+  {
+    fprintf(stderr, "snd_pcm_sw_params_set_avail_min(%lu) failed: %s (%d)\n", availMin, snd_strerror(err), err);
+    res = -err;
+    goto exit_free;
+  }
+
+  if (   _config->m_startThreshold != 0
+      && (err = snd_pcm_sw_params_set_start_threshold(_alsa->m_handle, swParams, _config->m_startThreshold)) < 0)
+  {
+    fprintf(stderr, "snd_pcm_sw_params_set_start_threshold(%zu) failed: %s (%d)\n",
+            _config->m_startThreshold, snd_strerror(err), err);
+    res = -err;
+    goto exit_free;
+  }
+
+  if ((err = snd_pcm_sw_params(_alsa->m_handle, swParams)) < 0)
+  {
+    fprintf(stderr, "snd_pcm_sw_params() failed: %s (%d)\n", snd_strerror(err), err);
+    res = -err;
+    goto exit_free;
+  }
+
+ exit_free:
+  snd_pcm_sw_params_free(swParams);
+  return res;
+}
+
+static int do_alsaInputUnsetFormat(AlsaInput* _alsa)
+{
+  if (_alsa == NULL)
+    return EINVAL;
+
+  free(_alsa->m_convertBuffer);
+  _alsa->m_convertBuffer = NULL;
+
+  _alsa->m_rate = 0;
+  _alsa->m_channels = 0;
+  _alsa->m_frameSize = 0;
+  _alsa->m_hwFrameSize = 0;
+  _alsa->m_periodFrames = 0;
+  _alsa->m_bufferFrames = 0;
+  _alsa->m_mmap = false;
+
+  return 0;
+}
+
+// Device samples to S16 interleaved
+static void do_alsaInputConvert(const AlsaInput* _alsa, char* _dstPtr, const char* _srcPtr, size_t _frames)
+{
+  size_t idx;
+
+  if (_alsa->m_format == ALSA_FORMAT_S16_LE)
+  {
+    memcpy(_dstPtr, _srcPtr, _frames * _alsa->m_frameSize);
+    return;
+  }
+
+  const int32_t* src = (const int32_t*)_srcPtr;
+  int16_t* dst = (int16_t*)_dstPtr;
+  for (idx = 0; idx < _frames * _alsa->m_channels; ++idx)
+    dst[idx] = src[idx] >> 16;
+}
+
+static int do_alsaInputStart(AlsaInput* _alsa)
+{
+  int err;
+
+  if ((err = snd_pcm_prepare(_alsa->m_handle)) < 0)
+  {
+    fprintf(stderr, "snd_pcm_prepare() failed: %s (%d)\n", snd_strerror(err), err);
+    return -err;
+  }
+
+  if ((err = snd_pcm_start(_alsa->m_handle)) < 0)
+  {
+    fprintf(stderr, "snd_pcm_start() failed: %s (%d)\n", snd_strerror(err), err);
+    return -err;
+  }
+
+  return 0;
+}
+
+static int do_alsaInputStop(AlsaInput* _alsa)
+{
+  int err;
+
+  if ((err = snd_pcm_drop(_alsa->m_handle)) < 0)
+  {
+    fprintf(stderr, "snd_pcm_drop() failed: %s (%d)\n", snd_strerror(err), err);
+    return -err;
+  }
+
+  return 0;
+}
+
+static int do_alsaInputRecover(AlsaInput* _alsa, int _err)
+{
+  int err;
+
+  if (_err == -EPIPE)
+  {
+    ++_alsa->m_xrunCounter;
+    if (s_verbose)
+      fprintf(stderr, "ALSA capture overrun, restarting\n");
+  }
+  else
+    fprintf(stderr, "ALSA capture failed: %s (%d), recovering\n", snd_strerror(_err), _err);
+
+  if ((err = snd_pcm_recover(_alsa->m_handle, _err, 1)) < 0)
+  {
+    fprintf(stderr, "snd_pcm_recover() failed: %s (%d)\n", snd_strerror(err), err);
+    return -err;
+  }
+
+  // in mmap mode nobody restarts capture implicitly
+  if (_alsa->m_mmap && (err = snd_pcm_start(_alsa->m_handle)) < 0)
+  {
+    fprintf(stderr, "snd_pcm_start() failed: %s (%d)\n", snd_strerror(err), err);
+    return -err;
+  }
+
+  return 0;
+}
+
+static int do_alsaInputReadRW(AlsaInput* _alsa, char* _dstPtr, size_t _frames)
+{
+  int res;
+
+  while (_frames > 0)
+  {
+    // other formats go through one period sized bounce buffer
+    const bool convert = _alsa->m_convertBuffer != NULL;
+    const size_t chunk = convert && _frames > _alsa->m_periodFrames ? _alsa->m_periodFrames : _frames;
+    const snd_pcm_sframes_t frames = snd_pcm_readi(_alsa->m_handle, convert ? _alsa->m_convertBuffer : _dstPtr, chunk);
+    if (frames < 0)
+    {
+      if ((res = do_alsaInputRecover(_alsa, frames)) != 0)
+        return res;
+      continue;
+    }
+
+    if (convert)
+      do_alsaInputConvert(_alsa, _dstPtr, _alsa->m_convertBuffer, frames);
+
+    _dstPtr += frames * _alsa->m_frameSize;
+    _frames -= frames;
+  }
+
+  return 0;
+}
+
+static int do_alsaInputReadMmap(AlsaInput* _alsa, char* _dstPtr, size_t _frames)
+{
+  int err;
+  int res;
+
+  while (_frames > 0)
+  {
+    const snd_pcm_sframes_t avail = snd_pcm_avail_update(_alsa->m_handle);
+    if (avail < 0)
+    {
+      if ((res = do_alsaInputRecover(_alsa, avail)) != 0)
+        return res;
+      continue;
+    }
+
+    if (avail == 0)
+    {
+      if ((err = snd_pcm_wait(_alsa->m_handle, 1000)) < 0)
+      {
+        if ((res = do_alsaInputRecover(_alsa, err)) != 0)
+          return res;
+      }
+      continue;
+    }
+
+    const snd_pcm_channel_area_t* areas;
+    snd_pcm_uframes_t offset;
+    snd_pcm_uframes_t frames = _frames;
+    if ((err = snd_pcm_mmap_begin(_alsa->m_handle, &areas, &offset, &frames)) < 0)
+    {
+      if ((res = do_alsaInputRecover(_alsa, err)) != 0)
+        return res;
+      continue;
+    }
+
+    // interleaved access - single area describes all channels
+    const char* srcPtr = (const char*)areas[0].addr + areas[0].first/8 + offset*(areas[0].step/8);
+    do_alsaInputConvert(_alsa, _dstPtr, srcPtr, frames);
+
+    const snd_pcm_sframes_t committed = snd_pcm_mmap_commit(_alsa->m_handle, offset, frames);
+    if (committed < 0 || (snd_pcm_uframes_t)committed != frames)
+    {
+      if ((res = do_alsaInputRecover(_alsa, committed < 0 ? committed : -EPIPE)) != 0)
+        return res;
+      continue;
+    }
+
+    _dstPtr += frames * _alsa->m_frameSize;
+    _frames -= frames;
+  }
+
+  return 0;
+}
+
+
+
+
+int alsaInputInit(bool _verbose)
+{
+  s_verbose = _verbose;
+  return 0;
+}
+
+int alsaInputFini()
+{
+  return 0;
+}
+
+int alsaInputOpen(AlsaInput* _alsa, const AlsaConfig* _config)
+{
+  int res = 0;
+
+  if (_alsa == NULL || _config == NULL)
+    return EINVAL;
+  if (_alsa->m_handle != NULL)
+    return EALREADY;
+
+  res = do_alsaInputOpen(_alsa, _config->m_path);
+  if (res != 0)
+    goto exit;
+
+  res = do_alsaInputSetFormat(_alsa, _config);
+  if (res != 0)
+    goto exit_close;
+
+  res = do_alsaInputSetSwParams(_alsa, _config);
+  if (res != 0)
+    goto exit_unset_format;
+
+  if (   !_alsa->m_mmap && _alsa->m_format != ALSA_FORMAT_S16_LE
+      && (_alsa->m_convertBuffer = malloc(_alsa->m_periodFrames * _alsa->m_hwFrameSize)) == NULL)
+  {
+    res = ENOMEM;
+    goto exit_unset_format;
+  }
+
+  return 0;
+
+
+ exit_unset_format:
+  do_alsaInputUnsetFormat(_alsa);
+ exit_close:
+  do_alsaInputClose(_alsa);
+ exit:
+  return res;
+}
+
+int alsaInputClose(AlsaInput* _alsa)
+{
+  if (_alsa == NULL)
+    return EINVAL;
+  if (_alsa->m_handle == NULL)
+    return EALREADY;
+
+  do_alsaInputUnsetFormat(_alsa);
+  do_alsaInputClose(_alsa);
+
+  return 0;
+}
+
+int alsaInputStart(AlsaInput* _alsa)
+{
+  if (_alsa == NULL)
+    return EINVAL;
+  if (_alsa->m_handle == NULL)
+    return ENOTCONN;
+
+  _alsa->m_xrunCounter = 0;
+
+  return do_alsaInputStart(_alsa);
+}
+
+int alsaInputStop(AlsaInput* _alsa)
+{
+  if (_alsa == NULL)
+    return EINVAL;
+  if (_alsa->m_handle == NULL)
+    return ENOTCONN;
+
+  return do_alsaInputStop(_alsa);
+}
+
+int alsaInputGetFrameSize(const AlsaInput* _alsa, size_t* _frameSize)
+{
+  if (_alsa == NULL || _frameSize == NULL)
+    return EINVAL;
+  if (_alsa->m_handle == NULL)
+    return ENOTCONN;
+
+  *_frameSize = _alsa->m_frameSize;
+
+  return 0;
+}
+
+int alsaInputReadFrames(AlsaInput* _alsa, void* _dstPtr, size_t _frames)
+{
+  if (_alsa == NULL || _dstPtr == NULL)
+    return EINVAL;
+  if (_alsa->m_handle == NULL)
+    return ENOTCONN;
+
+  if (_alsa->m_mmap)
+    return do_alsaInputReadMmap(_alsa, (char*)_dstPtr, _frames);
+  else
+    return do_alsaInputReadRW(_alsa, (char*)_dstPtr, _frames);
+}
+
+int alsaInputTunePeriod(AlsaInput* _alsa, const AlsaConfig* _config, size_t* _periodFrames)
+{
+  int res = ENODEV;
+  size_t periodFrames;
+  char* buffer;
+
+  if (_alsa == NULL || _config == NULL || _periodFrames == NULL)
+    return EINVAL;
+  if (_alsa->m_handle != NULL)
+    return EALREADY;
+
+  // probe reads one period at a time without any processing, so there is no headroom for load
+  for (periodFrames = 32; periodFrames <= 4096; periodFrames *= 2)
+  {
+    AlsaConfig config = *_config;
+    config.m_periodFrames = periodFrames;
+    config.m_autoTune     = false;
+
+    if (alsaInputOpen(_alsa, &config) != 0)
+      continue;
+
+    const size_t probeFrames = _alsa->m_rate / 4;
+    const size_t actualPeriod = _alsa->m_periodFrames;
+    size_t readFrames;
+    if ((buffer = malloc(actualPeriod * _alsa->m_frameSize)) == NULL)
+    {
+      alsaInputClose(_alsa);
+      return ENOMEM;
+    }
+
+    res = alsaInputStart(_alsa);
+    for (readFrames = 0; res == 0 && readFrames < probeFrames && _alsa->m_xrunCounter == 0; readFrames += actualPeriod)
+      res = alsaInputReadFrames(_alsa, buffer, actualPeriod);
+    const bool sustained = res == 0 && _alsa->m_xrunCounter == 0;
+
+    alsaInputStop(_alsa);
+    alsaInputClose(_alsa);
+    free(buffer);
+
+    if (s_verbose)
+      fprintf(stderr, "ALSA period %zu frames: %s\n", actualPeriod, sustained ? "ok" : "xruns");
+
+    if (sustained)
+    {
+      *_periodFrames = actualPeriod;
+      return 0;
+    }
+    res = EIO;
+  }
+
+  fprintf(stderr, "No ALSA period size up to 4096 frames runs without xruns\n");
+  return res;
+}
@@ -12,6 +12,7 @@
 
 #include "trik_vidtranscode_cv.h"
 
+#include "internal/sound_kernels.h"
 #include "internal/module_ce.h"
 
 
@@ -22,57 +23,122 @@
 
 #define ALIGN_UP(v, a) ((((v)+(a)-1)/(a))*(a))
 
+#define CE_PROCESS_WAIT_FOREVER ((UInt)-1)
+
 
 static bool s_verbose = false;
 
 
-static int do_memoryAlloc(CodecEngine* _ce, size_t _srcBufferSize, size_t _dstBufferSize)
+// In-flight frame state; args and descriptors must stay valid until async process is waited for
+struct CodecEngineFrame
+{
+  TRIK_VIDTRANSCODE_CV_InArgs  m_inArgs;
+  TRIK_VIDTRANSCODE_CV_OutArgs m_outArgs;
+  XDM1_BufDesc                 m_inBufDesc;
+  XDM_BufDesc                  m_outBufDesc;
+  XDAS_Int8*                   m_outBufs[1];
+  XDAS_Int32                   m_outBufSizes[1];
+  XDAS_Int32                   m_processResult;
+  size_t                       m_srcFrameSize;
+  size_t                       m_dstFrameSize;
+  bool                         m_dstValid; // dst cache was invalidated before processing
+  unsigned int                 m_confidence; // codec does not report it, CPU backend only
+  unsigned int                 m_channels;   // CPU backend only, codec reports left and right volume
+  unsigned int                 m_channelVolume[TARGET_CHANNELS_MAX];
+};
+
+static int do_memoryFree(CodecEngine* _ce)
+{
+  size_t idx;
+
+  for (idx = 0; idx < CODEC_ENGINE_PIPELINE_MAX; ++idx)
+  {
+    if (_ce->m_dstBuffers[idx] != NULL)
+    {
+      if (_ce->m_backend == CODEC_ENGINE_BACKEND_CPU)
+        free(_ce->m_dstBuffers[idx]);
+      else
+        Memory_free(_ce->m_dstBuffers[idx], _ce->m_dstBufferSize, &_ce->m_allocParams);
+      _ce->m_dstBuffers[idx] = NULL;
+    }
+
+    if (_ce->m_srcBuffers[idx] != NULL)
+    {
+      if (_ce->m_backend == CODEC_ENGINE_BACKEND_CPU)
+        free(_ce->m_srcBuffers[idx]);
+      else
+        Memory_free(_ce->m_srcBuffers[idx], _ce->m_srcBufferSize, &_ce->m_allocParams);
+      _ce->m_srcBuffers[idx] = NULL;
+    }
+  }
+  _ce->m_dstBufferSize = 0;
+  _ce->m_srcBufferSize = 0;
+
+  free(_ce->m_frames);
+  _ce->m_frames = NULL;
+  _ce->m_pipelineDepth = 0;
+  _ce->m_framePending = false;
+
+  return 0;
+}
+
+static void* do_bufferAlloc(CodecEngine* _ce, size_t _size)
 {
+  // CPU backend does not share buffers with DSP, so neither CMEM nor cache maintenance is needed
+  if (_ce->m_backend == CODEC_ENGINE_BACKEND_CPU)
+    return malloc(_size);
+
+  return Memory_alloc(_size, &_ce->m_allocParams);
+}
+
+static int do_memoryAlloc(CodecEngine* _ce, size_t _srcBufferSize, size_t _dstBufferSize, size_t _pipelineDepth)
+{
+  size_t idx;
+
   memset(&_ce->m_allocParams, 0, sizeof(_ce->m_allocParams));
   _ce->m_allocParams.type = Memory_CONTIGPOOL;
   _ce->m_allocParams.flags = Memory_CACHED;
   _ce->m_allocParams.align = BUFALIGN;
   _ce->m_allocParams.seg = 0;
 
-  _ce->m_srcBufferSize = ALIGN_UP(_srcBufferSize, BUFALIGN);
-  if ((_ce->m_srcBuffer = Memory_alloc(_ce->m_srcBufferSize, &_ce->m_allocParams)) == NULL)
-  {
-    fprintf(stderr, "Memory_alloc(src, %zu) failed\n", _ce->m_srcBufferSize);
-    _ce->m_srcBufferSize = 0;
+  if ((_ce->m_frames = calloc(_pipelineDepth, sizeof(*_ce->m_frames))) == NULL)
     return ENOMEM;
-  }
+  _ce->m_pipelineDepth = _pipelineDepth;
+  _ce->m_frameNext = 0;
+  _ce->m_framePending = false;
 
+  _ce->m_srcBufferSize = ALIGN_UP(_srcBufferSize, BUFALIGN);
   _ce->m_dstBufferSize = ALIGN_UP(_dstBufferSize, BUFALIGN);
-  if ((_ce->m_dstBuffer = Memory_alloc(_ce->m_dstBufferSize, &_ce->m_allocParams)) == NULL)
+  for (idx = 0; idx < _pipelineDepth; ++idx)
   {
-    fprintf(stderr, "Memory_alloc(dst, %zu) failed\n", _ce->m_dstBufferSize);
-    _ce->m_dstBufferSize = 0;
-
-    Memory_free(_ce->m_srcBuffer, _ce->m_srcBufferSize, &_ce->m_allocParams);
-    _ce->m_srcBuffer = NULL;
-    _ce->m_srcBufferSize = 0;
-    return ENOMEM;
-  }
-  memset(_ce->m_dstBuffer, 0, _ce->m_dstBufferSize);
+    if ((_ce->m_srcBuffers[idx] = do_bufferAlloc(_ce, _ce->m_srcBufferSize)) == NULL)
+    {
+      fprintf(stderr, "Memory_alloc(src, %zu) failed\n", _ce->m_srcBufferSize);
+      do_memoryFree(_ce);
+      return ENOMEM;
+    }
+    memset(_ce->m_srcBuffers[idx], 0, _ce->m_srcBufferSize);
+    _ce->m_srcDataSizes[idx] = 0;
 
-  return 0;
-}
+    if ((_ce->m_dstBuffers[idx] = do_bufferAlloc(_ce, _ce->m_dstBufferSize)) == NULL)
+    {
+      fprintf(stderr, "Memory_alloc(dst, %zu) failed\n", _ce->m_dstBufferSize);
+      do_memoryFree(_ce);
+      return ENOMEM;
+    }
+    memset(_ce->m_dstBuffers[idx], 0, _ce->m_dstBufferSize);
 
-static int do_memoryFree(CodecEngine* _ce)
-{
-  if (_ce->m_dstBuffer != NULL)
-  {
-    Memory_free(_ce->m_dstBuffer, _ce->m_dstBufferSize, &_ce->m_allocParams);
-    _ce->m_dstBuffer = NULL;
-    _ce->m_dstBufferSize = 0;
+    // from now on only ranges touched by ARM need cache maintenance, see do_submitFrame()
+    if (_ce->m_backend != CODEC_ENGINE_BACKEND_CPU)
+    {
+      Memory_cacheWbInv(_ce->m_srcBuffers[idx], _ce->m_srcBufferSize);
+      Memory_cacheWbInv(_ce->m_dstBuffers[idx], _ce->m_dstBufferSize);
+    }
   }
 
-  if (_ce->m_srcBuffer != NULL)
-  {
-    Memory_free(_ce->m_srcBuffer, _ce->m_srcBufferSize, &_ce->m_allocParams);
-    _ce->m_srcBuffer = NULL;
-    _ce->m_srcBufferSize = 0;
-  }
+  _ce->m_cacheFrames = 0;
+  _ce->m_cacheWbInvBytes = 0;
+  _ce->m_cacheInvBytes = 0;
 
   return 0;
 }
@@ -162,8 +228,32 @@ static int do_setupCodec(CodecEngine* _ce, const char* _codecName,
   return 0;
 }
 
+static int do_waitFrame(CodecEngine* _ce)
+{
+  if (!_ce->m_framePending)
+    return 0;
+
+  _ce->m_framePending = false;
+
+  if (_ce->m_pipelineDepth > 1)
+  {
+    struct CodecEngineFrame* frame = &_ce->m_frames[_ce->m_framePendingIndex];
+    const uint64_t waitStartNs = statsNowNs();
+    frame->m_processResult = VIDTRANSCODE_processWait(_ce->m_vidtranscodeHandle,
+                                                      &frame->m_inBufDesc, &frame->m_outBufDesc,
+                                                      &frame->m_inArgs.base, &frame->m_outArgs.base,
+                                                      CE_PROCESS_WAIT_FOREVER);
+    statsRecord(_ce->m_stats, STATS_STAGE_PROCESS, statsNowNs() - waitStartNs);
+  }
+
+  return 0;
+}
+
 static int do_releaseCodec(CodecEngine* _ce)
 {
+  // codec must not be deleted under in-flight frame
+  do_waitFrame(_ce);
+
   if (_ce->m_vidtranscodeHandle != NULL)
     VIDTRANSCODE_delete(_ce->m_vidtranscodeHandle);
   _ce->m_vidtranscodeHandle = NULL;
@@ -193,99 +283,226 @@ static int makeValueWrap(int _val, int _adj, int _min, int _max)
   return _val;
 }
 
-static int do_transcodeFrame(CodecEngine* _ce,
-                             const void* _srcFramePtr, size_t _srcFrameSize,
-                             void* _dstFramePtr, size_t _dstFrameSize, size_t* _dstFrameUsed,
-                             const TargetDetectParams* _targetDetectParams,
-                             const TargetDetectCommand* _targetDetectCommand,
-                             TargetLocation* _targetLocation,
-                             TargetDetectParams* _targetDetectParamsResult)
+static int do_submitFrame(CodecEngine* _ce,
+                          const void* _srcFramePtr, size_t _srcFrameSize, size_t _srcDataSize,
+                          size_t _dstFrameSize,
+                          const TargetDetectParams* _targetDetectParams,
+                          const TargetDetectCommand* _targetDetectCommand)
 {
-  if (_ce->m_srcBuffer == NULL || _ce->m_dstBuffer == NULL)
+  if (_ce->m_frames == NULL)
     return ENOTCONN;
-  if (   _srcFramePtr == NULL || _dstFramePtr == NULL
-      || _targetDetectParams == NULL || _targetDetectCommand == NULL
-      || _targetLocation == NULL || _targetDetectParamsResult == NULL)
+  if (   _srcFramePtr == NULL
+      || _targetDetectParams == NULL || _targetDetectCommand == NULL)
     return EINVAL;
 
-  if (_srcFrameSize > _ce->m_srcBufferSize || _dstFrameSize > _ce->m_dstBufferSize)
+  if (_srcFrameSize > _ce->m_srcBufferSize || _dstFrameSize > _ce->m_dstBufferSize || _srcDataSize > _srcFrameSize)
     return ENOSPC;
 
+  // codec instance accepts single outstanding process call
+  if (_ce->m_framePending)
+    return EBUSY;
+
+  const size_t frameIndex = _ce->m_frameNext;
+  struct CodecEngineFrame* frame = &_ce->m_frames[frameIndex];
+  void* srcBuffer = _ce->m_srcBuffers[frameIndex];
+  void* dstBuffer = _ce->m_dstBuffers[frameIndex];
+
+  memset(frame, 0, sizeof(*frame));
+  frame->m_srcFrameSize = _srcFrameSize;
+  frame->m_dstFrameSize = _dstFrameSize;
+
+  frame->m_inArgs.base.size = sizeof(frame->m_inArgs);
+  frame->m_inArgs.base.numBytes = _srcFrameSize;
+  frame->m_inArgs.base.inputID = 1; // must be non-zero, otherwise caching issues appear
+  frame->m_inArgs.alg.volumeCoefficient = _targetDetectParams->m_volumeCoefficient;
+  frame->m_inArgs.alg.micDistance = _targetDetectParams->m_micDistance;
+  frame->m_inArgs.alg.windowSize = _targetDetectParams->m_windowSize;
+  frame->m_inArgs.alg.numSamples = _targetDetectParams->m_numSamples;
+
+  frame->m_outArgs.base.size = sizeof(frame->m_outArgs);
+
+  frame->m_inBufDesc.numBufs = 1;
+  frame->m_inBufDesc.descs[0].buf = srcBuffer;
+  frame->m_inBufDesc.descs[0].bufSize = _srcFrameSize;
+
+  frame->m_outBufDesc.numBufs = 1;
+  frame->m_outBufDesc.bufs = frame->m_outBufs;
+  frame->m_outBufDesc.bufs[0] = dstBuffer;
+  frame->m_outBufDesc.bufSizes = frame->m_outBufSizes;
+  frame->m_outBufDesc.bufSizes[0] = _dstFrameSize;
+
+  // frame may be already captured right into CMEM buffer, see codecEngineGetSrcBuffer();
+  // then only data part is valid and the rest of frame is kept zeroed
+  size_t* srcDataSize = &_ce->m_srcDataSizes[frameIndex];
+  size_t srcDirtySize;
+  uint64_t stageStartNs = statsNowNs();
+  if (_srcFramePtr != srcBuffer)
+  {
+    memcpy(srcBuffer, _srcFramePtr, _srcFrameSize);
+    srcDirtySize = _srcFrameSize;
+    *srcDataSize = _srcFrameSize;
+  }
+  else
+  {
+    srcDirtySize = _srcDataSize;
+    if (_srcDataSize < *srcDataSize)
+    {
+      memset((char*)srcBuffer + _srcDataSize, 0, *srcDataSize - _srcDataSize);
+      srcDirtySize = *srcDataSize;
+    }
+    *srcDataSize = _srcDataSize;
+  }
+  statsRecord(_ce->m_stats, STATS_STAGE_CMEM_COPY, statsNowNs() - stageStartNs);
+
+  if (_ce->m_backend == CODEC_ENGINE_BACKEND_CPU)
+  {
+    TargetLocation targetLocation;
+    stageStartNs = statsNowNs();
+    const int processRes = cpuEngineProcess(&_ce->m_cpu, srcBuffer, *srcDataSize, _targetDetectParams, &targetLocation);
+    statsRecord(_ce->m_stats, STATS_STAGE_PROCESS, statsNowNs() - stageStartNs);
 
-  TRIK_VIDTRANSCODE_CV_InArgs tcInArgs;
-  memset(&tcInArgs, 0, sizeof(tcInArgs));
-  tcInArgs.base.size = sizeof(tcInArgs);
-  tcInArgs.base.numBytes = _srcFrameSize;
-  tcInArgs.base.inputID = 1; // must be non-zero, otherwise caching issues appear
-  tcInArgs.alg.volumeCoefficient = _targetDetectParams->m_volumeCoefficient;
-  tcInArgs.alg.micDistance = _targetDetectParams->m_micDistance;
-  tcInArgs.alg.windowSize = _targetDetectParams->m_windowSize;
-  tcInArgs.alg.numSamples = _targetDetectParams->m_numSamples;
-
-  TRIK_VIDTRANSCODE_CV_OutArgs tcOutArgs;
-  memset(&tcOutArgs,    0, sizeof(tcOutArgs));
-  tcOutArgs.base.size = sizeof(tcOutArgs);
-
-  XDM1_BufDesc tcInBufDesc;
-  memset(&tcInBufDesc,  0, sizeof(tcInBufDesc));
-  tcInBufDesc.numBufs = 1;
-  tcInBufDesc.descs[0].buf = _ce->m_srcBuffer;
-  tcInBufDesc.descs[0].bufSize = _srcFrameSize;
-
-  XDM_BufDesc tcOutBufDesc;
-  memset(&tcOutBufDesc, 0, sizeof(tcOutBufDesc));
-  XDAS_Int8* tcOutBufDesc_bufs[1];
-  XDAS_Int32 tcOutBufDesc_bufSizes[1];
-  tcOutBufDesc.numBufs = 1;
-  tcOutBufDesc.bufs = tcOutBufDesc_bufs;
-  tcOutBufDesc.bufs[0] = _ce->m_dstBuffer;
-  tcOutBufDesc.bufSizes = tcOutBufDesc_bufSizes;
-  tcOutBufDesc.bufSizes[0] = _dstFrameSize;
+    if (processRes == 0)
+    {
+      frame->m_processResult = IVIDTRANSCODE_EOK;
+      frame->m_outArgs.alg.targetAngle       = targetLocation.m_targetAngle;
+      frame->m_outArgs.alg.targetLeftVolume  = targetLocation.m_targetLeftVolume;
+      frame->m_outArgs.alg.targetRightVolume = targetLocation.m_targetRightVolume;
+      frame->m_confidence                    = targetLocation.m_confidence;
+      frame->m_channels                      = targetLocation.m_channels;
+      memcpy(frame->m_channelVolume, targetLocation.m_channelVolume, sizeof(frame->m_channelVolume));
+    }
+    else
+      frame->m_processResult = IVIDTRANSCODE_EFAIL;
 
-#warning This memcpy is blocking high fps
-  memcpy(_ce->m_srcBuffer, _srcFramePtr, _srcFrameSize);
-  //memset(_ce->m_srcBuffer, 0, _srcFrameSize);
+    goto exit_pending;
+  }
 
-  Memory_cacheWbInv(_ce->m_srcBuffer, _ce->m_srcBufferSize); // invalidate and flush *whole* cache, not only written portion, just in case
-  Memory_cacheInv(_ce->m_dstBuffer, _ce->m_dstBufferSize); // invalidate *whole* cache, not only expected portion, just in case
+  // flush only what was written since previous frame in this buffer - captured data and zeroed tail;
+  // output is invalidated only when it is going to be read back
+  stageStartNs = statsNowNs();
+  srcDirtySize = ALIGN_UP(srcDirtySize, BUFALIGN);
+  if (srcDirtySize > _ce->m_srcBufferSize)
+    srcDirtySize = _ce->m_srcBufferSize;
+  Memory_cacheWbInv(srcBuffer, srcDirtySize);
+  _ce->m_cacheWbInvBytes += srcDirtySize;
 
-  XDAS_Int32 processResult = VIDTRANSCODE_process(_ce->m_vidtranscodeHandle, &tcInBufDesc, &tcOutBufDesc, &tcInArgs.base, &tcOutArgs.base);
-  if (processResult != IVIDTRANSCODE_EOK)
+  if (_ce->m_videoOutEnable)
+  {
+    size_t dstInvSize = ALIGN_UP(_dstFrameSize, BUFALIGN);
+    if (dstInvSize > _ce->m_dstBufferSize)
+      dstInvSize = _ce->m_dstBufferSize;
+    Memory_cacheInv(dstBuffer, dstInvSize);
+    _ce->m_cacheInvBytes += dstInvSize;
+    frame->m_dstValid = true;
+  }
+  _ce->m_cacheFrames += 1;
+  statsRecord(_ce->m_stats, STATS_STAGE_CACHE, statsNowNs() - stageStartNs);
+
+  if (_ce->m_pipelineDepth > 1)
+  {
+    XDAS_Int32 processResult = VIDTRANSCODE_processAsync(_ce->m_vidtranscodeHandle,
+                                                         &frame->m_inBufDesc, &frame->m_outBufDesc,
+                                                         &frame->m_inArgs.base, &frame->m_outArgs.base);
+    if (processResult != IVIDTRANSCODE_EOK)
+    {
+      fprintf(stderr, "VIDTRANSCODE_processAsync(%zu -> %zu) failed: %"PRIi32"/%"PRIi32"\n",
+              _srcFrameSize, _dstFrameSize, processResult, frame->m_outArgs.base.extendedError);
+      return EILSEQ;
+    }
+  }
+  else
+  {
+    stageStartNs = statsNowNs();
+    frame->m_processResult = VIDTRANSCODE_process(_ce->m_vidtranscodeHandle,
+                                                  &frame->m_inBufDesc, &frame->m_outBufDesc,
+                                                  &frame->m_inArgs.base, &frame->m_outArgs.base);
+    statsRecord(_ce->m_stats, STATS_STAGE_PROCESS, statsNowNs() - stageStartNs);
+  }
+
+ exit_pending:
+  _ce->m_framePendingIndex = frameIndex;
+  _ce->m_framePending = true;
+  _ce->m_frameNext = (frameIndex + 1) % _ce->m_pipelineDepth;
+
+  return 0;
+}
+
+static int do_completeFrame(CodecEngine* _ce,
+                            void* _dstFramePtr, size_t _dstFrameSize, size_t* _dstFrameUsed,
+                            TargetLocation* _targetLocation,
+                            TargetDetectParams* _targetDetectParamsResult)
+{
+  if (_ce->m_frames == NULL)
+    return ENOTCONN;
+  if (   _dstFrameUsed == NULL
+      || _targetLocation == NULL || _targetDetectParamsResult == NULL)
+    return EINVAL;
+
+  if (!_ce->m_framePending)
+    return ENODATA;
+
+  struct CodecEngineFrame* frame = &_ce->m_frames[_ce->m_framePendingIndex];
+  const void* dstBuffer = _ce->m_dstBuffers[_ce->m_framePendingIndex];
+
+  do_waitFrame(_ce);
+
+  if (frame->m_processResult != IVIDTRANSCODE_EOK)
   {
     fprintf(stderr, "VIDTRANSCODE_process(%zu -> %zu) failed: %"PRIi32"/%"PRIi32"\n",
-            _srcFrameSize, _dstFrameSize, processResult, tcOutArgs.base.extendedError);
+            frame->m_srcFrameSize, frame->m_dstFrameSize, frame->m_processResult, frame->m_outArgs.base.extendedError);
     return EILSEQ;
   }
 
-  if (tcOutArgs.base.encodedBuf[0].bufSize < 0)
+  if (_dstFrameSize > frame->m_dstFrameSize)
+    _dstFrameSize = frame->m_dstFrameSize;
+
+  if (frame->m_outArgs.base.encodedBuf[0].bufSize < 0)
   {
     *_dstFrameUsed = 0;
     fprintf(stderr, "VIDTRANSCODE_process(%zu -> %zu) returned negative buffer size\n",
-            _srcFrameSize, _dstFrameSize);
+            frame->m_srcFrameSize, _dstFrameSize);
   }
-  else if ((size_t)(tcOutArgs.base.encodedBuf[0].bufSize) > _dstFrameSize)
+  else if ((size_t)(frame->m_outArgs.base.encodedBuf[0].bufSize) > _dstFrameSize)
   {
     *_dstFrameUsed = _dstFrameSize;
     fprintf(stderr, "VIDTRANSCODE_process(%zu -> %zu) returned too large buffer %zu, truncated\n",
-            _srcFrameSize, _dstFrameSize, *_dstFrameUsed);
+            frame->m_srcFrameSize, _dstFrameSize, *_dstFrameUsed);
   }
   else
-    *_dstFrameUsed = tcOutArgs.base.encodedBuf[0].bufSize;
+    *_dstFrameUsed = frame->m_outArgs.base.encodedBuf[0].bufSize;
 
 #warning This memcpy is blocking high fps
-  if(_ce->m_videoOutEnable)
-    memcpy(_dstFramePtr, _ce->m_dstBuffer, *_dstFrameUsed);
+  if(_ce->m_videoOutEnable && frame->m_dstValid && _dstFramePtr != NULL)
+  {
+    const uint64_t copyStartNs = statsNowNs();
+    memcpy(_dstFramePtr, dstBuffer, *_dstFrameUsed);
+    statsRecord(_ce->m_stats, STATS_STAGE_FB_COPY, statsNowNs() - copyStartNs);
+  }
+
+  _targetLocation->m_targetAngle    			= frame->m_outArgs.alg.targetAngle;
+  _targetLocation->m_targetLeftVolume			= frame->m_outArgs.alg.targetLeftVolume;
+  _targetLocation->m_targetRightVolume			= frame->m_outArgs.alg.targetRightVolume;
+  _targetLocation->m_confidence				= frame->m_confidence;
 
-  _targetLocation->m_targetAngle    			= tcOutArgs.alg.targetAngle;
-  _targetLocation->m_targetLeftVolume			= tcOutArgs.alg.targetLeftVolume;
-  _targetLocation->m_targetRightVolume			= tcOutArgs.alg.targetRightVolume;
+  if (frame->m_channels != 0)
+  {
+    _targetLocation->m_channels = frame->m_channels;
+    memcpy(_targetLocation->m_channelVolume, frame->m_channelVolume, sizeof(_targetLocation->m_channelVolume));
+  }
+  else
+  {
+    _targetLocation->m_channels = 2;
+    _targetLocation->m_channelVolume[0] = _targetLocation->m_targetLeftVolume;
+    _targetLocation->m_channelVolume[1] = _targetLocation->m_targetRightVolume;
+  }
 
   return 0;
 }
 
-static int do_reportLoad(const CodecEngine* _ce, long long _ms)
+static int do_reportLoad(CodecEngine* _ce, long long _ms)
 {
-  (void)_ms; // warn prevention
+  if (_ce->m_backend == CODEC_ENGINE_BACKEND_CPU)
+    return cpuEngineReportLoad(&_ce->m_cpu, _ms);
 
   Server_Handle ceServerHandle = Engine_getServer(_ce->m_handle);
   if (ceServerHandle == NULL)
@@ -296,6 +513,13 @@ static int do_reportLoad(const CodecEngine* _ce, long long _ms)
 
   fprintf(stderr, "DSP load %d%%\n", (int)Server_getCpuLoad(ceServerHandle));
 
+  if (_ce->m_cacheFrames > 0)
+    fprintf(stderr, "DSP cache maintenance per frame: %llu bytes flushed, %llu bytes invalidated\n",
+                    _ce->m_cacheWbInvBytes / _ce->m_cacheFrames, _ce->m_cacheInvBytes / _ce->m_cacheFrames);
+  _ce->m_cacheFrames = 0;
+  _ce->m_cacheWbInvBytes = 0;
+  _ce->m_cacheInvBytes = 0;
+
   Int sNumSegs;
   Server_Status sStatus = Server_getNumMemSegs(ceServerHandle, &sNumSegs);
   if (sStatus != Server_EOK)
@@ -341,14 +565,8 @@ int codecEngineFini()
   return 0;
 }
 
-int codecEngineOpen(CodecEngine* _ce, const CodecEngineConfig* _config)
+static int do_openDSP(CodecEngine* _ce, const CodecEngineConfig* _config)
 {
-  if (_ce == NULL || _config == NULL)
-    return EINVAL;
-
-  if (_ce->m_handle != NULL)
-    return EALREADY;
-
   Engine_Error ceError;
   Engine_Desc desc;
   Engine_initDesc(&desc);
@@ -374,33 +592,95 @@ int codecEngineOpen(CodecEngine* _ce, const CodecEngineConfig* _config)
   return 0;
 }
 
+int codecEngineOpen(CodecEngine* _ce, const CodecEngineConfig* _config)
+{
+  int res;
+
+  if (_ce == NULL || _config == NULL)
+    return EINVAL;
+
+  if (_ce->m_backend != CODEC_ENGINE_BACKEND_AUTO)
+    return EALREADY;
+
+  if (_config->m_backend != CODEC_ENGINE_BACKEND_CPU)
+  {
+    if ((res = do_openDSP(_ce, _config)) == 0)
+    {
+      _ce->m_backend = CODEC_ENGINE_BACKEND_DSP;
+      return 0;
+    }
+
+    if (_config->m_backend == CODEC_ENGINE_BACKEND_DSP)
+      return res;
+
+    fprintf(stderr, "DSP server %s is not available, falling back to CPU backend\n", _config->m_serverPath);
+  }
+
+  _ce->m_backend = CODEC_ENGINE_BACKEND_CPU;
+  if (s_verbose)
+    fprintf(stderr, "Using CPU backend with %s kernels\n", soundKernelsName());
+
+  return 0;
+}
+
 int codecEngineClose(CodecEngine* _ce)
 {
   if (_ce == NULL)
     return EINVAL;
 
-  if (_ce->m_handle == NULL)
+  if (_ce->m_backend == CODEC_ENGINE_BACKEND_AUTO)
     return EALREADY;
 
-  Engine_close(_ce->m_handle);
+  if (_ce->m_handle != NULL)
+    Engine_close(_ce->m_handle);
   _ce->m_handle = NULL;
+  _ce->m_backend = CODEC_ENGINE_BACKEND_AUTO;
 
   return 0;
 }
 
 int codecEngineStart(CodecEngine* _ce, const CodecEngineConfig* _config,
                      const ImageDescription* _srcImageDesc,
-                     const ImageDescription* _dstImageDesc)
+                     const ImageDescription* _dstImageDesc,
+                     const AudioDescription* _srcAudioDesc)
 {
   int res;
 
-  if (_ce == NULL || _config == NULL || _srcImageDesc == NULL || _dstImageDesc == NULL)
+  if (_ce == NULL || _config == NULL || _srcImageDesc == NULL || _dstImageDesc == NULL || _srcAudioDesc == NULL)
     return EINVAL;
 
-  if (_ce->m_handle == NULL)
+  if (_ce->m_backend == CODEC_ENGINE_BACKEND_AUTO)
     return ENOTCONN;
 
-  if ((res = do_memoryAlloc(_ce, _srcImageDesc->m_imageSize, _dstImageDesc->m_imageSize)) != 0)
+  if (_ce->m_backend == CODEC_ENGINE_BACKEND_CPU)
+  {
+    // processing is done synchronously within submit, nothing to overlap
+    if ((res = do_memoryAlloc(_ce, _srcImageDesc->m_imageSize, _dstImageDesc->m_imageSize, 1)) != 0)
+      return res;
+
+    const size_t srcFrameSize = _srcAudioDesc->m_channels * sizeof(int16_t);
+    if ((res = cpuEngineOpen(&_ce->m_cpu, _srcAudioDesc,
+                             srcFrameSize ? _ce->m_srcBufferSize / srcFrameSize : 0,
+                             _config->m_micGeometry, _config->m_workers,
+                             &_config->m_workerThreadAttr)) != 0)
+    {
+      fprintf(stderr, "cpuEngineOpen() failed: %d\n", res);
+      do_memoryFree(_ce);
+      return res;
+    }
+
+    return 0;
+  }
+
+  // codec interface carries two channel volumes and single mic distance
+  if (_srcAudioDesc->m_channels != 2)
+  {
+    fprintf(stderr, "DSP backend supports stereo input only, got %u channels\n", _srcAudioDesc->m_channels);
+    return EINVAL;
+  }
+
+  if ((res = do_memoryAlloc(_ce, _srcImageDesc->m_imageSize, _dstImageDesc->m_imageSize,
+                            _config->m_async ? CODEC_ENGINE_PIPELINE_MAX : 1)) != 0)
     return res;
 
   if ((res = do_setupCodec(_ce, _config->m_codecName, _srcImageDesc, _dstImageDesc)) != 0)
@@ -418,15 +698,110 @@ int codecEngineStop(CodecEngine* _ce)
   if (_ce == NULL)
     return EINVAL;
 
-  if (_ce->m_handle == NULL)
+  if (_ce->m_backend == CODEC_ENGINE_BACKEND_AUTO)
     return ENOTCONN;
 
   do_releaseCodec(_ce);
+  cpuEngineClose(&_ce->m_cpu);
   do_memoryFree(_ce);
 
   return 0;
 }
 
+int codecEngineGetSrcBuffer(CodecEngine* _ce, void** _srcBufferPtr, size_t* _srcBufferSize)
+{
+  if (_ce == NULL || _srcBufferPtr == NULL || _srcBufferSize == NULL)
+    return EINVAL;
+
+  if (_ce->m_frames == NULL)
+    return ENOTCONN;
+
+  // with single buffer it is owned by DSP until frame is completed
+  if (_ce->m_framePending && _ce->m_framePendingIndex == _ce->m_frameNext)
+    return EBUSY;
+
+  *_srcBufferPtr  = _ce->m_srcBuffers[_ce->m_frameNext];
+  *_srcBufferSize = _ce->m_srcBufferSize;
+
+  return 0;
+}
+
+int codecEngineDiscardSrcBuffer(CodecEngine* _ce, size_t _srcDataSize)
+{
+  if (_ce == NULL)
+    return EINVAL;
+
+  if (_ce->m_frames == NULL)
+    return ENOTCONN;
+
+  // buffer is not advanced, next capture overwrites it; data written beyond next frame must be zeroed and flushed then
+  size_t* srcDataSize = &_ce->m_srcDataSizes[_ce->m_frameNext];
+  if (_srcDataSize > *srcDataSize)
+    *srcDataSize = _srcDataSize > _ce->m_srcBufferSize ? _ce->m_srcBufferSize : _srcDataSize;
+
+  return 0;
+}
+
+int codecEngineSubmitFrame(CodecEngine* _ce,
+                           const void* _srcFramePtr, size_t _srcFrameSize, size_t _srcDataSize,
+                           size_t _dstFrameSize,
+                           const TargetDetectParams* _targetDetectParams,
+                           const TargetDetectCommand* _targetDetectCommand)
+{
+  if (_ce == NULL || _targetDetectParams == NULL || _targetDetectCommand == NULL)
+    return EINVAL;
+
+  if (_ce->m_backend == CODEC_ENGINE_BACKEND_AUTO)
+    return ENOTCONN;
+
+  return do_submitFrame(_ce,
+                        _srcFramePtr, _srcFrameSize, _srcDataSize,
+                        _dstFrameSize,
+                        _targetDetectParams,
+                        _targetDetectCommand);
+}
+
+int codecEngineCompleteFrame(CodecEngine* _ce,
+                             void* _dstFramePtr, size_t _dstFrameSize, size_t* _dstFrameUsed,
+                             TargetLocation* _targetLocation,
+                             TargetDetectParams* _targetDetectParamsResult)
+{
+  int res;
+
+  if (_ce == NULL || _dstFrameUsed == NULL || _targetLocation == NULL || _targetDetectParamsResult == NULL)
+    return EINVAL;
+
+  if (_ce->m_backend == CODEC_ENGINE_BACKEND_AUTO)
+    return ENOTCONN;
+
+  res = do_completeFrame(_ce,
+                         _dstFramePtr, _dstFrameSize, _dstFrameUsed,
+                         _targetLocation,
+                         _targetDetectParamsResult);
+
+  if (s_verbose && res == 0)
+    fprintf(stderr, "Transcoded frame -> %p[%zu/%zu]\n",
+            _dstFramePtr, _dstFrameSize, *_dstFrameUsed);
+
+  return res;
+}
+
+bool codecEngineFramePending(const CodecEngine* _ce)
+{
+  if (_ce == NULL)
+    return false;
+
+  return _ce->m_framePending;
+}
+
+bool codecEngineIsAsync(const CodecEngine* _ce)
+{
+  if (_ce == NULL)
+    return false;
+
+  return _ce->m_pipelineDepth > 1;
+}
+
 int codecEngineTranscodeFrame(CodecEngine* _ce,
                               const void* _srcFramePtr, size_t _srcFrameSize,
                               void* _dstFramePtr, size_t _dstFrameSize, size_t* _dstFrameUsed,
@@ -437,42 +812,25 @@ int codecEngineTranscodeFrame(CodecEngine* _ce,
 {
   int res;
 
-  if (_ce == NULL || _targetDetectParams == NULL || _targetDetectCommand == NULL || _targetLocation == NULL || _targetDetectParamsResult == NULL)
-    return EINVAL;
-
-  if (_ce->m_handle == NULL)
-    return ENOTCONN;
-
-  res = do_transcodeFrame(_ce,
-                          _srcFramePtr, _srcFrameSize,
-                          _dstFramePtr, _dstFrameSize, _dstFrameUsed,
-                          _targetDetectParams,
-                          _targetDetectCommand,
-                          _targetLocation,
-                          _targetDetectParamsResult);
-
-  if (s_verbose)
-  {
-    fprintf(stderr, "Transcoded frame %p[%zu] -> %p[%zu/%zu]\n",
-            _srcFramePtr, _srcFrameSize, _dstFramePtr, _dstFrameSize, *_dstFrameUsed);
-    /*
-    if (_targetLocation->m_detectFlag)
-    {
-      fprintf(stderr, "Sound target detected at %d angle\n",
-              _targetLocation->m_targetAngle);
-    }
-    */
-  }
+  if ((res = codecEngineSubmitFrame(_ce,
+                                    _srcFramePtr, _srcFrameSize, _srcFrameSize,
+                                    _dstFrameSize,
+                                    _targetDetectParams,
+                                    _targetDetectCommand)) != 0)
+    return res;
 
-  return res;
+  return codecEngineCompleteFrame(_ce,
+                                  _dstFramePtr, _dstFrameSize, _dstFrameUsed,
+                                  _targetLocation,
+                                  _targetDetectParamsResult);
 }
 
-int codecEngineReportLoad(const CodecEngine* _ce, long long _ms)
+int codecEngineReportLoad(CodecEngine* _ce, long long _ms)
 {
   if (_ce == NULL)
     return EINVAL;
 
-  if (_ce->m_handle == NULL)
+  if (_ce->m_backend == CODEC_ENGINE_BACKEND_AUTO)
     return ENOTCONN;
 
   return do_reportLoad(_ce, _ms);
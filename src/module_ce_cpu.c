@@ -0,0 +1,656 @@
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+
+#include "internal/sound_kernels.h"
+#include "internal/module_ce_cpu.h"
+
+
+static long long do_monotonicNs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (long long)now.tv_sec * 1000000000ll + now.tv_nsec;
+}
+
+static int do_xcorrReserve(CPUEngine* _cpu, size_t _size)
+{
+  if (_size <= _cpu->m_partXcorrSize)
+    return 0;
+
+  double* xcorr = realloc(_cpu->m_partXcorr, _size * sizeof(*xcorr));
+  if (xcorr == NULL)
+    return ENOMEM;
+
+  _cpu->m_partXcorr = xcorr;
+  _cpu->m_partXcorrSize = _size;
+
+  return 0;
+}
+
+static int do_fftReserve(CPUEngineScratch* _scratch, size_t _window, size_t _maxLag)
+{
+  int res;
+  size_t size = 2;
+
+  // linear correlation up to maxLag must not wrap around
+  while (size < _window + _maxLag)
+    size *= 2;
+
+  if (size == _scratch->m_fft.m_size)
+    return 0;
+
+  soundFFTFini(&_scratch->m_fft);
+  free(_scratch->m_fftRe);
+  free(_scratch->m_fftIm);
+  _scratch->m_fftIm = NULL;
+
+  if (   (_scratch->m_fftRe = malloc(size * sizeof(*_scratch->m_fftRe))) == NULL
+      || (_scratch->m_fftIm = malloc(size * sizeof(*_scratch->m_fftIm))) == NULL)
+  {
+    fprintf(stderr, "malloc(fft %zu) failed\n", size);
+    return ENOMEM;
+  }
+
+  if ((res = soundFFTInit(&_scratch->m_fft, size)) != 0)
+  {
+    fprintf(stderr, "soundFFTInit(%zu) failed: %d\n", size, res);
+    return res;
+  }
+
+  return 0;
+}
+
+// Same as XCorrWindowFunc for all lags, but in frequency domain with phase transform weighting.
+// Returns value perfectly correlated window would add at peak.
+static double do_correlateWindowPHAT(CPUEngineScratch* _scratch, const int16_t* _left, const int16_t* _right, size_t _window, size_t _maxLag, double* _xcorr)
+{
+  const size_t size = _scratch->m_fft.m_size;
+  float* re = _scratch->m_fftRe;
+  float* im = _scratch->m_fftIm;
+  size_t idx;
+
+  // both real channels are packed into single complex transform as left + j*right
+  for (idx = 0; idx < _window; ++idx)
+  {
+    re[idx] = _left[idx];
+    im[idx] = _right[idx];
+  }
+  for (; idx < size; ++idx)
+  {
+    re[idx] = 0.0f;
+    im[idx] = 0.0f;
+  }
+
+  soundFFTForward(&_scratch->m_fft, re, im);
+
+  // unpack L[k] = (Z[k] + Z*[N-k])/2, R[k] = (Z[k] - Z*[N-k])/2j and form PHAT-weighted L*[k]R[k];
+  // bins k and N-k are handled together since both are overwritten
+  for (idx = 0; idx <= size/2; ++idx)
+  {
+    const size_t mirror = (size - idx) % size;
+    const float zr = re[idx],    zi = im[idx];
+    const float mr = re[mirror], mi = im[mirror];
+
+    const float lr = 0.5f * (zr + mr), li = 0.5f * (zi - mi);
+    const float rr = 0.5f * (zi + mi), ri = 0.5f * (mr - zr);
+
+    // cross spectrum for bin idx, one for mirror bin is its conjugate
+    float cr = lr*rr + li*ri;
+    float ci = lr*ri - li*rr;
+    const float magnitude = sqrtf(cr*cr + ci*ci);
+    if (magnitude > 1e-9f)
+    {
+      cr /= magnitude;
+      ci /= magnitude;
+    }
+    else
+    {
+      cr = 0.0f;
+      ci = 0.0f;
+    }
+
+    re[idx]    = cr;
+    im[idx]    = ci;
+    re[mirror] = cr;
+    im[mirror] = -ci;
+  }
+
+  soundFFTInverse(&_scratch->m_fft, re, im);
+
+  // correlation at negative lags is wrapped to the end of the buffer
+  for (idx = 0; idx <= 2*_maxLag; ++idx)
+    _xcorr[idx] += re[(idx + size - _maxLag) % size];
+
+  // all unit-magnitude bins add up in phase at peak
+  return size;
+}
+
+// Peak among lag indices [_begin, _end), interpolated only when both neighbours were searched
+static double do_peakLag(const double* _xcorr, size_t _begin, size_t _end, size_t _maxLag, size_t* _peak)
+{
+  size_t peak = _begin;
+  size_t idx;
+
+  for (idx = _begin + 1; idx < _end; ++idx)
+    if (_xcorr[idx] > _xcorr[peak])
+      peak = idx;
+
+  *_peak = peak;
+
+  double lag = (double)peak - (double)_maxLag;
+
+  // parabolic interpolation around peak for sub-sample resolution
+  if (peak > _begin && peak + 1 < _end)
+  {
+    const double y0 = _xcorr[peak-1];
+    const double y1 = _xcorr[peak];
+    const double y2 = _xcorr[peak+1];
+    const double denom = y0 - 2.0*y1 + y2;
+    if (denom != 0.0)
+      lag += 0.5 * (y0 - y2) / denom;
+  }
+
+  return lag;
+}
+
+static unsigned int do_volume(const int16_t* _samples, size_t _count, unsigned int _volumeCoefficient)
+{
+  if (_count == 0)
+    return 0;
+
+  const uint64_t meanAbs = soundKernelSumAbsS16(_samples, _count) / _count;
+  if (_volumeCoefficient == 0)
+    return meanAbs;
+
+  return (meanAbs * _volumeCoefficient) / 100;
+}
+
+static void do_scratchFree(CPUEngineScratch* _scratch)
+{
+  free(_scratch->m_fftRe);
+  free(_scratch->m_fftIm);
+  soundFFTFini(&_scratch->m_fft);
+  _scratch->m_fftRe = NULL;
+  _scratch->m_fftIm = NULL;
+}
+
+// Stereo pair follows micDistance, which may be changed at any time
+static int do_arrayUpdate(CPUEngine* _cpu, unsigned int _micDistance)
+{
+  int res;
+
+  if (_cpu->m_array.m_pairCount != 0 && (_cpu->m_geometry.m_count != 0 || _cpu->m_arrayMicDistance == _micDistance))
+    return 0;
+
+  if ((res = micArraySetup(&_cpu->m_array, &_cpu->m_geometry, _micDistance, _cpu->m_audioDesc.m_rate)) != 0)
+  {
+    fprintf(stderr, "micArraySetup() failed: %d\n", res);
+    return res;
+  }
+  _cpu->m_arrayMicDistance = _micDistance;
+
+  // pair delays changed, tracked bearing no longer predicts them
+  targetTrackerReset(&_cpu->m_tracker);
+
+  return 0;
+}
+
+// Lags searched for peak: all of them, or few around pair delays expected at tracked bearing
+static void do_searchSetup(CPUEngine* _cpu, bool _narrow, double _angle)
+{
+  size_t idx;
+
+  _cpu->m_frameSearchWidth = 0;
+
+  for (idx = 0; idx < _cpu->m_array.m_pairCount; ++idx)
+  {
+    const size_t maxLag = _cpu->m_array.m_pairs[idx].m_maxLag;
+    size_t begin = 0;
+    size_t end = 2*maxLag + 1;
+
+    if (_narrow)
+    {
+      long center = lround(micArrayPairLag(&_cpu->m_array, idx, _angle)) + (long)maxLag;
+      if (center < 0)
+        center = 0;
+      else if (center > (long)(2*maxLag))
+        center = 2*maxLag;
+
+      if (center > CPU_ENGINE_TRACK_LAG_RADIUS)
+        begin = center - CPU_ENGINE_TRACK_LAG_RADIUS;
+      if (center + CPU_ENGINE_TRACK_LAG_RADIUS + 1 < (long)end)
+        end = center + CPU_ENGINE_TRACK_LAG_RADIUS + 1;
+    }
+
+    _cpu->m_pairSearchBegin[idx] = begin;
+    _cpu->m_pairSearchEnd[idx] = end;
+    if (end - begin > _cpu->m_frameSearchWidth)
+      _cpu->m_frameSearchWidth = end - begin;
+  }
+}
+
+// Parts split lag range in kernel blocks, or windows of frame for GCC-PHAT
+static size_t do_frameParts(const CPUEngine* _cpu, bool _phat)
+{
+  const size_t workers = workerPoolSize(&_cpu->m_pool);
+  const size_t pairs = _cpu->m_array.m_pairCount;
+  if (workers <= 1 || pairs == 0)
+    return 1;
+
+  // couple of tasks per worker, so that stealing evens out pairs of different width
+  size_t parts = (2*workers + pairs - 1) / pairs;
+
+  const size_t limit = _phat ? _cpu->m_frameFrames / _cpu->m_frameWindow
+                             : (_cpu->m_frameSearchWidth + XCORR_KERNEL_LAG_BLOCK - 1) / XCORR_KERNEL_LAG_BLOCK;
+  if (parts > limit)
+    parts = limit;
+  if (parts > CPU_ENGINE_PARTS_MAX)
+    parts = CPU_ENGINE_PARTS_MAX;
+
+  return parts > 0 ? parts : 1;
+}
+
+// Worker task: partial correlation of one microphone pair, by part of lags or of windows
+static void do_correlatePart(void* _ctx, size_t _task, size_t _worker)
+{
+  CPUEngine* cpu = (CPUEngine*)_ctx;
+  CPUEngineScratch* scratch = &cpu->m_scratch[_worker];
+  const size_t parts = cpu->m_frameParts;
+  const size_t part = _task % parts;
+  const size_t pairIdx = _task / parts;
+  const MicArrayPair* pair = &cpu->m_array.m_pairs[pairIdx];
+  const int16_t* first  = cpu->m_channelData[pair->m_first];
+  const int16_t* second = cpu->m_channelData[pair->m_second];
+  const size_t maxLag = pair->m_maxLag;
+  const size_t window = cpu->m_frameWindow;
+  double* xcorr = cpu->m_partXcorr + _task * (2*cpu->m_array.m_maxLag + 1);
+  size_t start;
+  double norm = 0.0;
+
+  cpu->m_partNorm[_task] = 0.0;
+
+  if (maxLag == 0 || window <= 2*maxLag)
+    return; // nothing to correlate
+
+  memset(xcorr, 0, (2*maxLag + 1) * sizeof(*xcorr));
+
+  if (cpu->m_frameParams->m_algorithm == TARGET_DETECT_ALGORITHM_GCC_PHAT)
+  {
+    for (start = part * window; start + window <= cpu->m_frameFrames; start += parts * window)
+      norm += do_correlateWindowPHAT(scratch, first + start, second + start, window, maxLag, xcorr);
+  }
+  else
+  {
+    // only searched lags are correlated
+    const size_t searchBegin = cpu->m_pairSearchBegin[pairIdx];
+    const size_t searchEnd = cpu->m_pairSearchEnd[pairIdx];
+    const size_t blocks = (searchEnd - searchBegin + XCORR_KERNEL_LAG_BLOCK - 1) / XCORR_KERNEL_LAG_BLOCK;
+    const size_t lagBegin = searchBegin + XCORR_KERNEL_LAG_BLOCK * (blocks * part / parts);
+    size_t lagEnd = searchBegin + XCORR_KERNEL_LAG_BLOCK * (blocks * (part + 1) / parts);
+    if (lagEnd > searchEnd)
+      lagEnd = searchEnd;
+
+    // narrow pairs have fewer lag blocks than parts, so first part may have no lags but still owns the norm
+    for (start = 0; start + window <= cpu->m_frameFrames; start += window)
+    {
+      if (lagBegin < lagEnd)
+        cpu->m_xcorrKernel.m_correlate(first + start, second + start, window, maxLag, lagBegin, lagEnd, xcorr);
+      if (part == 0)
+        norm += xcorrWindowNorm(first + start, second + start, window, maxLag);
+    }
+  }
+
+  cpu->m_partNorm[_task] = norm;
+}
+
+// Sums partial correlations and norms of pair into its first part
+static void do_reducePair(CPUEngine* _cpu, size_t _pair)
+{
+  const size_t parts = _cpu->m_frameParts;
+  const size_t stride = 2*_cpu->m_array.m_maxLag + 1;
+  const size_t maxLag = _cpu->m_array.m_pairs[_pair].m_maxLag;
+  double* xcorr = _cpu->m_partXcorr + _pair * parts * stride;
+  size_t part, idx;
+
+  if (maxLag == 0 || _cpu->m_frameWindow <= 2*maxLag)
+    return; // nothing was correlated
+
+  // all lags, GCC-PHAT has them regardless of search range and may need them for full search
+  for (part = 1; part < parts; ++part)
+  {
+    const double* partXcorr = xcorr + part * stride;
+    for (idx = 0; idx <= 2*maxLag; ++idx)
+      xcorr[idx] += partXcorr[idx];
+    _cpu->m_partNorm[_pair * parts] += _cpu->m_partNorm[_pair * parts + part];
+  }
+}
+
+// Finds lag and confidence of reduced pair within its search range
+static void do_searchPair(CPUEngine* _cpu, size_t _pair)
+{
+  const size_t parts = _cpu->m_frameParts;
+  const size_t stride = 2*_cpu->m_array.m_maxLag + 1;
+  const size_t maxLag = _cpu->m_array.m_pairs[_pair].m_maxLag;
+  const double* xcorr = _cpu->m_partXcorr + _pair * parts * stride;
+  const double norm = _cpu->m_partNorm[_pair * parts];
+  const size_t begin = _cpu->m_pairSearchBegin[_pair];
+  const size_t end = _cpu->m_pairSearchEnd[_pair];
+
+  _cpu->m_pairLag[_pair] = 0.0;
+  _cpu->m_pairConfidence[_pair] = 0.0;
+  _cpu->m_pairWeight[_pair] = 0.0;
+  _cpu->m_pairPeakOnEdge[_pair] = false;
+
+  if (maxLag == 0 || _cpu->m_frameWindow <= 2*maxLag)
+    return; // nothing was correlated
+
+  size_t peak;
+  _cpu->m_pairLag[_pair] = do_peakLag(xcorr, begin, end, maxLag, &peak);
+  const double peakValue = xcorr[peak];
+
+  _cpu->m_pairPeakOnEdge[_pair] = (peak == begin && begin > 0) || (peak + 1 == end && end < 2*maxLag + 1);
+
+  if (norm > 0.0 && peakValue > 0.0)
+    _cpu->m_pairConfidence[_pair] = peakValue >= norm ? 1.0 : peakValue / norm;
+
+  // uncorrelated pair still has a say, so that bearing is reported whenever there is something to correlate
+  _cpu->m_pairWeight[_pair] = _cpu->m_pairConfidence[_pair] + 0.01;
+}
+
+// Correlates every pair over its search range, frame fields are expected to be set
+static int do_correlateFrame(CPUEngine* _cpu, bool _phat)
+{
+  int res;
+  size_t idx;
+
+  _cpu->m_frameParts = do_frameParts(_cpu, _phat);
+
+  const size_t tasks = _cpu->m_array.m_pairCount * _cpu->m_frameParts;
+  if ((res = do_xcorrReserve(_cpu, tasks * (2*_cpu->m_array.m_maxLag + 1))) != 0)
+    return res;
+
+  if ((res = workerPoolRun(&_cpu->m_pool, tasks, &do_correlatePart, _cpu)) != 0)
+  {
+    fprintf(stderr, "workerPoolRun() failed: %d\n", res);
+    return res;
+  }
+
+  for (idx = 0; idx < _cpu->m_array.m_pairCount; ++idx)
+    do_reducePair(_cpu, idx);
+
+  return 0;
+}
+
+// ENODATA if window is too short for any pair; _onEdge tells whether narrowed search may have missed the peak
+static int do_locate(CPUEngine* _cpu, int* _angle, unsigned int* _confidence, bool* _onEdge)
+{
+  int res;
+  size_t idx;
+  double confidence = 0.0;
+  size_t correlated = 0;
+
+  *_onEdge = false;
+
+  for (idx = 0; idx < _cpu->m_array.m_pairCount; ++idx)
+  {
+    do_searchPair(_cpu, idx);
+    if (_cpu->m_pairWeight[idx] > 0.0)
+    {
+      confidence += _cpu->m_pairConfidence[idx];
+      ++correlated;
+    }
+
+    // peak of pair which hears nothing in particular may land anywhere
+    if (_cpu->m_pairPeakOnEdge[idx] && 100.0 * _cpu->m_pairConfidence[idx] >= _cpu->m_frameParams->m_trackConfidence)
+      *_onEdge = true;
+  }
+
+  if (correlated == 0)
+    return ENODATA;
+
+  if ((res = micArrayBearing(&_cpu->m_array, _cpu->m_pairLag, _cpu->m_pairWeight, _angle)) != 0)
+  {
+    fprintf(stderr, "micArrayBearing() failed: %d\n", res);
+    return res;
+  }
+  *_confidence = (unsigned int)(100.0 * confidence / correlated);
+
+  return 0;
+}
+
+
+
+
+int cpuEngineOpen(CPUEngine* _cpu, const AudioDescription* _audioDesc, size_t _capacityFrames, const char* _micGeometry,
+                  size_t _workers, const ThreadAttrConfig* _workerThreadAttr)
+{
+  int res;
+  size_t channel;
+
+  if (_cpu == NULL || _audioDesc == NULL || _capacityFrames == 0 || _workers > WORKER_POOL_SIZE_MAX)
+    return EINVAL;
+  if (_cpu->m_channelData[0] != NULL)
+    return EALREADY;
+
+  if (_audioDesc->m_channels < 2 || _audioDesc->m_channels > TARGET_CHANNELS_MAX || _audioDesc->m_rate == 0)
+  {
+    fprintf(stderr, "CPU backend supports 2 to %d channels, got %u channels at %u Hz\n",
+            TARGET_CHANNELS_MAX, _audioDesc->m_channels, _audioDesc->m_rate);
+    return EINVAL;
+  }
+
+  if ((res = micArrayParseGeometry(&_cpu->m_geometry, _micGeometry, _audioDesc->m_channels)) != 0)
+  {
+    fprintf(stderr, "micArrayParseGeometry(%s) failed: %d\n", _micGeometry ? _micGeometry : "", res);
+    return res;
+  }
+
+  _cpu->m_audioDesc = *_audioDesc;
+  _cpu->m_capacity  = _capacityFrames;
+  _cpu->m_array.m_pairCount = 0;
+  _cpu->m_processedFrames = 0;
+  _cpu->m_processedNs = 0;
+  _cpu->m_narrowFrames = 0;
+  _cpu->m_fullFrames = 0;
+  memset(&_cpu->m_xcorrKernel, 0, sizeof(_cpu->m_xcorrKernel));
+  memset(&_cpu->m_tracker, 0, sizeof(_cpu->m_tracker));
+  _cpu->m_partXcorr = NULL;
+  _cpu->m_partXcorrSize = 0;
+  memset(_cpu->m_channelData, 0, sizeof(_cpu->m_channelData));
+  memset(_cpu->m_scratch, 0, sizeof(_cpu->m_scratch));
+  memset(&_cpu->m_pool, 0, sizeof(_cpu->m_pool));
+
+  for (channel = 0; channel < _audioDesc->m_channels; ++channel)
+    if ((_cpu->m_channelData[channel] = malloc(_capacityFrames * sizeof(*_cpu->m_channelData[channel]))) == NULL)
+    {
+      fprintf(stderr, "malloc(%zu frames) failed\n", _capacityFrames);
+      cpuEngineClose(_cpu);
+      return ENOMEM;
+    }
+
+  const size_t workers = _workers != 0 ? _workers : workerPoolOnlineCPUs();
+  if ((res = workerPoolOpen(&_cpu->m_pool, workers, _workerThreadAttr)) != 0)
+  {
+    fprintf(stderr, "workerPoolOpen(%zu) failed: %d\n", workers, res);
+    cpuEngineClose(_cpu);
+    return res;
+  }
+
+  return 0;
+}
+
+int cpuEngineClose(CPUEngine* _cpu)
+{
+  size_t idx;
+
+  if (_cpu == NULL)
+    return EINVAL;
+
+  if (workerPoolSize(&_cpu->m_pool) != 0)
+    workerPoolClose(&_cpu->m_pool);
+
+  for (idx = 0; idx < TARGET_CHANNELS_MAX; ++idx)
+  {
+    free(_cpu->m_channelData[idx]);
+    _cpu->m_channelData[idx] = NULL;
+  }
+
+  for (idx = 0; idx < WORKER_POOL_SIZE_MAX; ++idx)
+    do_scratchFree(&_cpu->m_scratch[idx]);
+
+  free(_cpu->m_partXcorr);
+  _cpu->m_partXcorr = NULL;
+  _cpu->m_partXcorrSize = 0;
+
+  _cpu->m_capacity = 0;
+
+  return 0;
+}
+
+int cpuEngineProcess(CPUEngine* _cpu,
+                     const void* _srcPtr, size_t _srcDataSize,
+                     const TargetDetectParams* _targetDetectParams,
+                     TargetLocation* _targetLocation)
+{
+  int res;
+  size_t idx;
+
+  if (_cpu == NULL || _srcPtr == NULL || _targetDetectParams == NULL || _targetLocation == NULL)
+    return EINVAL;
+  if (_cpu->m_channelData[0] == NULL)
+    return ENOTCONN;
+
+  const long long startNs = do_monotonicNs();
+  const size_t channels = _cpu->m_audioDesc.m_channels;
+
+  size_t frames = _srcDataSize / (channels * sizeof(int16_t));
+  if (frames > _cpu->m_capacity)
+    frames = _cpu->m_capacity;
+  if (_targetDetectParams->m_numSamples != 0 && _targetDetectParams->m_numSamples < frames)
+    frames = _targetDetectParams->m_numSamples;
+
+  soundKernelDeinterleaveNS16((const int16_t*)_srcPtr, frames, channels, _cpu->m_channelData);
+
+  _targetLocation->m_targetAngle = 0;
+  _targetLocation->m_confidence  = 0;
+  _targetLocation->m_channels    = channels;
+  for (idx = 0; idx < channels; ++idx)
+    _targetLocation->m_channelVolume[idx] = do_volume(_cpu->m_channelData[idx], frames, _targetDetectParams->m_volumeCoefficient);
+  _targetLocation->m_targetLeftVolume  = _targetLocation->m_channelVolume[0];
+  _targetLocation->m_targetRightVolume = _targetLocation->m_channelVolume[1];
+
+  // DC offset of cheap microphones biases correlation towards zero lag
+  for (idx = 0; idx < channels; ++idx)
+    soundKernelRemoveDCS16(_cpu->m_channelData[idx], frames);
+
+  size_t window = _targetDetectParams->m_windowSize;
+  if (window == 0 || window > frames)
+    window = frames;
+
+  if ((res = do_arrayUpdate(_cpu, _targetDetectParams->m_micDistance)) != 0)
+    return res;
+
+  // nothing to correlate, report volume only; frames submitted before frame size is set are empty
+  const size_t maxLag = _cpu->m_array.m_maxLag;
+  if (maxLag == 0 || window == 0)
+    goto exit_stats;
+
+  if (   (_cpu->m_xcorrKernel.m_window != window || _cpu->m_xcorrKernel.m_maxLag != maxLag)
+      && (res = xcorrKernelSelect(&_cpu->m_xcorrKernel, window, maxLag)) != 0)
+  {
+    fprintf(stderr, "xcorrKernelSelect(%zu, %zu) failed: %d\n", window, maxLag, res);
+    return res;
+  }
+
+  const bool phat = _targetDetectParams->m_algorithm == TARGET_DETECT_ALGORITHM_GCC_PHAT;
+  for (idx = 0; phat && idx < workerPoolSize(&_cpu->m_pool); ++idx)
+    if ((res = do_fftReserve(&_cpu->m_scratch[idx], window, maxLag)) != 0)
+      return res;
+
+  _cpu->m_frameParams = _targetDetectParams;
+  _cpu->m_frameFrames = frames;
+  _cpu->m_frameWindow = window;
+
+  targetTrackerConfigure(&_cpu->m_tracker, _targetDetectParams->m_trackGain, _targetDetectParams->m_trackConfidence);
+
+  double predicted = 0.0;
+  const bool narrow = targetTrackerPredict(&_cpu->m_tracker, &predicted);
+  do_searchSetup(_cpu, narrow, predicted);
+
+  if ((res = do_correlateFrame(_cpu, phat)) != 0)
+    return res;
+
+  int angle = 0;
+  unsigned int confidence = 0;
+  bool onEdge;
+  res = do_locate(_cpu, &angle, &confidence, &onEdge);
+  if (res != 0 && res != ENODATA)
+    return res;
+
+  // target moved off prediction or is lost, redo with all lags; GCC-PHAT has them computed already
+  bool tracked = narrow;
+  if (narrow && (res != 0 || onEdge || confidence < _targetDetectParams->m_trackConfidence))
+  {
+    tracked = false;
+    do_searchSetup(_cpu, false, 0.0);
+    if (!phat && (res = do_correlateFrame(_cpu, phat)) != 0)
+      return res;
+
+    res = do_locate(_cpu, &angle, &confidence, &onEdge);
+    if (res != 0 && res != ENODATA)
+      return res;
+  }
+
+  if (tracked)
+    _cpu->m_narrowFrames += 1;
+  else
+    _cpu->m_fullFrames += 1;
+
+  if (res == ENODATA)
+    goto exit_stats; // window too short for any pair, report volume only
+
+  _targetLocation->m_targetAngle = targetTrackerUpdate(&_cpu->m_tracker, angle, confidence);
+  _targetLocation->m_confidence  = confidence;
+
+ exit_stats:
+  _cpu->m_processedFrames += 1;
+  _cpu->m_processedNs += do_monotonicNs() - startNs;
+
+  return 0;
+}
+
+int cpuEngineReportLoad(CPUEngine* _cpu, long long _ms)
+{
+  if (_cpu == NULL)
+    return EINVAL;
+  if (_cpu->m_channelData[0] == NULL)
+    return ENOTCONN;
+
+  const long long frames = _cpu->m_processedFrames;
+  const long long ns = _cpu->m_processedNs;
+
+  fprintf(stderr, "CPU load %lld%% (%s kernels, %s correlation, %u channels, %zu workers, %lu steals), %lld frames, %lld us/frame\n",
+          _ms > 0 ? ns / (_ms * 10000ll) : 0ll,
+          soundKernelsName(),
+          _cpu->m_xcorrKernel.m_name != NULL ? _cpu->m_xcorrKernel.m_name : "none",
+          _cpu->m_audioDesc.m_channels,
+          workerPoolSize(&_cpu->m_pool),
+          workerPoolTakeSteals(&_cpu->m_pool),
+          frames,
+          frames > 0 ? ns / (frames * 1000ll) : 0ll);
+
+  if (_cpu->m_tracker.m_gain != 0)
+    fprintf(stderr, "Bearing tracking: %lld narrow, %lld full search frames\n", _cpu->m_narrowFrames, _cpu->m_fullFrames);
+
+  _cpu->m_processedFrames = 0;
+  _cpu->m_processedNs = 0;
+  _cpu->m_narrowFrames = 0;
+  _cpu->m_fullFrames = 0;
+
+  return 0;
+}
@@ -9,12 +9,16 @@
 #include <sys/stat.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <errno.h>
 #include <termios.h>
 #include <netdb.h>
 #include <linux/input.h>
 
+#include "sound_sensor_result.h"
 #include "internal/module_rc.h"
+#include "internal/sound_gate.h"
+#include "internal/target_tracker.h"
 
 static int do_openFifoInput(RCInput* _rc, const char* _fifoInputName)
 {
@@ -39,7 +43,8 @@ static int do_openFifoInput(RCInput* _rc, const char* _fifoInputName)
       fprintf(stderr, "mkfifo(%s) failed, continuing: %d\n", _fifoInputName, res);
   }
 
-  _rc->m_fifoInputFd = open(_fifoInputName, O_RDONLY|O_NONBLOCK);
+  // opened for writing too, so fifo never reports eof when a writer goes away and needs no reopen
+  _rc->m_fifoInputFd = open(_fifoInputName, O_RDWR|O_NONBLOCK);
   if (_rc->m_fifoInputFd < 0)
   {
     res = errno;
@@ -104,7 +109,7 @@ static int do_reopenFifoInput(RCInput* _rc)
     return res;
   }
 
-  _rc->m_fifoInputFd = open(_rc->m_fifoInputName, O_RDONLY|O_NONBLOCK);
+  _rc->m_fifoInputFd = open(_rc->m_fifoInputName, O_RDWR|O_NONBLOCK);
   if (_rc->m_fifoInputFd < 0)
   {
     res = errno;
@@ -212,6 +217,7 @@ static int do_startTargetDetectParams(RCInput* _rc)
 
   _rc->m_targetDetectParamsUpdated = true;
   _rc->m_targetDetectCommandUpdated = true;
+  _rc->m_videoOutParamsUpdated = true;
 
   return 0;
 }
@@ -227,6 +233,183 @@ static int do_stopTargetDetectParams(RCInput* _rc)
   return 0;
 }
 
+// Single command line without trailing newline
+static int do_parseCommand(RCInput* _rc, char* _line)
+{
+  char* parseAt = _line;
+
+  if (strncmp(parseAt, "detect", strlen("detect")) == 0)
+  {
+    _rc->m_targetDetectCommand = 1;
+    _rc->m_targetDetectCommandUpdated = true;
+  }
+  else if (strcmp(parseAt, "stats") == 0)
+    _rc->m_statsRequested = true;
+  else if (strncmp(parseAt, "volcoeff ", strlen("volcoeff ")) == 0)
+  {
+    unsigned int input_param1; 					// Input parameter
+    parseAt += strlen("volcoeff ");
+
+    if ((sscanf(parseAt, "%d", &input_param1)) != 1)
+      fprintf(stderr, "Cannot parse volCoeff command, args '%s'\n", parseAt);
+    else
+    {
+      _rc->m_volumeCoefficient 	    = input_param1;
+      _rc->m_targetDetectParamsUpdated = true;
+      fprintf(stderr, "volCoeff = %d\n", input_param1);
+    }
+  }
+  else if (strncmp(parseAt, "micdist ", strlen("micdist ")) == 0)
+  {
+    unsigned int input_param1; 					// Input parameter
+    parseAt += strlen("micdist ");
+
+    if ((sscanf(parseAt, "%d", &input_param1)) != 1)
+      fprintf(stderr, "Cannot parse micDist command, args '%s'\n", parseAt);
+    else
+    {
+      _rc->m_micDistance	    = input_param1;
+      _rc->m_targetDetectParamsUpdated = true;
+      fprintf(stderr, "micDist = %d\n", input_param1);
+    }
+  }
+  else if (strncmp(parseAt, "winsize ", strlen("winsize ")) == 0)
+  {
+    unsigned int input_param1; 					// Input parameter
+    parseAt += strlen("winsize ");
+
+    if ((sscanf(parseAt, "%d", &input_param1)) != 1)
+      fprintf(stderr, "Cannot parse winSize command, args '%s'\n", parseAt);
+    else
+    {
+      _rc->m_windowSize	    = input_param1;
+      _rc->m_targetDetectParamsUpdated = true;
+      fprintf(stderr, "winSize = %d\n", input_param1);
+    }
+  }
+  else if (strncmp(parseAt, "numsamples ", strlen("numsamples ")) == 0)
+  {
+    unsigned int input_param1; 					// Input parameter
+    parseAt += strlen("numsamples ");
+
+    if ((sscanf(parseAt, "%d", &input_param1)) != 1)
+      fprintf(stderr, "Cannot parse numSamples command, args '%s'\n", parseAt);
+    else
+    {
+      _rc->m_numSamples	    = input_param1;
+      _rc->m_targetDetectParamsUpdated = true;
+      fprintf(stderr, "numSamples = %d\n", input_param1);
+    }
+  }
+  else if (strncmp(parseAt, "hop ", strlen("hop ")) == 0)
+  {
+    unsigned int input_param1; 					// Input parameter
+    parseAt += strlen("hop ");
+
+    if ((sscanf(parseAt, "%u", &input_param1)) != 1)
+      fprintf(stderr, "Cannot parse hop command, args '%s'\n", parseAt);
+    else
+    {
+      _rc->m_hopSize	    = input_param1;
+      _rc->m_targetDetectParamsUpdated = true;
+      fprintf(stderr, "hop = %u\n", input_param1);
+    }
+  }
+  else if (strncmp(parseAt, "gate ", strlen("gate ")) == 0)
+  {
+    unsigned int input_param1; 					// Input parameter
+    parseAt += strlen("gate ");
+
+    if ((sscanf(parseAt, "%u", &input_param1)) != 1 || input_param1 > SOUND_GATE_THRESHOLD_MAX)
+      fprintf(stderr, "Cannot parse gate command, args '%s'\n", parseAt);
+    else
+    {
+      _rc->m_gateThreshold	    = input_param1;
+      _rc->m_targetDetectParamsUpdated = true;
+      fprintf(stderr, "gate = %u\n", input_param1);
+    }
+  }
+  else if (strncmp(parseAt, "gatehyst ", strlen("gatehyst ")) == 0)
+  {
+    unsigned int input_param1; 					// Input parameter
+    parseAt += strlen("gatehyst ");
+
+    if ((sscanf(parseAt, "%u", &input_param1)) != 1)
+      fprintf(stderr, "Cannot parse gatehyst command, args '%s'\n", parseAt);
+    else
+    {
+      _rc->m_gateHysteresis	    = input_param1;
+      _rc->m_targetDetectParamsUpdated = true;
+      fprintf(stderr, "gatehyst = %u\n", input_param1);
+    }
+  }
+  else if (strncmp(parseAt, "track ", strlen("track ")) == 0)
+  {
+    unsigned int input_param1; 					// Input parameter
+    parseAt += strlen("track ");
+
+    if ((sscanf(parseAt, "%u", &input_param1)) != 1 || input_param1 > TARGET_TRACKER_GAIN_MAX)
+      fprintf(stderr, "Cannot parse track command, args '%s'\n", parseAt);
+    else
+    {
+      _rc->m_trackGain	    = input_param1;
+      _rc->m_targetDetectParamsUpdated = true;
+      fprintf(stderr, "track = %u\n", input_param1);
+    }
+  }
+  else if (strncmp(parseAt, "trackconf ", strlen("trackconf ")) == 0)
+  {
+    unsigned int input_param1; 					// Input parameter
+    parseAt += strlen("trackconf ");
+
+    if ((sscanf(parseAt, "%u", &input_param1)) != 1 || input_param1 > 100)
+      fprintf(stderr, "Cannot parse trackconf command, args '%s'\n", parseAt);
+    else
+    {
+      _rc->m_trackConfidence	    = input_param1;
+      _rc->m_targetDetectParamsUpdated = true;
+      fprintf(stderr, "trackconf = %u\n", input_param1);
+    }
+  }
+  else if (strncmp(parseAt, "alg ", strlen("alg ")) == 0)
+  {
+    parseAt += strlen("alg ");
+
+    if (strcmp(parseAt, "xcorr") == 0)
+      _rc->m_algorithm = TARGET_DETECT_ALGORITHM_XCORR;
+    else if (strcmp(parseAt, "gccphat") == 0)
+      _rc->m_algorithm = TARGET_DETECT_ALGORITHM_GCC_PHAT;
+    else
+    {
+      fprintf(stderr, "Cannot parse alg command, args '%s'\n", parseAt);
+      return EINVAL;
+    }
+
+    _rc->m_targetDetectParamsUpdated = true;
+    fprintf(stderr, "alg = %s\n", parseAt);
+  }
+  else if (strncmp(parseAt, "video_out ", strlen("video_out ")) == 0)
+  {
+    bool videoOutEnable;
+    parseAt += strlen("video_out ");
+
+    if ((sscanf(parseAt, "%d", &videoOutEnable)) != 1)
+      fprintf(stderr, "Cannot parse video_out command, args '%s'\n", parseAt);
+    else
+    {
+      _rc->m_videoOutEnable        = videoOutEnable;
+      _rc->m_videoOutParamsUpdated = true;
+    }
+  }
+  else
+  {
+    fprintf(stderr, "Unknown command '%s'\n", parseAt);
+    return EINVAL;
+  }
+
+  return 0;
+}
+
 static int do_readFifoInput(RCInput* _rc)
 {
   int res;
@@ -255,6 +438,8 @@ static int do_readFifoInput(RCInput* _rc)
     else
     {
       res = errno;
+      if (res == EAGAIN || res == EINTR)
+        return 0;
       fprintf(stderr, "read(%d, %zu) failed: %d\n", _rc->m_fifoInputFd, available, res);
     }
 
@@ -278,82 +463,7 @@ static int do_readFifoInput(RCInput* _rc)
   {
     *parseTill = '\0';
 
-    if (strncmp(parseAt, "detect", strlen("detect")) == 0)
-    {
-      _rc->m_targetDetectCommand = 1;
-      _rc->m_targetDetectCommandUpdated = true;
-    }
-    else if (strncmp(parseAt, "volcoeff ", strlen("volcoeff ")) == 0)
-    {
-      unsigned int input_param1; 					// Input parameter
-      parseAt += strlen("volcoeff ");
-
-      if ((sscanf(parseAt, "%d", &input_param1)) != 1)
-        fprintf(stderr, "Cannot parse volCoeff command, args '%s'\n", parseAt);
-      else
-      {
-        _rc->m_volumeCoefficient 	    = input_param1;
-        _rc->m_targetDetectParamsUpdated = true;
-        fprintf(stderr, "volCoeff = %d\n", input_param1);
-      }
-    }
-    else if (strncmp(parseAt, "micdist ", strlen("micdist ")) == 0)
-    {
-      unsigned int input_param1; 					// Input parameter
-      parseAt += strlen("micdist ");
-
-      if ((sscanf(parseAt, "%d", &input_param1)) != 1)
-        fprintf(stderr, "Cannot parse micDist command, args '%s'\n", parseAt);
-      else
-      {
-        _rc->m_micDistance	    = input_param1;
-        _rc->m_targetDetectParamsUpdated = true;
-        fprintf(stderr, "micDist = %d\n", input_param1);
-      }
-    }
-    else if (strncmp(parseAt, "winsize ", strlen("winsize ")) == 0)
-    {
-      unsigned int input_param1; 					// Input parameter
-      parseAt += strlen("winsize ");
-
-      if ((sscanf(parseAt, "%d", &input_param1)) != 1)
-        fprintf(stderr, "Cannot parse winSize command, args '%s'\n", parseAt);
-      else
-      {
-        _rc->m_windowSize	    = input_param1;
-        _rc->m_targetDetectParamsUpdated = true;
-        fprintf(stderr, "winSize = %d\n", input_param1);
-      }
-    }
-    else if (strncmp(parseAt, "numsamples ", strlen("numsamples ")) == 0)
-    {
-      unsigned int input_param1; 					// Input parameter
-      parseAt += strlen("numsamples ");
-
-      if ((sscanf(parseAt, "%d", &input_param1)) != 1)
-        fprintf(stderr, "Cannot parse numSamples command, args '%s'\n", parseAt);
-      else
-      {
-        _rc->m_numSamples	    = input_param1;
-        _rc->m_targetDetectParamsUpdated = true;
-        fprintf(stderr, "numSamples = %d\n", input_param1);
-      }
-    }
-    else if (strncmp(parseAt, "video_out ", strlen("video_out ")) == 0)
-    {
-      bool videoOutEnable;
-      parseAt += strlen("video_out ");
-
-      if ((sscanf(parseAt, "%d", &videoOutEnable)) != 1)
-        fprintf(stderr, "Cannot parse video_out command, args '%s'\n", parseAt);
-      else
-      {
-        _rc->m_videoOutEnable        = videoOutEnable;
-        _rc->m_videoOutParamsUpdated = true;
-      }
-    }
-    else
-      fprintf(stderr, "Unknown command '%s'\n", parseAt);
+    do_parseCommand(_rc, parseAt);
 
     parseAt = parseTill+1;
   }
@@ -381,23 +491,23 @@ int rcInputOpen(RCInput* _rc, const RCConfig* _config)
 
   if (_rc == NULL)
     return EINVAL;
-  if (_rc->m_fifoInputFd != -1 || _rc->m_fifoOutputFd != -1)
+  if (_rc->m_fifoInputFd != -1)
     return EALREADY;
 
   if ((res = do_openFifoInput(_rc, _config->m_fifoInput)) != 0)
     return res;
 
-  if ((res = do_openFifoOutput(_rc, _config->m_fifoOutput)) != 0)
-  {
-    do_closeFifoInput(_rc);
-    return res;
-  }
-
   _rc->m_fifoInputReadBufferSize = 1000;
   _rc->m_fifoInputReadBufferUsed = 0;
   _rc->m_fifoInputReadBuffer = malloc(_rc->m_fifoInputReadBufferSize);
 
   _rc->m_videoOutEnable = _config->m_videoOutEnable;
+  _rc->m_hopSize = _config->m_hopSize;
+  _rc->m_algorithm = _config->m_algorithm;
+  _rc->m_gateThreshold = _config->m_gateThreshold;
+  _rc->m_gateHysteresis = _config->m_gateHysteresis;
+  _rc->m_trackGain = _config->m_trackGain;
+  _rc->m_trackConfidence = _config->m_trackConfidence;
   return 0;
 }
 
@@ -405,7 +515,7 @@ int rcInputClose(RCInput* _rc)
 {
   if (_rc == NULL)
     return EINVAL;
-  if (_rc->m_fifoInputFd == -1 && _rc->m_fifoOutputFd == -1)
+  if (_rc->m_fifoInputFd == -1)
     return EALREADY;
 
   if (_rc->m_fifoInputReadBuffer)
@@ -413,19 +523,44 @@ int rcInputClose(RCInput* _rc)
   _rc->m_fifoInputReadBuffer = NULL;
   _rc->m_fifoInputReadBufferSize = 0;
 
-  do_closeFifoOutput(_rc);
   do_closeFifoInput(_rc);
 
   return 0;
 }
 
+int rcInputOpenOutput(RCInput* _rc, const RCConfig* _config)
+{
+  int res;
+
+  if (_rc == NULL || _config == NULL)
+    return EINVAL;
+  if (_rc->m_fifoOutputFd != -1)
+    return EALREADY;
+
+  if ((res = do_openFifoOutput(_rc, _config->m_fifoOutput)) != 0)
+    return res;
+
+  _rc->m_fifoOutputBinary = _config->m_outputBinary;
+  return 0;
+}
+
+int rcInputCloseOutput(RCInput* _rc)
+{
+  if (_rc == NULL)
+    return EINVAL;
+  if (_rc->m_fifoOutputFd == -1 && _rc->m_fifoOutputName == NULL)
+    return EALREADY;
+
+  return do_closeFifoOutput(_rc);
+}
+
 int rcInputStart(RCInput* _rc)
 {
   int res;
 
   if (_rc == NULL)
     return EINVAL;
-  if (_rc->m_fifoInputFd == -1 && _rc->m_fifoOutputFd == -1)
+  if (_rc->m_fifoInputFd == -1)
     return ENOTCONN;
 
   if ((res = do_startTargetDetectParams(_rc)) != 0)
@@ -438,7 +573,7 @@ int rcInputStop(RCInput* _rc)
 {
   if (_rc == NULL)
     return EINVAL;
-  if (_rc->m_fifoInputFd == -1 && _rc->m_fifoOutputFd == -1)
+  if (_rc->m_fifoInputFd == -1)
     return ENOTCONN;
 
   do_stopTargetDetectParams(_rc);
@@ -459,6 +594,14 @@ int rcInputReadFifoInput(RCInput* _rc)
   return 0;
 }
 
+int rcInputParseCommand(RCInput* _rc, char* _line)
+{
+  if (_rc == NULL || _line == NULL)
+    return EINVAL;
+
+  return do_parseCommand(_rc, _line);
+}
+
 int rcInputGetTargetDetectParams(RCInput* _rc,
                                  TargetDetectParams* _targetDetectParams)
 {
@@ -473,6 +616,12 @@ int rcInputGetTargetDetectParams(RCInput* _rc,
   _targetDetectParams->m_micDistance 				= _rc->m_micDistance;
   _targetDetectParams->m_windowSize 				= _rc->m_windowSize;
   _targetDetectParams->m_numSamples 				= _rc->m_numSamples;
+  _targetDetectParams->m_hopSize 				= _rc->m_hopSize;
+  _targetDetectParams->m_algorithm 				= _rc->m_algorithm;
+  _targetDetectParams->m_gateThreshold 			= _rc->m_gateThreshold;
+  _targetDetectParams->m_gateHysteresis 			= _rc->m_gateHysteresis;
+  _targetDetectParams->m_trackGain 				= _rc->m_trackGain;
+  _targetDetectParams->m_trackConfidence 			= _rc->m_trackConfidence;
 
   return 0;
 }
@@ -483,12 +632,28 @@ int rcInputGetVideoOutParams(RCInput* _rc,
   if (_rc == NULL || _videoOutEnable == NULL)
     return EINVAL;
 
+  if (!_rc->m_videoOutParamsUpdated)
+    return ENODATA;
+
   _rc->m_videoOutParamsUpdated = false;
   *_videoOutEnable             = _rc->m_videoOutEnable;
 
   return 0;
 }
 
+int rcInputGetStatsRequest(RCInput* _rc)
+{
+  if (_rc == NULL)
+    return EINVAL;
+
+  if (!_rc->m_statsRequested)
+    return ENODATA;
+
+  _rc->m_statsRequested = false;
+
+  return 0;
+}
+
 int rcInputGetTargetDetectCommand(RCInput* _rc, TargetDetectCommand* _targetDetectCommand)
 {
   if (_rc == NULL || _targetDetectCommand == NULL)
@@ -503,13 +668,12 @@ int rcInputGetTargetDetectCommand(RCInput* _rc, TargetDetectCommand* _targetDete
   return 0;
 }
 
-#warning TODO code below if unsafe since it is used from another thread; consider reworking
 int rcInputUnsafeReportTargetLocation(RCInput* _rc, const TargetLocation* _targetLocation)
 {
   if (_rc == NULL || _targetLocation == NULL)
     return EINVAL;
 
-  if (!_rc->m_fifoOutputFd != -1)
+  if (_rc->m_fifoOutputFd != -1)
   {
     /*
 	 dprintf(_rc->m_fifoOutputFd, "loc: %d %d %d\n",
@@ -517,22 +681,20 @@ int rcInputUnsafeReportTargetLocation(RCInput* _rc, const TargetLocation* _targe
     		_targetLocation->m_targetY,
     		_targetLocation->m_targetSize);
     */
-	dprintf(_rc->m_fifoOutputFd, "sound: %d %d %d\n",
-			_targetLocation->m_targetAngle,
-			_targetLocation->m_targetLeftVolume,
-			_targetLocation->m_targetRightVolume);
+	char text[128];
+	resultLocationFormat(_targetLocation, text, sizeof(text));
+	dprintf(_rc->m_fifoOutputFd, "%s", text);
   }
 
   return 0;
 }
 
-#warning TODO code below if unsafe since it is used from another thread; consider reworking
 int rcInputUnsafeReportTargetDetectParams(RCInput* _rc, const TargetDetectParams* _targetDetectParams)
 {
   if (_rc == NULL || _targetDetectParams == NULL)
     return EINVAL;
 
-  if (!_rc->m_fifoOutputFd != -1)
+  if (_rc->m_fifoOutputFd != -1)
   {
 	  /*
 	  dprintf(_rc->m_fifoOutputFd, "hsv: %d %d %d %d %d %d\n",
@@ -546,3 +708,47 @@ int rcInputUnsafeReportTargetDetectParams(RCInput* _rc, const TargetDetectParams
   return 0;
 }
 
+int rcInputUnsafeReportResults(RCInput* _rc, const ResultRecord* _records, size_t _count)
+{
+  int res;
+  size_t idx;
+
+  if (_rc == NULL || _records == NULL || _count > RC_OUTPUT_BATCH_MAX)
+    return EINVAL;
+
+  if (!_rc->m_fifoOutputBinary)
+  {
+    for (idx = 0; idx < _count; ++idx)
+    {
+      if (_records[idx].m_kind == RESULT_KIND_TARGET_DETECT_PARAMS)
+        rcInputUnsafeReportTargetDetectParams(_rc, &_records[idx].m_targetDetectParams);
+      else
+        rcInputUnsafeReportTargetLocation(_rc, &_records[idx].m_targetLocation);
+    }
+
+    return 0;
+  }
+
+  if (_rc->m_fifoOutputFd == -1 || _count == 0)
+    return 0;
+
+  SoundSensorResult packed[RC_OUTPUT_BATCH_MAX];
+  struct iovec iov[RC_OUTPUT_BATCH_MAX];
+  for (idx = 0; idx < _count; ++idx)
+  {
+    resultRecordPack(&_records[idx], &packed[idx]);
+    iov[idx].iov_base = &packed[idx];
+    iov[idx].iov_len  = sizeof(packed[idx]);
+  }
+
+  // nobody reading or reader is slow - batch is lost, sequence gap tells reader about it
+  if (writev(_rc->m_fifoOutputFd, iov, _count) < 0)
+  {
+    res = errno;
+    if (res != EAGAIN)
+      fprintf(stderr, "writev(%zu results) failed: %d\n", _count, res);
+  }
+
+  return 0;
+}
+
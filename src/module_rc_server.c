@@ -0,0 +1,529 @@
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+
+#include "sound_sensor_result.h"
+#include "internal/module_rc_server.h"
+
+
+static int do_epollWatch(RCServer* _server, int _fd, int _op, uint32_t _events)
+{
+  struct epoll_event event;
+
+  memset(&event, 0, sizeof(event));
+  event.events  = _events;
+  event.data.fd = _fd;
+
+  if (epoll_ctl(_server->m_epollFd, _op, _fd, &event) != 0)
+    return errno;
+
+  return 0;
+}
+
+static int do_openSocket(RCServer* _server, const char* _socketPath)
+{
+  int res;
+  struct sockaddr_un addr;
+
+  if (_socketPath == NULL)
+    return 0;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if (strlen(_socketPath) >= sizeof(addr.sun_path))
+  {
+    fprintf(stderr, "Socket path '%s' too long\n", _socketPath);
+    return ENAMETOOLONG;
+  }
+  strcpy(addr.sun_path, _socketPath);
+
+  _server->m_listenFd = socket(AF_UNIX, SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC, 0);
+  if (_server->m_listenFd < 0)
+  {
+    res = errno;
+    fprintf(stderr, "socket(AF_UNIX) failed: %d\n", res);
+    _server->m_listenFd = -1;
+    return res;
+  }
+
+  // stale socket of previous run
+  unlink(_socketPath);
+
+  if (bind(_server->m_listenFd, (const struct sockaddr*)&addr, sizeof(addr)) != 0)
+  {
+    res = errno;
+    fprintf(stderr, "bind(%s) failed: %d\n", _socketPath, res);
+    goto exit_close;
+  }
+
+  if (chmod(_socketPath, S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP) != 0)
+  {
+    res = errno;
+    fprintf(stderr, "chmod(%s) failed, continuing: %d\n", _socketPath, res);
+  }
+
+  if (listen(_server->m_listenFd, RC_SERVER_CLIENTS_MAX) != 0)
+  {
+    res = errno;
+    fprintf(stderr, "listen(%s) failed: %d\n", _socketPath, res);
+    goto exit_unlink;
+  }
+
+  if ((res = do_epollWatch(_server, _server->m_listenFd, EPOLL_CTL_ADD, EPOLLIN)) != 0)
+  {
+    fprintf(stderr, "epoll_ctl(listen) failed: %d\n", res);
+    goto exit_unlink;
+  }
+
+  _server->m_socketPath = strdup(_socketPath);
+
+  return 0;
+
+
+ exit_unlink:
+  unlink(_socketPath);
+ exit_close:
+  close(_server->m_listenFd);
+  _server->m_listenFd = -1;
+  return res;
+}
+
+static RCServerClient* do_findClient(RCServer* _server, int _fd)
+{
+  size_t idx;
+  for (idx = 0; idx < RC_SERVER_CLIENTS_MAX; ++idx)
+    if (_server->m_clients[idx].m_fd == _fd)
+      return &_server->m_clients[idx];
+
+  return NULL;
+}
+
+// Caller holds mutex
+static void do_closeClient(RCServer* _server, RCServerClient* _client)
+{
+  if (_client->m_dropCounter != 0)
+    fprintf(stderr, "Client %d disconnected, %llu results dropped\n", _client->m_fd, _client->m_dropCounter);
+
+  // closing removes it from epoll set
+  close(_client->m_fd);
+  _client->m_fd = -1;
+  (void)_server;
+}
+
+// Caller holds mutex
+static void do_flushClient(RCServer* _server, RCServerClient* _client)
+{
+  int res;
+
+  if (_client->m_sendBufferUsed > 0)
+  {
+    const ssize_t sent = send(_client->m_fd, _client->m_sendBuffer, _client->m_sendBufferUsed, MSG_DONTWAIT|MSG_NOSIGNAL);
+    if (sent < 0)
+    {
+      res = errno;
+      if (res != EAGAIN && res != EINTR)
+      {
+        // input thread gets EPOLLERR/EPOLLHUP and closes it
+        _client->m_sendBufferUsed = 0;
+        _client->m_subscribed = false;
+      }
+    }
+    else
+    {
+      _client->m_sendBufferUsed -= sent;
+      memmove(_client->m_sendBuffer, _client->m_sendBuffer + sent, _client->m_sendBufferUsed);
+    }
+  }
+
+  const bool sendPending = _client->m_sendBufferUsed > 0;
+  if (sendPending != _client->m_sendPending)
+  {
+    if ((res = do_epollWatch(_server, _client->m_fd, EPOLL_CTL_MOD, sendPending ? EPOLLIN|EPOLLOUT : EPOLLIN)) != 0)
+      fprintf(stderr, "epoll_ctl(client %d) failed: %d\n", _client->m_fd, res);
+    else
+      _client->m_sendPending = sendPending;
+  }
+}
+
+static int do_acceptClient(RCServer* _server)
+{
+  int res;
+  RCServerClient* client;
+
+  const int fd = accept4(_server->m_listenFd, NULL, NULL, SOCK_NONBLOCK|SOCK_CLOEXEC);
+  if (fd < 0)
+  {
+    res = errno;
+    if (res == EAGAIN || res == EINTR || res == ECONNABORTED)
+      return 0;
+    fprintf(stderr, "accept() failed: %d\n", res);
+    return res;
+  }
+
+  pthread_mutex_lock(&_server->m_mutex);
+
+  if ((client = do_findClient(_server, -1)) == NULL)
+  {
+    pthread_mutex_unlock(&_server->m_mutex);
+    fprintf(stderr, "Too many clients, rejected\n");
+    close(fd);
+    return 0;
+  }
+
+  if ((res = do_epollWatch(_server, fd, EPOLL_CTL_ADD, EPOLLIN)) != 0)
+  {
+    pthread_mutex_unlock(&_server->m_mutex);
+    fprintf(stderr, "epoll_ctl(client %d) failed: %d\n", fd, res);
+    close(fd);
+    return 0;
+  }
+
+  memset(client, 0, sizeof(*client));
+  client->m_fd = fd;
+
+  pthread_mutex_unlock(&_server->m_mutex);
+
+  return 0;
+}
+
+static void do_parseClientCommand(RCServer* _server, RCInput* _rc, RCServerClient* _client, char* _line)
+{
+  const size_t length = strlen(_line);
+  if (length > 0 && _line[length-1] == '\r')
+    _line[length-1] = '\0';
+
+  if (strncmp(_line, "subscribe", strlen("subscribe")) == 0)
+  {
+    const char* args = _line + strlen("subscribe");
+    bool binary;
+
+    if (*args == '\0' || strcmp(args, " text") == 0)
+      binary = false;
+    else if (strcmp(args, " binary") == 0)
+      binary = true;
+    else
+    {
+      fprintf(stderr, "Cannot parse subscribe command, args '%s'\n", args);
+      return;
+    }
+
+    pthread_mutex_lock(&_server->m_mutex);
+    _client->m_subscribed = true;
+    _client->m_binary     = binary;
+    pthread_mutex_unlock(&_server->m_mutex);
+  }
+  else if (strcmp(_line, "unsubscribe") == 0)
+  {
+    pthread_mutex_lock(&_server->m_mutex);
+    _client->m_subscribed = false;
+    pthread_mutex_unlock(&_server->m_mutex);
+  }
+  else if (strcmp(_line, "stats") == 0 && _server->m_stats != NULL)
+  {
+    char reply[RC_SERVER_SEND_BUFFER_SIZE/2];
+    const size_t replySize = statsFormat(_server->m_stats, reply, sizeof(reply));
+
+    pthread_mutex_lock(&_server->m_mutex);
+    if (_client->m_sendBufferUsed + replySize <= sizeof(_client->m_sendBuffer))
+    {
+      memcpy(_client->m_sendBuffer + _client->m_sendBufferUsed, reply, replySize);
+      _client->m_sendBufferUsed += replySize;
+      do_flushClient(_server, _client);
+    }
+    pthread_mutex_unlock(&_server->m_mutex);
+  }
+  else
+    rcInputParseCommand(_rc, _line);
+}
+
+// Returns false when client is gone
+static bool do_readClient(RCServer* _server, RCInput* _rc, RCServerClient* _client)
+{
+  int res;
+
+  if (_client->m_readBufferUsed >= sizeof(_client->m_readBuffer)-1)
+  {
+    fprintf(stderr, "Client %d input overflow, truncated\n", _client->m_fd);
+    _client->m_readBufferUsed = 0;
+  }
+
+  const size_t available = sizeof(_client->m_readBuffer) - _client->m_readBufferUsed - 1; //reserve space for appended trailing zero
+  const ssize_t read_res = recv(_client->m_fd, _client->m_readBuffer + _client->m_readBufferUsed, available, MSG_DONTWAIT);
+  if (read_res < 0)
+  {
+    res = errno;
+    if (res == EAGAIN || res == EINTR)
+      return true;
+    fprintf(stderr, "recv(client %d) failed: %d\n", _client->m_fd, res);
+    return false;
+  }
+  else if (read_res == 0)
+    return false;
+
+  _client->m_readBufferUsed += read_res;
+  _client->m_readBuffer[_client->m_readBufferUsed] = '\0';
+
+  char* parseAt = _client->m_readBuffer;
+  char* parseTill;
+  while ((parseTill = strchr(parseAt, '\n')) != NULL)
+  {
+    *parseTill = '\0';
+    do_parseClientCommand(_server, _rc, _client, parseAt);
+    parseAt = parseTill+1;
+  }
+
+  _client->m_readBufferUsed -= (parseAt - _client->m_readBuffer);
+  memmove(_client->m_readBuffer, parseAt, _client->m_readBufferUsed);
+
+  return true;
+}
+
+static int do_watchFifoInput(RCServer* _server, RCInput* _rc)
+{
+  int res;
+
+  if (_rc->m_fifoInputFd == -1)
+  {
+    _server->m_watchedFifoFd = -1;
+    return 0;
+  }
+
+  // reopened fifo may get the same fd number, while old one is already gone from epoll set
+  if ((res = do_epollWatch(_server, _rc->m_fifoInputFd, EPOLL_CTL_ADD, EPOLLIN)) != 0 && res != EEXIST)
+  {
+    fprintf(stderr, "epoll_ctl(fifo input) failed: %d\n", res);
+    return res;
+  }
+
+  _server->m_watchedFifoFd = _rc->m_fifoInputFd;
+
+  return 0;
+}
+
+
+
+
+int rcServerOpen(RCServer* _server, const RCServerConfig* _config)
+{
+  int res;
+  size_t idx;
+
+  if (_server == NULL || _config == NULL)
+    return EINVAL;
+  if (_server->m_epollFd != -1)
+    return EALREADY;
+
+  _server->m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+  if (_server->m_epollFd < 0)
+  {
+    res = errno;
+    fprintf(stderr, "epoll_create1() failed: %d\n", res);
+    _server->m_epollFd = -1;
+    return res;
+  }
+
+  _server->m_listenFd      = -1;
+  _server->m_watchedFifoFd = -1;
+  _server->m_wakeupFd      = -1;
+  for (idx = 0; idx < RC_SERVER_CLIENTS_MAX; ++idx)
+    _server->m_clients[idx].m_fd = -1;
+
+  if ((res = do_openSocket(_server, _config->m_socketPath)) != 0)
+  {
+    close(_server->m_epollFd);
+    _server->m_epollFd = -1;
+    return res;
+  }
+
+  pthread_mutex_init(&_server->m_mutex, NULL);
+
+  return 0;
+}
+
+int rcServerClose(RCServer* _server)
+{
+  size_t idx;
+
+  if (_server == NULL)
+    return EINVAL;
+  if (_server->m_epollFd == -1)
+    return EALREADY;
+
+  for (idx = 0; idx < RC_SERVER_CLIENTS_MAX; ++idx)
+    if (_server->m_clients[idx].m_fd != -1)
+      do_closeClient(_server, &_server->m_clients[idx]);
+
+  if (_server->m_listenFd != -1)
+    close(_server->m_listenFd);
+  _server->m_listenFd = -1;
+
+  if (_server->m_socketPath != NULL)
+  {
+    unlink(_server->m_socketPath);
+    free(_server->m_socketPath);
+  }
+  _server->m_socketPath = NULL;
+
+  close(_server->m_epollFd);
+  _server->m_epollFd = -1;
+
+  pthread_mutex_destroy(&_server->m_mutex);
+
+  return 0;
+}
+
+int rcServerAddWakeup(RCServer* _server, int _fd)
+{
+  int res;
+
+  if (_server == NULL || _fd < 0)
+    return EINVAL;
+  if (_server->m_epollFd == -1)
+    return ENOTCONN;
+  if (_server->m_wakeupFd != -1)
+    return EALREADY;
+
+  if ((res = do_epollWatch(_server, _fd, EPOLL_CTL_ADD, EPOLLIN)) != 0)
+  {
+    fprintf(stderr, "epoll_ctl(wakeup) failed: %d\n", res);
+    return res;
+  }
+
+  _server->m_wakeupFd = _fd;
+
+  return 0;
+}
+
+int rcServerPoll(RCServer* _server, RCInput* _rc, int _timeoutMs)
+{
+  int res;
+  int idx;
+  struct epoll_event events[RC_SERVER_CLIENTS_MAX+3];
+
+  if (_server == NULL || _rc == NULL)
+    return EINVAL;
+  if (_server->m_epollFd == -1)
+    return ENOTCONN;
+
+  if (_rc->m_fifoInputFd != _server->m_watchedFifoFd && (res = do_watchFifoInput(_server, _rc)) != 0)
+    return res;
+
+  const int eventsCount = epoll_wait(_server->m_epollFd, events, sizeof(events)/sizeof(*events), _timeoutMs);
+  if (eventsCount < 0)
+  {
+    res = errno;
+    if (res == EINTR)
+      return 0;
+    fprintf(stderr, "epoll_wait() failed: %d\n", res);
+    return res;
+  }
+
+  for (idx = 0; idx < eventsCount; ++idx)
+  {
+    const int fd = events[idx].data.fd;
+    const uint32_t what = events[idx].events;
+    RCServerClient* client;
+
+    if (fd == _server->m_wakeupFd)
+      continue;
+    else if (fd == _server->m_watchedFifoFd)
+    {
+      if ((res = rcInputReadFifoInput(_rc)) != 0)
+      {
+        fprintf(stderr, "rcInputReadFifoInput() failed: %d\n", res);
+        return res;
+      }
+
+      if ((res = do_watchFifoInput(_server, _rc)) != 0)
+        return res;
+    }
+    else if (fd == _server->m_listenFd)
+    {
+      if ((res = do_acceptClient(_server)) != 0)
+        return res;
+    }
+    else if ((client = do_findClient(_server, fd)) != NULL)
+    {
+      bool alive = true;
+
+      if (what & EPOLLIN)
+        alive = do_readClient(_server, _rc, client);
+      else if (what & (EPOLLERR|EPOLLHUP))
+        alive = false;
+
+      pthread_mutex_lock(&_server->m_mutex);
+      if (!alive)
+        do_closeClient(_server, client);
+      else if (what & EPOLLOUT)
+        do_flushClient(_server, client);
+      pthread_mutex_unlock(&_server->m_mutex);
+    }
+  }
+
+  return 0;
+}
+
+int rcServerReportResults(RCServer* _server, const ResultRecord* _records, size_t _count)
+{
+  size_t idx;
+  size_t recordIdx;
+  SoundSensorResult packed[RC_OUTPUT_BATCH_MAX];
+  char text[RC_OUTPUT_BATCH_MAX][128];
+  size_t textLength[RC_OUTPUT_BATCH_MAX];
+
+  if (_server == NULL || _records == NULL || _count > RC_OUTPUT_BATCH_MAX)
+    return EINVAL;
+  if (_server->m_epollFd == -1)
+    return ENOTCONN;
+
+  // same formats as output fifo
+  for (recordIdx = 0; recordIdx < _count; ++recordIdx)
+  {
+    const ResultRecord* record = &_records[recordIdx];
+    resultRecordPack(record, &packed[recordIdx]);
+
+    if (record->m_kind == RESULT_KIND_TARGET_DETECT_PARAMS)
+      textLength[recordIdx] = snprintf(text[recordIdx], sizeof(text[recordIdx]), "NULL\n");
+    else
+      textLength[recordIdx] = resultLocationFormat(&record->m_targetLocation, text[recordIdx], sizeof(text[recordIdx]));
+  }
+
+  pthread_mutex_lock(&_server->m_mutex);
+  for (idx = 0; idx < RC_SERVER_CLIENTS_MAX; ++idx)
+  {
+    RCServerClient* client = &_server->m_clients[idx];
+    if (client->m_fd == -1 || !client->m_subscribed)
+      continue;
+
+    for (recordIdx = 0; recordIdx < _count; ++recordIdx)
+    {
+      const void*  data = client->m_binary ? (const void*)&packed[recordIdx] : (const void*)text[recordIdx];
+      const size_t size = client->m_binary ? sizeof(packed[recordIdx]) : textLength[recordIdx];
+
+      // slow client loses results, sequence gap in binary records tells it so
+      if (client->m_sendBufferUsed + size > sizeof(client->m_sendBuffer))
+      {
+        ++client->m_dropCounter;
+        continue;
+      }
+
+      memcpy(client->m_sendBuffer + client->m_sendBufferUsed, data, size);
+      client->m_sendBufferUsed += size;
+    }
+
+    do_flushClient(_server, client);
+  }
+  pthread_mutex_unlock(&_server->m_mutex);
+
+  return 0;
+}
+
@@ -0,0 +1,208 @@
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <semaphore.h>
+
+#include "internal/pcm_ring.h"
+
+
+static unsigned int do_pcmRingFill(PCMRing* _ring)
+{
+  const unsigned int head = __atomic_load_n(&_ring->m_head, __ATOMIC_ACQUIRE);
+  const unsigned int tail = __atomic_load_n(&_ring->m_tail, __ATOMIC_ACQUIRE);
+
+  return head - tail;
+}
+
+static char* do_pcmRingSlot(PCMRing* _ring, unsigned int _index)
+{
+  return _ring->m_buffer + (_index % _ring->m_slotCount) * _ring->m_slotSize;
+}
+
+
+
+
+int pcmRingInit(PCMRing* _ring, size_t _slotSize, size_t _slotCount)
+{
+  int res;
+
+  if (_ring == NULL || _slotSize == 0 || _slotCount == 0)
+    return EINVAL;
+  if (_ring->m_buffer != NULL)
+    return EALREADY;
+
+  if ((_ring->m_buffer = malloc(_slotSize * _slotCount)) == NULL)
+  {
+    fprintf(stderr, "malloc(%zu x %zu) failed\n", _slotCount, _slotSize);
+    return ENOMEM;
+  }
+
+  if (sem_init(&_ring->m_filled, 0, 0) != 0)
+  {
+    res = errno;
+    fprintf(stderr, "sem_init() failed: %d\n", res);
+    free(_ring->m_buffer);
+    _ring->m_buffer = NULL;
+    return res;
+  }
+
+  _ring->m_slotSize       = _slotSize;
+  _ring->m_slotCount      = _slotCount;
+  _ring->m_head           = 0;
+  _ring->m_tail           = 0;
+  _ring->m_highWaterMark  = 0;
+  _ring->m_overrunCounter = 0;
+
+  return 0;
+}
+
+int pcmRingFini(PCMRing* _ring)
+{
+  if (_ring == NULL)
+    return EINVAL;
+  if (_ring->m_buffer == NULL)
+    return EALREADY;
+
+  sem_destroy(&_ring->m_filled);
+  free(_ring->m_buffer);
+  _ring->m_buffer    = NULL;
+  _ring->m_slotSize  = 0;
+  _ring->m_slotCount = 0;
+
+  return 0;
+}
+
+int pcmRingPushBegin(PCMRing* _ring, void** _slotPtr)
+{
+  if (_ring == NULL || _slotPtr == NULL)
+    return EINVAL;
+  if (_ring->m_buffer == NULL)
+    return ENOTCONN;
+
+  if (do_pcmRingFill(_ring) >= _ring->m_slotCount)
+    return ENOSPC;
+
+  *_slotPtr = do_pcmRingSlot(_ring, _ring->m_head);
+
+  return 0;
+}
+
+int pcmRingPushCommit(PCMRing* _ring)
+{
+  if (_ring == NULL)
+    return EINVAL;
+  if (_ring->m_buffer == NULL)
+    return ENOTCONN;
+
+  __atomic_store_n(&_ring->m_head, _ring->m_head + 1, __ATOMIC_RELEASE);
+
+  const unsigned int fill = do_pcmRingFill(_ring);
+  if (fill > __atomic_load_n(&_ring->m_highWaterMark, __ATOMIC_RELAXED))
+    __atomic_store_n(&_ring->m_highWaterMark, fill, __ATOMIC_RELAXED);
+
+  sem_post(&_ring->m_filled);
+
+  return 0;
+}
+
+int pcmRingPushOverrun(PCMRing* _ring)
+{
+  if (_ring == NULL)
+    return EINVAL;
+
+  __atomic_add_fetch(&_ring->m_overrunCounter, 1, __ATOMIC_RELAXED);
+
+  return 0;
+}
+
+int pcmRingPopBegin(PCMRing* _ring, const void** _slotPtr, long _timeoutMs)
+{
+  int res;
+  struct timespec deadline;
+
+  if (_ring == NULL || _slotPtr == NULL)
+    return EINVAL;
+  if (_ring->m_buffer == NULL)
+    return ENOTCONN;
+
+  if (clock_gettime(CLOCK_REALTIME, &deadline) != 0)
+    return errno;
+
+  deadline.tv_sec  += _timeoutMs / 1000;
+  deadline.tv_nsec += (_timeoutMs % 1000) * 1000000;
+  if (deadline.tv_nsec >= 1000000000)
+  {
+    deadline.tv_sec  += 1;
+    deadline.tv_nsec -= 1000000000;
+  }
+
+  while (sem_timedwait(&_ring->m_filled, &deadline) != 0)
+  {
+    res = errno;
+    if (res != EINTR)
+      return res;
+  }
+
+  // semaphore might be posted by pcmRingWakeup() without data
+  if (do_pcmRingFill(_ring) == 0)
+    return EAGAIN;
+
+  *_slotPtr = do_pcmRingSlot(_ring, _ring->m_tail);
+
+  return 0;
+}
+
+int pcmRingPopCommit(PCMRing* _ring)
+{
+  if (_ring == NULL)
+    return EINVAL;
+  if (_ring->m_buffer == NULL)
+    return ENOTCONN;
+
+  __atomic_store_n(&_ring->m_tail, _ring->m_tail + 1, __ATOMIC_RELEASE);
+
+  return 0;
+}
+
+int pcmRingWakeup(PCMRing* _ring)
+{
+  if (_ring == NULL)
+    return EINVAL;
+  if (_ring->m_buffer == NULL)
+    return ENOTCONN;
+
+  sem_post(&_ring->m_filled);
+
+  return 0;
+}
+
+int pcmRingGetSlotSize(const PCMRing* _ring, size_t* _slotSize)
+{
+  if (_ring == NULL || _slotSize == NULL)
+    return EINVAL;
+  if (_ring->m_buffer == NULL)
+    return ENOTCONN;
+
+  *_slotSize = _ring->m_slotSize;
+
+  return 0;
+}
+
+int pcmRingReportStats(PCMRing* _ring)
+{
+  if (_ring == NULL)
+    return EINVAL;
+  if (_ring->m_buffer == NULL)
+    return ENOTCONN;
+
+  fprintf(stderr, "Capture ring fill %u/%zu, high water %u, overruns %llu\n",
+          do_pcmRingFill(_ring), _ring->m_slotCount,
+          __atomic_load_n(&_ring->m_highWaterMark, __ATOMIC_RELAXED),
+          __atomic_load_n(&_ring->m_overrunCounter, __ATOMIC_RELAXED));
+
+  return 0;
+}
+
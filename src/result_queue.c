@@ -0,0 +1,246 @@
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <semaphore.h>
+
+#include "internal/result_queue.h"
+
+
+static const char* do_policyName(ResultQueuePolicy _policy)
+{
+  switch (_policy)
+  {
+    case RESULT_QUEUE_DROP_OLDEST:	return "drop-oldest";
+    case RESULT_QUEUE_DROP_NEWEST:	return "drop-newest";
+    case RESULT_QUEUE_COALESCE:		return "coalesce";
+    default:				return "unknown";
+  }
+}
+
+
+
+
+int resultQueueInit(ResultQueue* _queue, size_t _capacity, ResultQueuePolicy _policy)
+{
+  int res;
+  size_t capacity = 1;
+
+  if (_queue == NULL || _capacity == 0)
+    return EINVAL;
+  if (_queue->m_records != NULL)
+    return EALREADY;
+
+  // indices wrap around naturally only with power of 2 capacity
+  if (_policy != RESULT_QUEUE_COALESCE)
+    while (capacity < _capacity)
+      capacity *= 2;
+
+  if ((_queue->m_records = calloc(capacity, sizeof(*_queue->m_records))) == NULL)
+  {
+    fprintf(stderr, "calloc(%zu results) failed\n", capacity);
+    return ENOMEM;
+  }
+
+  if (sem_init(&_queue->m_wakeup, 0, 0) != 0)
+  {
+    res = errno;
+    fprintf(stderr, "sem_init() failed: %d\n", res);
+    free(_queue->m_records);
+    _queue->m_records = NULL;
+    return res;
+  }
+
+  _queue->m_capacity    = capacity;
+  _queue->m_policy      = _policy;
+  _queue->m_head        = 0;
+  _queue->m_tail        = 0;
+  _queue->m_pushCounter = 0;
+  _queue->m_dropCounter = 0;
+
+  return 0;
+}
+
+int resultQueueFini(ResultQueue* _queue)
+{
+  if (_queue == NULL)
+    return EINVAL;
+  if (_queue->m_records == NULL)
+    return EALREADY;
+
+  sem_destroy(&_queue->m_wakeup);
+  free(_queue->m_records);
+  _queue->m_records  = NULL;
+  _queue->m_capacity = 0;
+
+  return 0;
+}
+
+int resultQueuePush(ResultQueue* _queue, const ResultRecord* _record)
+{
+  if (_queue == NULL || _record == NULL)
+    return EINVAL;
+  if (_queue->m_records == NULL)
+    return ENOTCONN;
+
+  const unsigned int head = _queue->m_head;
+  unsigned int tail = __atomic_load_n(&_queue->m_tail, __ATOMIC_ACQUIRE);
+
+  __atomic_add_fetch(&_queue->m_pushCounter, 1, __ATOMIC_RELAXED);
+
+  if (head - tail >= _queue->m_capacity)
+  {
+    if (_queue->m_policy == RESULT_QUEUE_DROP_NEWEST)
+    {
+      __atomic_add_fetch(&_queue->m_dropCounter, 1, __ATOMIC_RELAXED);
+      return 0;
+    }
+
+    // if CAS fails consumer has just taken oldest record, so there is room anyway
+    if (__atomic_compare_exchange_n(&_queue->m_tail, &tail, tail + 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+      __atomic_add_fetch(&_queue->m_dropCounter, 1, __ATOMIC_RELAXED);
+  }
+
+  _queue->m_records[head & (_queue->m_capacity - 1)] = *_record;
+  __atomic_store_n(&_queue->m_head, head + 1, __ATOMIC_RELEASE);
+
+  return 0;
+}
+
+int resultQueuePop(ResultQueue* _queue, ResultRecord* _record)
+{
+  if (_queue == NULL || _record == NULL)
+    return EINVAL;
+  if (_queue->m_records == NULL)
+    return ENOTCONN;
+
+  unsigned int tail = __atomic_load_n(&_queue->m_tail, __ATOMIC_ACQUIRE);
+  for (;;)
+  {
+    const unsigned int head = __atomic_load_n(&_queue->m_head, __ATOMIC_ACQUIRE);
+    if (head == tail)
+      return ENODATA;
+
+    *_record = _queue->m_records[tail & (_queue->m_capacity - 1)];
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    // producer could drop and overwrite this record while it was copied; tail is reloaded on failure
+    if (__atomic_compare_exchange_n(&_queue->m_tail, &tail, tail + 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+      return 0;
+  }
+}
+
+int resultQueueWait(ResultQueue* _queue, long _timeoutMs)
+{
+  int res;
+  struct timespec deadline;
+
+  if (_queue == NULL)
+    return EINVAL;
+  if (_queue->m_records == NULL)
+    return ENOTCONN;
+
+  if (clock_gettime(CLOCK_REALTIME, &deadline) != 0)
+    return errno;
+
+  deadline.tv_sec  += _timeoutMs / 1000;
+  deadline.tv_nsec += (_timeoutMs % 1000) * 1000000;
+  if (deadline.tv_nsec >= 1000000000)
+  {
+    deadline.tv_sec  += 1;
+    deadline.tv_nsec -= 1000000000;
+  }
+
+  // timeout is the normal way out, records are not signalled
+  while (sem_timedwait(&_queue->m_wakeup, &deadline) != 0)
+  {
+    res = errno;
+    if (res == ETIMEDOUT)
+      return 0;
+    if (res != EINTR)
+      return res;
+  }
+
+  return 0;
+}
+
+int resultQueueWakeup(ResultQueue* _queue)
+{
+  if (_queue == NULL)
+    return EINVAL;
+  if (_queue->m_records == NULL)
+    return ENOTCONN;
+
+  sem_post(&_queue->m_wakeup);
+
+  return 0;
+}
+
+int resultQueueReportStats(ResultQueue* _queue)
+{
+  if (_queue == NULL)
+    return EINVAL;
+  if (_queue->m_records == NULL)
+    return ENOTCONN;
+
+  fprintf(stderr, "Result queue %s/%zu: %llu pushed, %llu dropped\n",
+          do_policyName(_queue->m_policy), _queue->m_capacity,
+          __atomic_load_n(&_queue->m_pushCounter, __ATOMIC_RELAXED),
+          __atomic_load_n(&_queue->m_dropCounter, __ATOMIC_RELAXED));
+
+  return 0;
+}
+
+int resultLocationFormat(const TargetLocation* _location, char* _text, size_t _size)
+{
+  int length;
+  size_t channel;
+
+  if (_location->m_gated)
+    length = snprintf(_text, _size, "silence: %d %d",
+                      _location->m_targetLeftVolume, _location->m_targetRightVolume);
+  else
+    length = snprintf(_text, _size, "sound: %d %d %d",
+                      _location->m_targetAngle, _location->m_targetLeftVolume, _location->m_targetRightVolume);
+
+  for (channel = 2; channel < _location->m_channels && channel < TARGET_CHANNELS_MAX; ++channel)
+    length += snprintf(_text + length, (size_t)length < _size ? _size - length : 0, " %d",
+                       _location->m_channelVolume[channel]);
+
+  length += snprintf(_text + length, (size_t)length < _size ? _size - length : 0, "\n");
+
+  return length;
+}
+
+void resultRecordPack(const ResultRecord* _record, SoundSensorResult* _packed)
+{
+  memset(_packed, 0, sizeof(*_packed));
+  _packed->m_magic    = SOUND_SENSOR_RESULT_MAGIC;
+  _packed->m_version  = SOUND_SENSOR_RESULT_VERSION;
+  _packed->m_size     = sizeof(*_packed);
+  _packed->m_sequence = _record->m_sequence;
+
+  if (_record->m_kind == RESULT_KIND_TARGET_DETECT_PARAMS)
+  {
+    _packed->m_kind = SOUND_SENSOR_RESULT_PARAMS;
+    return;
+  }
+
+  _packed->m_kind        = SOUND_SENSOR_RESULT_LOCATION;
+  _packed->m_timestampNs = _record->m_targetLocation.m_timestampNs;
+  _packed->m_angle       = _record->m_targetLocation.m_targetAngle;
+  _packed->m_leftVolume  = _record->m_targetLocation.m_targetLeftVolume;
+  _packed->m_rightVolume = _record->m_targetLocation.m_targetRightVolume;
+  _packed->m_confidence  = _record->m_targetLocation.m_confidence;
+  _packed->m_flags       = _record->m_targetLocation.m_gated ? SOUND_SENSOR_RESULT_FLAG_GATED : 0;
+
+  size_t channel;
+  _packed->m_channels = _record->m_targetLocation.m_channels;
+  if (_packed->m_channels > SOUND_SENSOR_RESULT_CHANNELS_MAX)
+    _packed->m_channels = SOUND_SENSOR_RESULT_CHANNELS_MAX;
+  for (channel = 0; channel < _packed->m_channels; ++channel)
+    _packed->m_channelVolume[channel] = _record->m_targetLocation.m_channelVolume[channel];
+}
+
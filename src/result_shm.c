@@ -0,0 +1,141 @@
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "internal/result_shm.h"
+
+
+static void do_writeEntry(SoundSensorShmEntry* _entry, uint32_t _index, const SoundSensorResult* _result)
+{
+  const uint32_t seq = _entry->m_seq;
+
+  __atomic_store_n(&_entry->m_seq, seq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  _entry->m_index  = _index;
+  _entry->m_result = *_result;
+
+  __atomic_store_n(&_entry->m_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+
+
+
+int resultShmOpen(ResultShm* _shm, const ResultShmConfig* _config)
+{
+  int res;
+  int fd;
+  void* ptr;
+
+  if (_shm == NULL || _config == NULL)
+    return EINVAL;
+  if (_shm->m_shm != NULL)
+    return EALREADY;
+
+  if (_config->m_name == NULL)
+    return 0;
+
+  fd = shm_open(_config->m_name, O_RDWR|O_CREAT, S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH);
+  if (fd < 0)
+  {
+    res = errno;
+    fprintf(stderr, "shm_open(%s) failed: %d\n", _config->m_name, res);
+    return res;
+  }
+
+  if (ftruncate(fd, sizeof(SoundSensorShm)) != 0)
+  {
+    res = errno;
+    fprintf(stderr, "ftruncate(%s, %zu) failed: %d\n", _config->m_name, sizeof(SoundSensorShm), res);
+    close(fd);
+    shm_unlink(_config->m_name);
+    return res;
+  }
+
+  ptr = mmap(NULL, sizeof(SoundSensorShm), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+  res = errno;
+  close(fd);
+  if (ptr == MAP_FAILED)
+  {
+    fprintf(stderr, "mmap(%s) failed: %d\n", _config->m_name, res);
+    shm_unlink(_config->m_name);
+    return res;
+  }
+
+  // readers of stale segment left by previous run see bad magic until header is complete
+  _shm->m_shm = ptr;
+  __atomic_store_n(&_shm->m_shm->m_magic, 0, __ATOMIC_RELEASE);
+  memset(ptr, 0, sizeof(SoundSensorShm));
+  _shm->m_shm->m_version   = SOUND_SENSOR_SHM_VERSION;
+  _shm->m_shm->m_entrySize = sizeof(SoundSensorShmEntry);
+  _shm->m_shm->m_ringSize  = SOUND_SENSOR_SHM_RING_SIZE;
+  __atomic_store_n(&_shm->m_shm->m_magic, SOUND_SENSOR_SHM_MAGIC, __ATOMIC_RELEASE);
+
+  _shm->m_name = strdup(_config->m_name);
+
+  return 0;
+}
+
+int resultShmClose(ResultShm* _shm)
+{
+  int res;
+  int exit_code = 0;
+
+  if (_shm == NULL)
+    return EINVAL;
+  if (_shm->m_shm == NULL)
+    return 0;
+
+  if (munmap(_shm->m_shm, sizeof(SoundSensorShm)) != 0)
+  {
+    res = errno;
+    fprintf(stderr, "munmap() failed: %d\n", res);
+    exit_code = res;
+  }
+  _shm->m_shm = NULL;
+
+  // readers which still have it mapped keep last results, new ones fail to open it
+  if (_shm->m_name != NULL)
+  {
+    if (shm_unlink(_shm->m_name) != 0)
+    {
+      res = errno;
+      fprintf(stderr, "shm_unlink(%s) failed: %d\n", _shm->m_name, res);
+      exit_code = res;
+    }
+    free(_shm->m_name);
+  }
+  _shm->m_name = NULL;
+
+  return exit_code;
+}
+
+int resultShmPublish(ResultShm* _shm, const ResultRecord* _record)
+{
+  SoundSensorResult packed;
+
+  if (_shm == NULL || _record == NULL)
+    return EINVAL;
+  if (_shm->m_shm == NULL)
+    return ENOTCONN;
+
+  if (_record->m_kind != RESULT_KIND_TARGET_LOCATION)
+    return 0;
+
+  resultRecordPack(_record, &packed);
+
+  // single writer, so index is only read back by readers
+  const uint32_t index = _shm->m_shm->m_writeIndex;
+  do_writeEntry(&_shm->m_shm->m_ring[index % SOUND_SENSOR_SHM_RING_SIZE], index, &packed);
+  do_writeEntry(&_shm->m_shm->m_latest, index, &packed);
+  __atomic_store_n(&_shm->m_shm->m_writeIndex, index + 1, __ATOMIC_RELEASE);
+
+  return 0;
+}
+
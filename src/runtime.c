@@ -6,19 +6,75 @@
 #include <assert.h>
 #include <errno.h>
 #include <getopt.h>
+#include <sys/eventfd.h>
 
 #include "internal/runtime.h"
+#include "internal/mic_array.h"
+#include "internal/target_tracker.h"
+#include "internal/worker_pool.h"
 #include "internal/thread_input.h"
 #include "internal/thread_audio.h"
+#include "internal/thread_capture.h"
+#include "internal/thread_publish.h"
 
 static const RuntimeConfig s_runtimeConfig = {
   .m_verbose = false,
-  .m_codecEngineConfig = { "dsp_server.xe674", "vidtranscode_cv" },
+  .m_headless = false,
+  .m_codecEngineConfig = { "dsp_server.xe674", "vidtranscode_cv", true, CODEC_ENGINE_BACKEND_AUTO, NULL, 0, { THREAD_POLICY_DEFAULT, 0, 0, 0 } },
   .m_v4l2Config        = { "/dev/video0", 320, 240, V4L2_PIX_FMT_YUYV },
   .m_fbConfig          = { "/dev/fb0" },
-  .m_rcConfig          = { "/run/sound-sensor.in.fifo", "/run/sound-sensor.out.fifo", true }
+  .m_rcConfig          = { "/run/sound-sensor.in.fifo", "/run/sound-sensor.out.fifo", true, 0, TARGET_DETECT_ALGORITHM_XCORR, false, 0, 6, 0, 30 },
+  .m_rcServerConfig    = { "/run/sound-sensor.sock" },
+  .m_alsaConfig        = { "default", 44100, 2, false, ALSA_FORMAT_S16_LE, 0, 0, 0, 0, false },
+  .m_audioSourceConfig = { AUDIO_SOURCE_ALSA, NULL, true, false },
+  .m_captureConfig     = { true, 512, 128 },
+  .m_publishConfig     = { RESULT_QUEUE_DROP_OLDEST, 64 },
+  .m_resultShmConfig   = { NULL },
+  .m_threadAttrConfig  = { { THREAD_POLICY_DEFAULT, 0, 0, 0 } },
+  .m_lockMemory        = false
 };
 
+// Pre-faulted on top of what is allocated before threads start, covers later small allocations
+#define RUNTIME_PREFAULT_HEAP	(1024*1024)
+#define RUNTIME_PREFAULT_STACK	(64*1024)
+
+static const char* s_threadNames[RUNTIME_THREAD_COUNT] = { "input", "audio", "capture", "publish", "worker" };
+
+// <thread|all>:<value>, applies parser to every matching thread config
+static bool do_parseThreadOption(RuntimeConfig* _cfg, const char* _arg, const char* _option,
+                                 int (*_parse)(ThreadAttrConfig*, const char*))
+{
+  size_t idx;
+  bool matched = false;
+  const char* value = strchr(_arg, ':');
+
+  if (value != NULL)
+    for (idx = 0; idx < RUNTIME_THREAD_COUNT; ++idx)
+    {
+      const size_t length = value - _arg;
+      if (   (length != 3 || strncasecmp(_arg, "all", length) != 0)
+          && (length != strlen(s_threadNames[idx]) || strncasecmp(_arg, s_threadNames[idx], length) != 0))
+        continue;
+
+      if (_parse(&_cfg->m_threadAttrConfig[idx], value + 1) != 0)
+        break;
+      matched = true;
+    }
+
+  if (!matched)
+    fprintf(stderr, "Invalid --%s '%s'\n"
+                    "Expected <input|audio|capture|publish|worker|all>:<value>\n",
+            _option, _arg);
+
+  return matched;
+}
+
+static int do_parseStackSize(ThreadAttrConfig* _config, const char* _arg)
+{
+  _config->m_stackSize = (size_t)atoi(_arg) * 1024;
+  return 0;
+}
+
 void runtimeReset(Runtime* _runtime)
 {
   memset(_runtime, 0, sizeof(*_runtime));
@@ -33,13 +89,25 @@ void runtimeReset(Runtime* _runtime)
   memset(&_runtime->m_modules.m_rcInput,      0, sizeof(_runtime->m_modules.m_rcInput));
   _runtime->m_modules.m_rcInput.m_fifoInputFd  = -1;
   _runtime->m_modules.m_rcInput.m_fifoOutputFd = -1;
+  memset(&_runtime->m_modules.m_rcServer,     0, sizeof(_runtime->m_modules.m_rcServer));
+  _runtime->m_modules.m_rcServer.m_epollFd  = -1;
+  _runtime->m_modules.m_rcServer.m_listenFd = -1;
+  memset(&_runtime->m_modules.m_audioSource,  0, sizeof(_runtime->m_modules.m_audioSource));
+  _runtime->m_modules.m_audioSource.m_file.m_fd = -1;
+  memset(&_runtime->m_modules.m_captureRing,  0, sizeof(_runtime->m_modules.m_captureRing));
+  memset(&_runtime->m_modules.m_resultQueue,  0, sizeof(_runtime->m_modules.m_resultQueue));
+  memset(&_runtime->m_modules.m_resultShm,    0, sizeof(_runtime->m_modules.m_resultShm));
+  statsReset(&_runtime->m_modules.m_stats);
 
   memset(&_runtime->m_threads, 0, sizeof(_runtime->m_threads));
   _runtime->m_threads.m_terminate = true;
+  _runtime->m_threads.m_terminateFd = -1;
 
   pthread_mutex_init(&_runtime->m_state.m_mutex, NULL);
-  memset(&_runtime->m_state.m_targetDetectParams,  0, sizeof(_runtime->m_state.m_targetDetectParams));
+  _runtime->m_state.m_snapshotSeq = 0;
+  memset(&_runtime->m_state.m_snapshot,            0, sizeof(_runtime->m_state.m_snapshot));
   memset(&_runtime->m_state.m_targetDetectCommand, 0, sizeof(_runtime->m_state.m_targetDetectCommand));
+  _runtime->m_state.m_resultSequence = 0;
 }
 
 bool runtimeParseArgs(Runtime* _runtime, int _argc, char* const _argv[])
@@ -61,6 +129,42 @@ bool runtimeParseArgs(Runtime* _runtime, int _argc, char* const _argv[])
     { "rc-fifo-in",		1,	NULL,	0   }, // 7
     { "rc-fifo-out",		1,	NULL,	0   },
     { "video-out",		1,	NULL,	0   },
+    { "hop",			1,	NULL,	0   },
+    { "alsa-mmap",		1,	NULL,	0   }, // 11
+    { "capture-thread",		1,	NULL,	0   }, // 12
+    { "capture-ring",		1,	NULL,	0   },
+    { "ce-async",		1,	NULL,	0   }, // 14
+    { "ce-backend",		1,	NULL,	0   }, // 15
+    { "alg",			1,	NULL,	0   }, // 16
+    { "headless",		0,	NULL,	0   }, // 17
+    { "rc-out-policy",		1,	NULL,	0   }, // 18
+    { "rc-out-queue",		1,	NULL,	0   },
+    { "rc-out-format",		1,	NULL,	0   }, // 20
+    { "shm-name",		1,	NULL,	0   }, // 21
+    { "rc-socket",		1,	NULL,	0   }, // 22
+    { "audio-source",		1,	NULL,	0   }, // 23
+    { "audio-file",		1,	NULL,	0   },
+    { "audio-pace",		1,	NULL,	0   },
+    { "audio-loop",		1,	NULL,	0   },
+    { "alsa-device",		1,	NULL,	0   }, // 27
+    { "alsa-rate",		1,	NULL,	0   },
+    { "alsa-channels",		1,	NULL,	0   },
+    { "alsa-format",		1,	NULL,	0   },
+    { "alsa-period",		1,	NULL,	0   }, // 31
+    { "alsa-periods",		1,	NULL,	0   },
+    { "alsa-avail-min",		1,	NULL,	0   },
+    { "alsa-start-threshold",	1,	NULL,	0   },
+    { "alsa-autotune",		1,	NULL,	0   }, // 35
+    { "sched",			1,	NULL,	0   }, // 36
+    { "affinity",		1,	NULL,	0   },
+    { "stack-size",		1,	NULL,	0   },
+    { "mlockall",		1,	NULL,	0   }, // 39
+    { "gate",			1,	NULL,	0   }, // 40
+    { "gate-hyst",		1,	NULL,	0   },
+    { "mic-geometry",		1,	NULL,	0   }, // 42
+    { "workers",		1,	NULL,	0   }, // 43
+    { "track",			1,	NULL,	0   }, // 44
+    { "track-confidence",	1,	NULL,	0   },
     { "verbose",		0,	NULL,	'v' },
     { "help",			0,	NULL,	'h' },
     { NULL,			0,	NULL,	0   }
@@ -107,6 +211,129 @@ bool runtimeParseArgs(Runtime* _runtime, int _argc, char* const _argv[])
           case 7  : cfg->m_rcConfig.m_fifoInput  = optarg;					break;
           case 7+1: cfg->m_rcConfig.m_fifoOutput = optarg;					break;
           case 7+2: cfg->m_rcConfig.m_videoOutEnable = atoi(optarg); break;
+          case 7+3: cfg->m_rcConfig.m_hopSize = atoi(optarg);				break;
+
+          case 11: cfg->m_alsaConfig.m_mmap = atoi(optarg);				break;
+
+          case 12  : cfg->m_captureConfig.m_threaded = atoi(optarg);			break;
+          case 12+1: cfg->m_captureConfig.m_ringPeriods = atoi(optarg);		break;
+
+          case 14: cfg->m_codecEngineConfig.m_async = atoi(optarg);			break;
+          case 15:
+            if      (!strcasecmp(optarg, "auto"))	cfg->m_codecEngineConfig.m_backend = CODEC_ENGINE_BACKEND_AUTO;
+            else if (!strcasecmp(optarg, "dsp"))	cfg->m_codecEngineConfig.m_backend = CODEC_ENGINE_BACKEND_DSP;
+            else if (!strcasecmp(optarg, "cpu"))	cfg->m_codecEngineConfig.m_backend = CODEC_ENGINE_BACKEND_CPU;
+            else
+            {
+              fprintf(stderr, "Unknown codec engine backend '%s'\n"
+                              "Known backends: auto, dsp, cpu\n",
+                      optarg);
+              return false;
+            }
+            break;
+
+          case 16:
+            if      (!strcasecmp(optarg, "xcorr"))	cfg->m_rcConfig.m_algorithm = TARGET_DETECT_ALGORITHM_XCORR;
+            else if (!strcasecmp(optarg, "gccphat"))	cfg->m_rcConfig.m_algorithm = TARGET_DETECT_ALGORITHM_GCC_PHAT;
+            else
+            {
+              fprintf(stderr, "Unknown algorithm '%s'\n"
+                              "Known algorithms: xcorr, gccphat\n",
+                      optarg);
+              return false;
+            }
+            break;
+
+          case 17: cfg->m_headless = true;						break;
+
+          case 18:
+            if      (!strcasecmp(optarg, "drop-oldest"))	cfg->m_publishConfig.m_policy = RESULT_QUEUE_DROP_OLDEST;
+            else if (!strcasecmp(optarg, "drop-newest"))	cfg->m_publishConfig.m_policy = RESULT_QUEUE_DROP_NEWEST;
+            else if (!strcasecmp(optarg, "coalesce"))	cfg->m_publishConfig.m_policy = RESULT_QUEUE_COALESCE;
+            else
+            {
+              fprintf(stderr, "Unknown result queue policy '%s'\n"
+                              "Known policies: drop-oldest, drop-newest, coalesce\n",
+                      optarg);
+              return false;
+            }
+            break;
+          case 18+1: cfg->m_publishConfig.m_queueSize = atoi(optarg);			break;
+
+          case 20:
+            if      (!strcasecmp(optarg, "text"))	cfg->m_rcConfig.m_outputBinary = false;
+            else if (!strcasecmp(optarg, "binary"))	cfg->m_rcConfig.m_outputBinary = true;
+            else
+            {
+              fprintf(stderr, "Unknown output format '%s'\n"
+                              "Known formats: text, binary\n",
+                      optarg);
+              return false;
+            }
+            break;
+
+          case 21:	cfg->m_resultShmConfig.m_name = optarg;				break;
+          case 22:	cfg->m_rcServerConfig.m_socketPath = *optarg ? optarg : NULL;	break;
+
+          case 23:
+            if      (!strcasecmp(optarg, "alsa"))	cfg->m_audioSourceConfig.m_kind = AUDIO_SOURCE_ALSA;
+            else if (!strcasecmp(optarg, "wav"))	cfg->m_audioSourceConfig.m_kind = AUDIO_SOURCE_WAV;
+            else if (!strcasecmp(optarg, "raw"))	cfg->m_audioSourceConfig.m_kind = AUDIO_SOURCE_RAW;
+            else
+            {
+              fprintf(stderr, "Unknown audio source '%s'\n"
+                              "Known sources: alsa, wav, raw\n",
+                      optarg);
+              return false;
+            }
+            break;
+          case 23+1: cfg->m_audioSourceConfig.m_filePath = optarg;			break;
+          case 23+2:
+            if      (!strcasecmp(optarg, "realtime"))	cfg->m_audioSourceConfig.m_fileRealtime = true;
+            else if (!strcasecmp(optarg, "fast"))	cfg->m_audioSourceConfig.m_fileRealtime = false;
+            else
+            {
+              fprintf(stderr, "Unknown audio pace '%s'\n"
+                              "Known paces: realtime, fast\n",
+                      optarg);
+              return false;
+            }
+            break;
+          case 23+3: cfg->m_audioSourceConfig.m_fileLoop = atoi(optarg);		break;
+
+          case 27  : cfg->m_alsaConfig.m_path = optarg;				break;
+          case 27+1: cfg->m_alsaConfig.m_rate = atoi(optarg);			break;
+          case 27+2: cfg->m_alsaConfig.m_channels = atoi(optarg);		break;
+          case 27+3:
+            if      (!strcasecmp(optarg, "s16_le"))	cfg->m_alsaConfig.m_format = ALSA_FORMAT_S16_LE;
+            else if (!strcasecmp(optarg, "s32_le"))	cfg->m_alsaConfig.m_format = ALSA_FORMAT_S32_LE;
+            else
+            {
+              fprintf(stderr, "Unknown alsa format '%s'\n"
+                              "Known formats: s16_le, s32_le\n",
+                      optarg);
+              return false;
+            }
+            break;
+          case 31  : cfg->m_alsaConfig.m_periodFrames = atoi(optarg);		break;
+          case 31+1: cfg->m_alsaConfig.m_periods = atoi(optarg);		break;
+          case 31+2: cfg->m_alsaConfig.m_availMin = atoi(optarg);		break;
+          case 31+3: cfg->m_alsaConfig.m_startThreshold = atoi(optarg);		break;
+          case 35:   cfg->m_alsaConfig.m_autoTune = atoi(optarg);		break;
+
+          case 36  : if (!do_parseThreadOption(cfg, optarg, "sched",      &threadAttrParsePolicy))	return false;	break;
+          case 36+1: if (!do_parseThreadOption(cfg, optarg, "affinity",   &threadAttrParseCpuList))	return false;	break;
+          case 36+2: if (!do_parseThreadOption(cfg, optarg, "stack-size", &do_parseStackSize))		return false;	break;
+          case 39:   cfg->m_lockMemory = atoi(optarg);						break;
+
+          case 40  : cfg->m_rcConfig.m_gateThreshold = atoi(optarg);			break;
+          case 40+1: cfg->m_rcConfig.m_gateHysteresis = atoi(optarg);			break;
+
+          case 42:   cfg->m_codecEngineConfig.m_micGeometry = optarg;			break;
+          case 43:   cfg->m_codecEngineConfig.m_workers = atoi(optarg);			break;
+
+          case 44  : cfg->m_rcConfig.m_trackGain = atoi(optarg);			break;
+          case 44+1: cfg->m_rcConfig.m_trackConfidence = atoi(optarg);			break;
 
           default:
             return false;
@@ -119,6 +346,39 @@ bool runtimeParseArgs(Runtime* _runtime, int _argc, char* const _argv[])
     }
   }
 
+  // pipeline reads in device periods, so explicit period sets wakeup granularity of the whole chain
+  if (cfg->m_alsaConfig.m_periodFrames != 0)
+    cfg->m_captureConfig.m_periodFrames = cfg->m_alsaConfig.m_periodFrames;
+
+  // codec is stereo only, microphone arrays are served by host backend
+  if (cfg->m_alsaConfig.m_channels != 2 && cfg->m_codecEngineConfig.m_backend == CODEC_ENGINE_BACKEND_AUTO)
+    cfg->m_codecEngineConfig.m_backend = CODEC_ENGINE_BACKEND_CPU;
+
+  MicArrayGeometry geometry;
+  if (micArrayParseGeometry(&geometry, cfg->m_codecEngineConfig.m_micGeometry, cfg->m_alsaConfig.m_channels) != 0)
+  {
+    fprintf(stderr, "Invalid microphone geometry '%s'\n",
+            cfg->m_codecEngineConfig.m_micGeometry ? cfg->m_codecEngineConfig.m_micGeometry : "");
+    return false;
+  }
+
+  if (cfg->m_codecEngineConfig.m_workers > WORKER_POOL_SIZE_MAX)
+  {
+    fprintf(stderr, "At most %d workers are supported\n", WORKER_POOL_SIZE_MAX);
+    return false;
+  }
+  cfg->m_codecEngineConfig.m_workerThreadAttr = cfg->m_threadAttrConfig[RUNTIME_THREAD_WORKER];
+
+  if (cfg->m_rcConfig.m_trackGain > TARGET_TRACKER_GAIN_MAX || cfg->m_rcConfig.m_trackConfidence > 100)
+  {
+    fprintf(stderr, "Tracker gain and confidence are percents\n");
+    return false;
+  }
+
+  // capture thread never waits for consumer, so unpaced replay would just overrun the ring
+  if (cfg->m_audioSourceConfig.m_kind != AUDIO_SOURCE_ALSA && !cfg->m_audioSourceConfig.m_fileRealtime)
+    cfg->m_captureConfig.m_threaded = false;
+
   return true;
 }
 
@@ -132,14 +392,51 @@ void runtimeArgsHelpMessage(Runtime* _runtime, const char* _arg0)
                   " where opts are:\n"
                   "   --ce-server    <dsp-server-name>\n"
                   "   --ce-codec     <dsp-codec-name>\n"
+                  "   --ce-async     <overlap-capture-with-dsp-processing>\n"
+                  "   --ce-backend   <auto|dsp|cpu>\n"
                   "   --v4l2-path    <input-device-path>\n"
                   "   --v4l2-width   <input-width>\n"
                   "   --v4l2-height  <input-height>\n"
                   "   --v4l2-format  <input-pixel-format>\n"
                   "   --fb-path      <output-device-path>\n"
+                  "   --headless     (no framebuffer, results only)\n"
                   "   --rc-fifo-in            <remote-control-fifo-input>\n"
                   "   --rc-fifo-out           <remote-control-fifo-output>\n"
+                  "   --rc-socket             <remote-control-unix-socket, empty to disable>\n"
+                  "   --rc-out-policy         <drop-oldest|drop-newest|coalesce>\n"
+                  "   --rc-out-queue          <result-queue-size>\n"
+                  "   --rc-out-format         <text|binary>\n"
+                  "   --shm-name              <shared-memory-results-name, e.g. /sound-sensor>\n"
                   "   --video-out             <enable-video-output>\n"
+                  "   --hop                   <sliding-window-hop-in-samples, 0 to disable>\n"
+                  "   --alg                   <xcorr|gccphat, cpu backend only>\n"
+                  "   --gate                  <dB-above-noise-floor-to-localize, 0 to disable>\n"
+                  "   --gate-hyst             <gate-hysteresis-dB>\n"
+                  "   --alsa-mmap             <capture-via-mmap-into-dsp-buffer>\n"
+                  "   --alsa-device           <alsa-pcm-name>\n"
+                  "   --alsa-rate             <sample-rate>\n"
+                  "   --alsa-channels         <channels>\n"
+                  "   --mic-geometry          <x,y;x,y;... in mm, x right, y forward, or circle:<radius-mm>; cpu backend only>\n"
+                  "   --workers               <cpu-backend-threads, 0 for one per online cpu>\n"
+                  "   --track                 <bearing-tracker-gain-percent, 0 to disable; cpu backend only>\n"
+                  "   --track-confidence      <percent-below-which-tracker-coasts>\n"
+                  "   --alsa-format           <s16_le|s32_le>\n"
+                  "   --alsa-period           <period-frames, also pipeline read size; 0 for driver default>\n"
+                  "   --alsa-periods          <periods-in-buffer, 0 for driver default>\n"
+                  "   --alsa-avail-min        <wakeup-frames, 0 for one period>\n"
+                  "   --alsa-start-threshold  <frames, 0 for driver default>\n"
+                  "   --alsa-autotune         <pick-smallest-period-without-xruns-on-start>\n"
+                  "   --capture-thread        <capture-in-dedicated-thread>\n"
+                  "   --capture-ring          <capture-ring-size-in-periods>\n"
+                  "   --audio-source          <alsa|wav|raw>\n"
+                  "   --audio-file            <replayed-file-path, raw is s16le in alsa rate and channels>\n"
+                  "   --audio-pace            <realtime|fast>\n"
+                  "   --audio-loop            <replay-file-in-loop>\n"
+                  "   --sched                 <thread>:<fifo|rr>:<priority> or <thread>:other\n"
+                  "   --affinity              <thread>:<cpu-list, e.g. 0,2-3>\n"
+                  "   --stack-size            <thread>:<stack-size-KiB>\n"
+                  "                           threads are input, audio, capture, publish, worker or all\n"
+                  "   --mlockall              <lock-and-prefault-memory>\n"
                   "   --verbose\n"
                   "   --help\n",
           _arg0);
@@ -180,6 +477,20 @@ int runtimeInit(Runtime* _runtime)
     exit_code = res;
   }
 
+  if ((res = alsaInputInit(verbose)) != 0)
+  {
+    fprintf(stderr, "alsaInputInit() failed: %d\n", res);
+    exit_code = res;
+  }
+
+  if ((_runtime->m_threads.m_terminateFd = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC)) < 0)
+  {
+    res = errno;
+    fprintf(stderr, "eventfd() failed: %d\n", res);
+    _runtime->m_threads.m_terminateFd = -1;
+    exit_code = res;
+  }
+
   return exit_code;
 }
 
@@ -190,6 +501,13 @@ int runtimeFini(Runtime* _runtime)
   if (_runtime == NULL)
     return EINVAL;
 
+  if (_runtime->m_threads.m_terminateFd != -1)
+    close(_runtime->m_threads.m_terminateFd);
+  _runtime->m_threads.m_terminateFd = -1;
+
+  if ((res = alsaInputFini()) != 0)
+    fprintf(stderr, "alsaInputFini() failed: %d\n", res);
+
   if ((res = rcInputFini()) != 0)
     fprintf(stderr, "rcInputFini() failed: %d\n", res);
 
@@ -210,27 +528,122 @@ int runtimeStart(Runtime* _runtime)
   int res;
   int exit_code = 0;
   RuntimeThreads* rt;
+  const CaptureConfig* captureConfig;
+  const PublishConfig* publishConfig;
 
   if (_runtime == NULL)
     return EINVAL;
 
   rt = &_runtime->m_threads;
+  captureConfig = runtimeCfgCapture(_runtime);
+  publishConfig = runtimeCfgPublish(_runtime);
+  if (rt->m_terminateFd == -1)
+    return ENOTCONN;
+
+  // restart: consume terminate event of previous run
+  uint64_t terminateEvents;
+  if (read(rt->m_terminateFd, &terminateEvents, sizeof(terminateEvents)) < 0 && errno != EAGAIN)
+  {
+    res = errno;
+    fprintf(stderr, "read(terminate eventfd) failed: %d\n", res);
+    return res;
+  }
   rt->m_terminate = false;
+  statsReset(runtimeModStats(_runtime));
 
-  if ((res = pthread_create(&rt->m_inputThread, NULL, &threadInput, _runtime)) != 0)
+  if (runtimeCfgAlsaInput(_runtime)->m_autoTune && runtimeCfgAudioSource(_runtime)->m_kind == AUDIO_SOURCE_ALSA)
   {
-    fprintf(stderr, "pthread_create(input) failed: %d\n", res);
+    size_t periodFrames;
+    if ((res = alsaInputTunePeriod(&runtimeModAudioSource(_runtime)->m_alsa, runtimeCfgAlsaInput(_runtime), &periodFrames)) != 0)
+    {
+      fprintf(stderr, "alsaInputTunePeriod() failed: %d\n", res);
+      return res;
+    }
+
+    printf("ALSA period tuned to %zu frames\n", periodFrames);
+    _runtime->m_config.m_alsaConfig.m_periodFrames   = periodFrames;
+    _runtime->m_config.m_captureConfig.m_periodFrames = periodFrames;
+  }
+
+  if (captureConfig->m_threaded)
+  {
+    const size_t slotSize = captureConfig->m_periodFrames * runtimeCfgAlsaInput(_runtime)->m_channels * sizeof(int16_t);
+    if ((res = pcmRingInit(runtimeModCaptureRing(_runtime), slotSize, captureConfig->m_ringPeriods)) != 0)
+    {
+      fprintf(stderr, "pcmRingInit() failed: %d\n", res);
+      exit_code = res;
+      goto exit;
+    }
+  }
+
+  if ((res = resultQueueInit(runtimeModResultQueue(_runtime), publishConfig->m_queueSize, publishConfig->m_policy)) != 0)
+  {
+    fprintf(stderr, "resultQueueInit() failed: %d\n", res);
     exit_code = res;
-    goto exit;
+    goto exit_ring_fini;
   }
 
-  if ((res = pthread_create(&rt->m_videoThread, NULL, &threadAudio, _runtime)) != 0)
+  if ((res = resultShmOpen(runtimeModResultShm(_runtime), runtimeCfgResultShm(_runtime))) != 0)
   {
-    fprintf(stderr, "pthread_create(audio) failed: %d\n", res);
+    fprintf(stderr, "resultShmOpen() failed: %d\n", res);
+    exit_code = res;
+    goto exit_queue_fini;
+  }
+
+  if ((res = rcServerOpen(runtimeModRCServer(_runtime), runtimeCfgRCServer(_runtime))) != 0)
+  {
+    fprintf(stderr, "rcServerOpen() failed: %d\n", res);
+    exit_code = res;
+    goto exit_shm_close;
+  }
+
+  if ((res = rcServerAddWakeup(runtimeModRCServer(_runtime), rt->m_terminateFd)) != 0)
+  {
+    fprintf(stderr, "rcServerAddWakeup() failed: %d\n", res);
+    exit_code = res;
+    goto exit_server_close;
+  }
+  runtimeModRCServer(_runtime)->m_stats = runtimeModStats(_runtime);
+
+  // after pools and rings are allocated, so they are locked in place too
+  if (runtimeCfgLockMemory(_runtime) && (res = threadAttrLockMemory(RUNTIME_PREFAULT_HEAP, RUNTIME_PREFAULT_STACK)) != 0)
+    fprintf(stderr, "threadAttrLockMemory() failed: %d, running with pageable memory\n", res);
+
+  if ((res = threadAttrCreate(&rt->m_inputThread, s_threadNames[RUNTIME_THREAD_INPUT],
+                              runtimeCfgThreadAttr(_runtime, RUNTIME_THREAD_INPUT), &threadInput, _runtime)) != 0)
+  {
+    fprintf(stderr, "threadAttrCreate(input) failed: %d\n", res);
+    exit_code = res;
+    goto exit_server_close;
+  }
+
+  if ((res = threadAttrCreate(&rt->m_publishThread, s_threadNames[RUNTIME_THREAD_PUBLISH],
+                              runtimeCfgThreadAttr(_runtime, RUNTIME_THREAD_PUBLISH), &threadPublish, _runtime)) != 0)
+  {
+    fprintf(stderr, "threadAttrCreate(publish) failed: %d\n", res);
     exit_code = res;
     goto exit_join_input_thread;
   }
 
+  if (captureConfig->m_threaded)
+  {
+    if ((res = threadAttrCreate(&rt->m_captureThread, s_threadNames[RUNTIME_THREAD_CAPTURE],
+                                runtimeCfgThreadAttr(_runtime, RUNTIME_THREAD_CAPTURE), &threadCapture, _runtime)) != 0)
+    {
+      fprintf(stderr, "threadAttrCreate(capture) failed: %d\n", res);
+      exit_code = res;
+      goto exit_join_publish_thread;
+    }
+  }
+
+  if ((res = threadAttrCreate(&rt->m_videoThread, s_threadNames[RUNTIME_THREAD_AUDIO],
+                              runtimeCfgThreadAttr(_runtime, RUNTIME_THREAD_AUDIO), &threadAudio, _runtime)) != 0)
+  {
+    fprintf(stderr, "threadAttrCreate(audio) failed: %d\n", res);
+    exit_code = res;
+    goto exit_join_capture_thread;
+  }
+
   return 0;
 
 
@@ -239,11 +652,37 @@ int runtimeStart(Runtime* _runtime)
   pthread_cancel(rt->m_videoThread);
   pthread_join(rt->m_videoThread, NULL);
 
+ exit_join_capture_thread:
+  runtimeSetTerminate(_runtime);
+  if (captureConfig->m_threaded)
+  {
+    pthread_cancel(rt->m_captureThread);
+    pthread_join(rt->m_captureThread, NULL);
+  }
+
+ exit_join_publish_thread:
+  runtimeSetTerminate(_runtime);
+  pthread_cancel(rt->m_publishThread);
+  pthread_join(rt->m_publishThread, NULL);
+
  exit_join_input_thread:
   runtimeSetTerminate(_runtime);
   pthread_cancel(rt->m_inputThread);
   pthread_join(rt->m_inputThread, NULL);
 
+ exit_server_close:
+  rcServerClose(runtimeModRCServer(_runtime));
+
+ exit_shm_close:
+  resultShmClose(runtimeModResultShm(_runtime));
+
+ exit_queue_fini:
+  resultQueueFini(runtimeModResultQueue(_runtime));
+
+ exit_ring_fini:
+  if (captureConfig->m_threaded)
+    pcmRingFini(runtimeModCaptureRing(_runtime));
+
  exit:
   runtimeSetTerminate(_runtime);
   return exit_code;
@@ -260,8 +699,17 @@ int runtimeStop(Runtime* _runtime)
 
   runtimeSetTerminate(_runtime);
   pthread_join(rt->m_videoThread, NULL);
+  if (runtimeCfgCapture(_runtime)->m_threaded)
+    pthread_join(rt->m_captureThread, NULL);
+  pthread_join(rt->m_publishThread, NULL);
   pthread_join(rt->m_inputThread, NULL);
 
+  rcServerClose(runtimeModRCServer(_runtime));
+  resultShmClose(runtimeModResultShm(_runtime));
+  resultQueueFini(runtimeModResultQueue(_runtime));
+  if (runtimeCfgCapture(_runtime)->m_threaded)
+    pcmRingFini(runtimeModCaptureRing(_runtime));
+
   return 0;
 }
 
@@ -273,6 +721,14 @@ bool runtimeCfgVerbose(const Runtime* _runtime)
   return _runtime->m_config.m_verbose;
 }
 
+bool runtimeCfgHeadless(const Runtime* _runtime)
+{
+  if (_runtime == NULL)
+    return false;
+
+  return _runtime->m_config.m_headless;
+}
+
 const CodecEngineConfig* runtimeCfgCodecEngine(const Runtime* _runtime)
 {
   if (_runtime == NULL)
@@ -305,6 +761,70 @@ const RCConfig* runtimeCfgRCInput(const Runtime* _runtime)
   return &_runtime->m_config.m_rcConfig;
 }
 
+const RCServerConfig* runtimeCfgRCServer(const Runtime* _runtime)
+{
+  if (_runtime == NULL)
+    return NULL;
+
+  return &_runtime->m_config.m_rcServerConfig;
+}
+
+const AlsaConfig* runtimeCfgAlsaInput(const Runtime* _runtime)
+{
+  if (_runtime == NULL)
+    return NULL;
+
+  return &_runtime->m_config.m_alsaConfig;
+}
+
+const AudioSourceConfig* runtimeCfgAudioSource(const Runtime* _runtime)
+{
+  if (_runtime == NULL)
+    return NULL;
+
+  return &_runtime->m_config.m_audioSourceConfig;
+}
+
+const CaptureConfig* runtimeCfgCapture(const Runtime* _runtime)
+{
+  if (_runtime == NULL)
+    return NULL;
+
+  return &_runtime->m_config.m_captureConfig;
+}
+
+const PublishConfig* runtimeCfgPublish(const Runtime* _runtime)
+{
+  if (_runtime == NULL)
+    return NULL;
+
+  return &_runtime->m_config.m_publishConfig;
+}
+
+const ResultShmConfig* runtimeCfgResultShm(const Runtime* _runtime)
+{
+  if (_runtime == NULL)
+    return NULL;
+
+  return &_runtime->m_config.m_resultShmConfig;
+}
+
+const ThreadAttrConfig* runtimeCfgThreadAttr(const Runtime* _runtime, RuntimeThreadId _thread)
+{
+  if (_runtime == NULL || _thread >= RUNTIME_THREAD_COUNT)
+    return NULL;
+
+  return &_runtime->m_config.m_threadAttrConfig[_thread];
+}
+
+bool runtimeCfgLockMemory(const Runtime* _runtime)
+{
+  if (_runtime == NULL)
+    return false;
+
+  return _runtime->m_config.m_lockMemory;
+}
+
 CodecEngine* runtimeModCodecEngine(Runtime* _runtime)
 {
   if (_runtime == NULL)
@@ -337,6 +857,54 @@ RCInput* runtimeModRCInput(Runtime* _runtime)
   return &_runtime->m_modules.m_rcInput;
 }
 
+RCServer* runtimeModRCServer(Runtime* _runtime)
+{
+  if (_runtime == NULL)
+    return NULL;
+
+  return &_runtime->m_modules.m_rcServer;
+}
+
+AudioSource* runtimeModAudioSource(Runtime* _runtime)
+{
+  if (_runtime == NULL)
+    return NULL;
+
+  return &_runtime->m_modules.m_audioSource;
+}
+
+PCMRing* runtimeModCaptureRing(Runtime* _runtime)
+{
+  if (_runtime == NULL)
+    return NULL;
+
+  return &_runtime->m_modules.m_captureRing;
+}
+
+ResultQueue* runtimeModResultQueue(Runtime* _runtime)
+{
+  if (_runtime == NULL)
+    return NULL;
+
+  return &_runtime->m_modules.m_resultQueue;
+}
+
+ResultShm* runtimeModResultShm(Runtime* _runtime)
+{
+  if (_runtime == NULL)
+    return NULL;
+
+  return &_runtime->m_modules.m_resultShm;
+}
+
+LatencyStats* runtimeModStats(Runtime* _runtime)
+{
+  if (_runtime == NULL)
+    return NULL;
+
+  return &_runtime->m_modules.m_stats;
+}
+
 bool runtimeGetTerminate(Runtime* _runtime)
 {
   if (_runtime == NULL)
@@ -351,16 +919,74 @@ void runtimeSetTerminate(Runtime* _runtime)
     return;
 
   _runtime->m_threads.m_terminate = true;
+
+  // wakes input thread and main
+  if (_runtime->m_threads.m_terminateFd != -1)
+  {
+    const uint64_t terminateEvent = 1;
+    if (write(_runtime->m_threads.m_terminateFd, &terminateEvent, sizeof(terminateEvent)) < 0)
+      fprintf(stderr, "write(terminate eventfd) failed: %d\n", errno);
+  }
+
+  // do not let audio thread sleep on empty capture ring; no-op unless capture thread is used
+  pcmRingWakeup(&_runtime->m_modules.m_captureRing);
+  resultQueueWakeup(&_runtime->m_modules.m_resultQueue);
+}
+
+int runtimeGetTerminateFd(Runtime* _runtime)
+{
+  if (_runtime == NULL)
+    return -1;
+
+  return _runtime->m_threads.m_terminateFd;
+}
+
+static void do_snapshotRead(RuntimeState* _state, RuntimeSnapshot* _snapshot)
+{
+  unsigned int seq;
+
+  do
+  {
+    while ((seq = __atomic_load_n(&_state->m_snapshotSeq, __ATOMIC_ACQUIRE)) & 1)
+      ;
+    *_snapshot = _state->m_snapshot;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  } while (__atomic_load_n(&_state->m_snapshotSeq, __ATOMIC_RELAXED) != seq);
+}
+
+static RuntimeSnapshot* do_snapshotWriteBegin(RuntimeState* _state)
+{
+  pthread_mutex_lock(&_state->m_mutex);
+  __atomic_store_n(&_state->m_snapshotSeq, _state->m_snapshotSeq + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  return &_state->m_snapshot;
+}
+
+static void do_snapshotWriteEnd(RuntimeState* _state)
+{
+  __atomic_store_n(&_state->m_snapshotSeq, _state->m_snapshotSeq + 1, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&_state->m_mutex);
+}
+
+int runtimeGetSnapshot(Runtime* _runtime, RuntimeSnapshot* _snapshot)
+{
+  if (_runtime == NULL || _snapshot == NULL)
+    return EINVAL;
+
+  do_snapshotRead(&_runtime->m_state, _snapshot);
+  return 0;
 }
 
 int runtimeGetTargetDetectParams(Runtime* _runtime, TargetDetectParams* _targetDetectParams)
 {
+  RuntimeSnapshot snapshot;
+
   if (_runtime == NULL || _targetDetectParams == NULL)
     return EINVAL;
 
-  pthread_mutex_lock(&_runtime->m_state.m_mutex);
-  *_targetDetectParams = _runtime->m_state.m_targetDetectParams;
-  pthread_mutex_unlock(&_runtime->m_state.m_mutex);
+  do_snapshotRead(&_runtime->m_state, &snapshot);
+  *_targetDetectParams = snapshot.m_targetDetectParams;
   return 0;
 }
 
@@ -369,20 +995,20 @@ int runtimeSetTargetDetectParams(Runtime* _runtime, const TargetDetectParams* _t
   if (_runtime == NULL || _targetDetectParams == NULL)
     return EINVAL;
 
-  pthread_mutex_lock(&_runtime->m_state.m_mutex);
-  _runtime->m_state.m_targetDetectParams = *_targetDetectParams;
-  pthread_mutex_unlock(&_runtime->m_state.m_mutex);
+  do_snapshotWriteBegin(&_runtime->m_state)->m_targetDetectParams = *_targetDetectParams;
+  do_snapshotWriteEnd(&_runtime->m_state);
   return 0;
 }
 
 int runtimeGetVideoOutParams(Runtime* _runtime, bool* _videoOutEnable)
 {
+  RuntimeSnapshot snapshot;
+
   if (_runtime == NULL || _videoOutEnable == NULL)
     return EINVAL;
 
-  pthread_mutex_lock(&_runtime->m_state.m_mutex);
-  *_videoOutEnable = _runtime->m_state.m_videoOutEnable;
-  pthread_mutex_unlock(&_runtime->m_state.m_mutex);
+  do_snapshotRead(&_runtime->m_state, &snapshot);
+  *_videoOutEnable = snapshot.m_videoOutEnable;
   return 0;
 }
 
@@ -391,9 +1017,8 @@ int runtimeSetVideoOutParams(Runtime* _runtime, const bool* _videoOutEnable)
   if (_runtime == NULL || _videoOutEnable == NULL)
     return EINVAL;
 
-  pthread_mutex_lock(&_runtime->m_state.m_mutex);
-  _runtime->m_state.m_videoOutEnable = *_videoOutEnable;
-  pthread_mutex_unlock(&_runtime->m_state.m_mutex);
+  do_snapshotWriteBegin(&_runtime->m_state)->m_videoOutEnable = *_videoOutEnable;
+  do_snapshotWriteEnd(&_runtime->m_state);
   return 0;
 }
 
@@ -402,10 +1027,7 @@ int runtimeFetchTargetDetectCommand(Runtime* _runtime, TargetDetectCommand* _tar
   if (_runtime == NULL || _targetDetectCommand == NULL)
     return EINVAL;
 
-  pthread_mutex_lock(&_runtime->m_state.m_mutex);
-  *_targetDetectCommand = _runtime->m_state.m_targetDetectCommand;
-  _runtime->m_state.m_targetDetectCommand.m_cmd = 0;
-  pthread_mutex_unlock(&_runtime->m_state.m_mutex);
+  _targetDetectCommand->m_cmd = __atomic_exchange_n(&_runtime->m_state.m_targetDetectCommand.m_cmd, 0, __ATOMIC_ACQ_REL);
   return 0;
 }
 
@@ -414,32 +1036,41 @@ int runtimeSetTargetDetectCommand(Runtime* _runtime, const TargetDetectCommand*
   if (_runtime == NULL || _targetDetectCommand == NULL)
     return EINVAL;
 
-  pthread_mutex_lock(&_runtime->m_state.m_mutex);
-  _runtime->m_state.m_targetDetectCommand = *_targetDetectCommand;
-  pthread_mutex_unlock(&_runtime->m_state.m_mutex);
+  __atomic_store_n(&_runtime->m_state.m_targetDetectCommand.m_cmd, _targetDetectCommand->m_cmd, __ATOMIC_RELEASE);
   return 0;
 }
 
+// Results are only queued here; output FIFO is written by publish thread
 int runtimeReportTargetLocation(Runtime* _runtime, const TargetLocation* _targetLocation)
 {
+  ResultRecord record;
+
   if (_runtime == NULL || _targetLocation == NULL)
     return EINVAL;
 
-#warning Unsafe
-  rcInputUnsafeReportTargetLocation(&_runtime->m_modules.m_rcInput, _targetLocation);
+  record.m_kind = RESULT_KIND_TARGET_LOCATION;
+  record.m_sequence = __atomic_fetch_add(&_runtime->m_state.m_resultSequence, 1, __ATOMIC_RELAXED);
+  record.m_targetLocation = *_targetLocation;
 
-  return 0;
+  // shared memory is not behind the queue, local readers get result with no thread hop
+  if (_runtime->m_modules.m_resultShm.m_shm != NULL)
+    resultShmPublish(&_runtime->m_modules.m_resultShm, &record);
+
+  return resultQueuePush(&_runtime->m_modules.m_resultQueue, &record);
 }
 
 int runtimeReportTargetDetectParams(Runtime* _runtime, const TargetDetectParams* _targetDetectParams)
 {
+  ResultRecord record;
+
   if (_runtime == NULL || _targetDetectParams == NULL)
     return EINVAL;
 
-#warning Unsafe
-  rcInputUnsafeReportTargetDetectParams(&_runtime->m_modules.m_rcInput, _targetDetectParams);
+  record.m_kind = RESULT_KIND_TARGET_DETECT_PARAMS;
+  record.m_sequence = __atomic_fetch_add(&_runtime->m_state.m_resultSequence, 1, __ATOMIC_RELAXED);
+  record.m_targetDetectParams = *_targetDetectParams;
 
-  return 0;
+  return resultQueuePush(&_runtime->m_modules.m_resultQueue, &record);
 }
 
 
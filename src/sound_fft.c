@@ -0,0 +1,139 @@
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <errno.h>
+
+#include "internal/sound_fft.h"
+
+
+static void do_transform(const SoundFFT* _fft, float* _re, float* _im, float _sign)
+{
+  const size_t size = _fft->m_size;
+  size_t idx;
+
+  for (idx = 0; idx < size; ++idx)
+  {
+    const size_t rev = _fft->m_bitReverse[idx];
+    if (rev > idx)
+    {
+      float t;
+      t = _re[idx]; _re[idx] = _re[rev]; _re[rev] = t;
+      t = _im[idx]; _im[idx] = _im[rev]; _im[rev] = t;
+    }
+  }
+
+  size_t half;
+  for (half = 1; half < size; half *= 2)
+  {
+    const size_t twiddleStep = size / (2*half);
+    size_t start;
+    for (start = 0; start < size; start += 2*half)
+    {
+      size_t k;
+      for (k = 0; k < half; ++k)
+      {
+        const float wr = _fft->m_cos[k * twiddleStep];
+        const float wi = _sign * _fft->m_sin[k * twiddleStep];
+        const size_t i0 = start + k;
+        const size_t i1 = i0 + half;
+
+        const float tr = _re[i1]*wr - _im[i1]*wi;
+        const float ti = _re[i1]*wi + _im[i1]*wr;
+        _re[i1] = _re[i0] - tr;
+        _im[i1] = _im[i0] - ti;
+        _re[i0] += tr;
+        _im[i0] += ti;
+      }
+    }
+  }
+}
+
+
+
+
+int soundFFTInit(SoundFFT* _fft, size_t _size)
+{
+  size_t idx;
+  unsigned bits = 0;
+
+  if (_fft == NULL || _size < 2 || (_size & (_size-1)) != 0)
+    return EINVAL;
+  if (_fft->m_size != 0)
+    return EALREADY;
+
+  while (((size_t)1 << bits) < _size)
+    ++bits;
+
+  _fft->m_cos        = malloc(_size/2 * sizeof(*_fft->m_cos));
+  _fft->m_sin        = malloc(_size/2 * sizeof(*_fft->m_sin));
+  _fft->m_bitReverse = malloc(_size * sizeof(*_fft->m_bitReverse));
+  if (_fft->m_cos == NULL || _fft->m_sin == NULL || _fft->m_bitReverse == NULL)
+  {
+    fprintf(stderr, "malloc(fft %zu) failed\n", _size);
+    soundFFTFini(_fft);
+    return ENOMEM;
+  }
+
+  for (idx = 0; idx < _size/2; ++idx)
+  {
+    // forward transform uses exp(-2*pi*i*k/N)
+    _fft->m_cos[idx] =  cos(2.0 * M_PI * idx / _size);
+    _fft->m_sin[idx] = -sin(2.0 * M_PI * idx / _size);
+  }
+
+  for (idx = 0; idx < _size; ++idx)
+  {
+    unsigned rev = 0;
+    unsigned bit;
+    for (bit = 0; bit < bits; ++bit)
+      if (idx & ((size_t)1 << bit))
+        rev |= 1u << (bits - 1 - bit);
+    _fft->m_bitReverse[idx] = rev;
+  }
+
+  _fft->m_size = _size;
+
+  return 0;
+}
+
+int soundFFTFini(SoundFFT* _fft)
+{
+  if (_fft == NULL)
+    return EINVAL;
+
+  free(_fft->m_cos);
+  free(_fft->m_sin);
+  free(_fft->m_bitReverse);
+  _fft->m_cos = NULL;
+  _fft->m_sin = NULL;
+  _fft->m_bitReverse = NULL;
+  _fft->m_size = 0;
+
+  return 0;
+}
+
+int soundFFTForward(const SoundFFT* _fft, float* _re, float* _im)
+{
+  if (_fft == NULL || _re == NULL || _im == NULL)
+    return EINVAL;
+  if (_fft->m_size == 0)
+    return ENOTCONN;
+
+  do_transform(_fft, _re, _im, 1.0f);
+
+  return 0;
+}
+
+int soundFFTInverse(const SoundFFT* _fft, float* _re, float* _im)
+{
+  if (_fft == NULL || _re == NULL || _im == NULL)
+    return EINVAL;
+  if (_fft->m_size == 0)
+    return ENOTCONN;
+
+  do_transform(_fft, _re, _im, -1.0f);
+
+  return 0;
+}
+
@@ -0,0 +1,132 @@
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+
+#include "internal/sound_kernels.h"
+#include "internal/sound_gate.h"
+
+
+// Keeps digital silence from making floor zero, which would open gate on any noise; ~2 LSB RMS
+#define SOUND_GATE_FLOOR_MIN	4
+
+static uint64_t do_ratioQ8(double _db)
+{
+  return (uint64_t)(pow(10.0, _db / 10.0) * 256.0 + 0.5);
+}
+
+static uint32_t do_sqrt(uint64_t _value)
+{
+  uint64_t root = (uint64_t)sqrt((double)_value);
+  while (root * root > _value)
+    --root;
+  return root;
+}
+
+
+
+
+void soundGateReset(SoundGate* _gate)
+{
+  if (_gate == NULL)
+    return;
+
+  _gate->m_noiseFloor = 0;
+  _gate->m_open = false;
+  __atomic_store_n(&_gate->m_gatedFrames, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&_gate->m_passedFrames, 0, __ATOMIC_RELAXED);
+}
+
+void soundGateConfigure(SoundGate* _gate, unsigned int _thresholdDb, unsigned int _hysteresisDb)
+{
+  if (_gate == NULL)
+    return;
+
+  if (_thresholdDb > SOUND_GATE_THRESHOLD_MAX)
+    _thresholdDb = SOUND_GATE_THRESHOLD_MAX;
+  if (_hysteresisDb > _thresholdDb)
+    _hysteresisDb = _thresholdDb;
+
+  if (_thresholdDb == _gate->m_thresholdDb && _hysteresisDb == _gate->m_hysteresisDb)
+    return;
+
+  // floating point here only, on parameter change
+  _gate->m_thresholdDb  = _thresholdDb;
+  _gate->m_hysteresisDb = _hysteresisDb;
+  _gate->m_openRatioQ8  = do_ratioQ8(_thresholdDb);
+  _gate->m_closeRatioQ8 = do_ratioQ8(_thresholdDb - _hysteresisDb);
+}
+
+bool soundGateUpdate(SoundGate* _gate, const int16_t* _src, size_t _frames, size_t _channels, SoundGateLevels* _levels)
+{
+  size_t channel;
+  uint64_t energy[SOUND_GATE_CHANNELS_MAX];
+  uint32_t peak[SOUND_GATE_CHANNELS_MAX];
+  uint64_t meanSquare = 0;
+
+  if (_gate == NULL || _src == NULL || _levels == NULL || _frames == 0 || _channels > SOUND_GATE_CHANNELS_MAX)
+    return true;
+
+  soundKernelLevelsS16(_src, _frames, _channels, energy, peak);
+
+  _levels->m_channels = _channels;
+  for (channel = 0; channel < _channels; ++channel)
+  {
+    const uint64_t channelMeanSquare = energy[channel] / _frames;
+    _levels->m_rms[channel]  = do_sqrt(channelMeanSquare);
+    _levels->m_peak[channel] = peak[channel];
+    if (channelMeanSquare > meanSquare)
+      meanSquare = channelMeanSquare;
+  }
+
+  if (_gate->m_thresholdDb == 0)
+  {
+    __atomic_store_n(&_gate->m_passedFrames, _gate->m_passedFrames + 1, __ATOMIC_RELAXED);
+    return true;
+  }
+
+  if (_gate->m_noiseFloor == 0)
+    _gate->m_noiseFloor = meanSquare;
+  if (_gate->m_noiseFloor < SOUND_GATE_FLOOR_MIN)
+    _gate->m_noiseFloor = SOUND_GATE_FLOOR_MIN;
+
+  const uint64_t level = meanSquare * 256;
+  if (!_gate->m_open && level > _gate->m_noiseFloor * _gate->m_openRatioQ8)
+    _gate->m_open = true;
+  else if (_gate->m_open && level < _gate->m_noiseFloor * _gate->m_closeRatioQ8)
+    _gate->m_open = false;
+
+  // closed: track ambient level; open: fall with quieter frames, rise very slowly so steady noise closes gate eventually
+  if (!_gate->m_open)
+    _gate->m_noiseFloor = _gate->m_noiseFloor - _gate->m_noiseFloor / 8 + meanSquare / 8;
+  else if (meanSquare < _gate->m_noiseFloor)
+    _gate->m_noiseFloor = meanSquare;
+  else
+    _gate->m_noiseFloor = _gate->m_noiseFloor - _gate->m_noiseFloor / 256 + meanSquare / 256;
+
+  if (_gate->m_open)
+    __atomic_store_n(&_gate->m_passedFrames, _gate->m_passedFrames + 1, __ATOMIC_RELAXED);
+  else
+    __atomic_store_n(&_gate->m_gatedFrames, _gate->m_gatedFrames + 1, __ATOMIC_RELAXED);
+
+  return _gate->m_open;
+}
+
+int soundGateReport(const SoundGate* _gate)
+{
+  if (_gate == NULL)
+    return EINVAL;
+
+  if (_gate->m_thresholdDb == 0)
+    return 0;
+
+  fprintf(stderr, "Gate: %u frames gated, %u passed, noise floor %u RMS, threshold %udB, hysteresis %udB\n",
+          __atomic_load_n(&_gate->m_gatedFrames, __ATOMIC_RELAXED),
+          __atomic_load_n(&_gate->m_passedFrames, __ATOMIC_RELAXED),
+          do_sqrt(_gate->m_noiseFloor), _gate->m_thresholdDb, _gate->m_hysteresisDb);
+
+  return 0;
+}
+
@@ -0,0 +1,578 @@
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define SOUND_KERNELS_NEON 1
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#define SOUND_KERNELS_SSE2 1
+#include <emmintrin.h>
+#elif defined(HAVE_ARMV5TE_KERNELS)
+#define SOUND_KERNELS_ARMV5TE 1
+#endif
+
+#include "internal/sound_kernels.h"
+
+
+static void do_deinterleaveS16(const int16_t* _src, size_t _frames, int16_t* _left, int16_t* _right)
+{
+  size_t idx;
+  for (idx = 0; idx < _frames; ++idx)
+  {
+    _left[idx]  = _src[2*idx];
+    _right[idx] = _src[2*idx+1];
+  }
+}
+
+static void do_deinterleaveNS16(const int16_t* _src, size_t _frames, size_t _channels, int16_t* const* _dst, size_t _offset)
+{
+  size_t idx;
+  size_t channel;
+  for (idx = 0; idx < _frames; ++idx)
+    for (channel = 0; channel < _channels; ++channel)
+      _dst[channel][_offset + idx] = _src[idx*_channels + channel];
+}
+
+static int64_t do_dotS16(const int16_t* _a, const int16_t* _b, size_t _count)
+{
+  size_t idx;
+  int64_t sum = 0;
+  for (idx = 0; idx < _count; ++idx)
+    sum += (int32_t)_a[idx] * (int32_t)_b[idx];
+  return sum;
+}
+
+static uint64_t do_sumAbsS16(const int16_t* _a, size_t _count)
+{
+  size_t idx;
+  uint64_t sum = 0;
+  for (idx = 0; idx < _count; ++idx)
+    sum += _a[idx] < 0 ? -(int32_t)_a[idx] : _a[idx];
+  return sum;
+}
+
+static int64_t do_sumS16(const int16_t* _a, size_t _count)
+{
+  size_t idx;
+  int64_t sum = 0;
+  for (idx = 0; idx < _count; ++idx)
+    sum += _a[idx];
+  return sum;
+}
+
+static void do_subtractS16(int16_t* _a, size_t _count, int16_t _value)
+{
+  size_t idx;
+  for (idx = 0; idx < _count; ++idx)
+  {
+    const int32_t diff = (int32_t)_a[idx] - _value;
+    _a[idx] = diff > INT16_MAX ? INT16_MAX : diff < INT16_MIN ? INT16_MIN : diff;
+  }
+}
+
+static void do_levelsS16(const int16_t* _src, size_t _frames, size_t _channels, uint64_t* _energy, uint32_t* _peak)
+{
+  size_t idx;
+  size_t channel;
+  for (idx = 0; idx < _frames; ++idx)
+    for (channel = 0; channel < _channels; ++channel)
+    {
+      const int32_t sample = _src[idx*_channels + channel];
+      const uint32_t magnitude = sample < 0 ? (sample == INT16_MIN ? INT16_MAX : -sample) : sample; // saturated as in SIMD
+      _energy[channel] += (uint64_t)(sample * sample);
+      if (magnitude > _peak[channel])
+        _peak[channel] = magnitude;
+    }
+}
+
+
+#if defined(SOUND_KERNELS_NEON)
+
+const char* soundKernelsName()
+{
+  return "neon";
+}
+
+void soundKernelDeinterleaveS16(const int16_t* _src, size_t _frames, int16_t* _left, int16_t* _right)
+{
+  size_t idx;
+  for (idx = 0; idx + 8 <= _frames; idx += 8)
+  {
+    const int16x8x2_t lr = vld2q_s16(_src + 2*idx);
+    vst1q_s16(_left  + idx, lr.val[0]);
+    vst1q_s16(_right + idx, lr.val[1]);
+  }
+
+  do_deinterleaveS16(_src + 2*idx, _frames - idx, _left + idx, _right + idx);
+}
+
+int64_t soundKernelDotS16(const int16_t* _a, const int16_t* _b, size_t _count)
+{
+  size_t idx;
+  int64x2_t acc = vdupq_n_s64(0);
+  for (idx = 0; idx + 8 <= _count; idx += 8)
+  {
+    const int16x8_t a = vld1q_s16(_a + idx);
+    const int16x8_t b = vld1q_s16(_b + idx);
+    acc = vpadalq_s32(acc, vmull_s16(vget_low_s16(a),  vget_low_s16(b)));
+    acc = vpadalq_s32(acc, vmull_s16(vget_high_s16(a), vget_high_s16(b)));
+  }
+
+  return vgetq_lane_s64(acc, 0) + vgetq_lane_s64(acc, 1) + do_dotS16(_a + idx, _b + idx, _count - idx);
+}
+
+uint64_t soundKernelSumAbsS16(const int16_t* _a, size_t _count)
+{
+  size_t idx;
+  uint64x2_t acc = vdupq_n_u64(0);
+  for (idx = 0; idx + 8 <= _count; idx += 8)
+  {
+    const int16x8_t a = vld1q_s16(_a + idx);
+    acc = vpadalq_u32(acc, vreinterpretq_u32_s32(vabsq_s32(vmovl_s16(vget_low_s16(a)))));
+    acc = vpadalq_u32(acc, vreinterpretq_u32_s32(vabsq_s32(vmovl_s16(vget_high_s16(a)))));
+  }
+
+  return vgetq_lane_u64(acc, 0) + vgetq_lane_u64(acc, 1) + do_sumAbsS16(_a + idx, _count - idx);
+}
+
+static void do_subtractSatS16(int16_t* _a, size_t _count, int16_t _value)
+{
+  size_t idx;
+  const int16x8_t value = vdupq_n_s16(_value);
+  for (idx = 0; idx + 8 <= _count; idx += 8)
+    vst1q_s16(_a + idx, vqsubq_s16(vld1q_s16(_a + idx), value));
+
+  do_subtractS16(_a + idx, _count - idx, _value);
+}
+
+static void do_deinterleaveS16x4(const int16_t* _src, size_t _frames, int16_t* const* _dst)
+{
+  size_t idx;
+  for (idx = 0; idx + 8 <= _frames; idx += 8)
+  {
+    const int16x8x4_t frames = vld4q_s16(_src + 4*idx);
+    vst1q_s16(_dst[0] + idx, frames.val[0]);
+    vst1q_s16(_dst[1] + idx, frames.val[1]);
+    vst1q_s16(_dst[2] + idx, frames.val[2]);
+    vst1q_s16(_dst[3] + idx, frames.val[3]);
+  }
+
+  do_deinterleaveNS16(_src + 4*idx, _frames - idx, 4, _dst, idx);
+}
+
+static void do_deinterleaveS16x8(const int16_t* _src, size_t _frames, int16_t* const* _dst)
+{
+  size_t idx;
+  size_t channel;
+  for (idx = 0; idx + 8 <= _frames; idx += 8)
+  {
+    // 4-way load leaves channels c and c+4 alternating, for 4 frames per load
+    const int16x8x4_t lo = vld4q_s16(_src + 8*idx);
+    const int16x8x4_t hi = vld4q_s16(_src + 8*idx + 32);
+    for (channel = 0; channel < 4; ++channel)
+    {
+      const int16x8x2_t split = vuzpq_s16(lo.val[channel], hi.val[channel]);
+      vst1q_s16(_dst[channel]     + idx, split.val[0]);
+      vst1q_s16(_dst[channel + 4] + idx, split.val[1]);
+    }
+  }
+
+  do_deinterleaveNS16(_src + 8*idx, _frames - idx, 8, _dst, idx);
+}
+
+static void do_levelsS16x2(const int16_t* _src, size_t _frames, uint64_t* _energy, uint32_t* _peak)
+{
+  size_t idx;
+  int64x2_t energyL = vdupq_n_s64(0);
+  int64x2_t energyR = vdupq_n_s64(0);
+  int16x8_t peakL = vdupq_n_s16(0);
+  int16x8_t peakR = vdupq_n_s16(0);
+  for (idx = 0; idx + 8 <= _frames; idx += 8)
+  {
+    const int16x8x2_t lr = vld2q_s16(_src + 2*idx);
+    energyL = vpadalq_s32(energyL, vmull_s16(vget_low_s16(lr.val[0]),  vget_low_s16(lr.val[0])));
+    energyL = vpadalq_s32(energyL, vmull_s16(vget_high_s16(lr.val[0]), vget_high_s16(lr.val[0])));
+    energyR = vpadalq_s32(energyR, vmull_s16(vget_low_s16(lr.val[1]),  vget_low_s16(lr.val[1])));
+    energyR = vpadalq_s32(energyR, vmull_s16(vget_high_s16(lr.val[1]), vget_high_s16(lr.val[1])));
+    peakL = vmaxq_s16(peakL, vqabsq_s16(lr.val[0]));
+    peakR = vmaxq_s16(peakR, vqabsq_s16(lr.val[1]));
+  }
+
+  int16_t lanesL[8];
+  int16_t lanesR[8];
+  size_t lane;
+  vst1q_s16(lanesL, peakL);
+  vst1q_s16(lanesR, peakR);
+  for (lane = 0; lane < 8; ++lane)
+  {
+    if ((uint32_t)lanesL[lane] > _peak[0])
+      _peak[0] = lanesL[lane];
+    if ((uint32_t)lanesR[lane] > _peak[1])
+      _peak[1] = lanesR[lane];
+  }
+  _energy[0] += vgetq_lane_s64(energyL, 0) + vgetq_lane_s64(energyL, 1);
+  _energy[1] += vgetq_lane_s64(energyR, 0) + vgetq_lane_s64(energyR, 1);
+
+  do_levelsS16(_src + 2*idx, _frames - idx, 2, _energy, _peak);
+}
+
+#elif defined(SOUND_KERNELS_SSE2)
+
+const char* soundKernelsName()
+{
+  return "sse2";
+}
+
+void soundKernelDeinterleaveS16(const int16_t* _src, size_t _frames, int16_t* _left, int16_t* _right)
+{
+  size_t idx;
+  for (idx = 0; idx + 8 <= _frames; idx += 8)
+  {
+    const __m128i lr0 = _mm_loadu_si128((const __m128i*)(_src + 2*idx));
+    const __m128i lr1 = _mm_loadu_si128((const __m128i*)(_src + 2*idx + 8));
+    const __m128i l0  = _mm_srai_epi32(_mm_slli_epi32(lr0, 16), 16);
+    const __m128i l1  = _mm_srai_epi32(_mm_slli_epi32(lr1, 16), 16);
+    const __m128i r0  = _mm_srai_epi32(lr0, 16);
+    const __m128i r1  = _mm_srai_epi32(lr1, 16);
+    _mm_storeu_si128((__m128i*)(_left  + idx), _mm_packs_epi32(l0, l1));
+    _mm_storeu_si128((__m128i*)(_right + idx), _mm_packs_epi32(r0, r1));
+  }
+
+  do_deinterleaveS16(_src + 2*idx, _frames - idx, _left + idx, _right + idx);
+}
+
+int64_t soundKernelDotS16(const int16_t* _a, const int16_t* _b, size_t _count)
+{
+  size_t idx;
+  __m128i acc = _mm_setzero_si128();
+  const __m128i wrapped = _mm_set1_epi32(INT32_MIN);
+  for (idx = 0; idx + 8 <= _count; idx += 8)
+  {
+    const __m128i a    = _mm_loadu_si128((const __m128i*)(_a + idx));
+    const __m128i b    = _mm_loadu_si128((const __m128i*)(_b + idx));
+    const __m128i prod = _mm_madd_epi16(a, b);
+    // only two -32768*-32768 products reach INT32_MIN, real pair sum is +2^31 then
+    const __m128i sign = _mm_andnot_si128(_mm_cmpeq_epi32(prod, wrapped), _mm_srai_epi32(prod, 31));
+    acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(prod, sign));
+    acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(prod, sign));
+  }
+
+  int64_t lanes[2];
+  _mm_storeu_si128((__m128i*)lanes, acc);
+
+  return lanes[0] + lanes[1] + do_dotS16(_a + idx, _b + idx, _count - idx);
+}
+
+uint64_t soundKernelSumAbsS16(const int16_t* _a, size_t _count)
+{
+  size_t idx = 0;
+  uint64_t sum = 0;
+  const __m128i zero = _mm_setzero_si128();
+
+  while (idx + 8 <= _count)
+  {
+    // 32-bit lanes are flushed before they may overflow
+    size_t blockEnd = idx + 8*16384;
+    if (blockEnd > _count)
+      blockEnd = _count;
+
+    __m128i acc = _mm_setzero_si128();
+    for (; idx + 8 <= blockEnd; idx += 8)
+    {
+      const __m128i a    = _mm_loadu_si128((const __m128i*)(_a + idx));
+      const __m128i sign = _mm_srai_epi16(a, 15);
+      const __m128i abs  = _mm_sub_epi16(_mm_xor_si128(a, sign), sign); // unsigned 16-bit
+      acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(abs, zero));
+      acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(abs, zero));
+    }
+
+    uint32_t lanes[4];
+    _mm_storeu_si128((__m128i*)lanes, acc);
+    sum += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  }
+
+  return sum + do_sumAbsS16(_a + idx, _count - idx);
+}
+
+static void do_subtractSatS16(int16_t* _a, size_t _count, int16_t _value)
+{
+  size_t idx;
+  const __m128i value = _mm_set1_epi16(_value);
+  for (idx = 0; idx + 8 <= _count; idx += 8)
+    _mm_storeu_si128((__m128i*)(_a + idx), _mm_subs_epi16(_mm_loadu_si128((const __m128i*)(_a + idx)), value));
+
+  do_subtractS16(_a + idx, _count - idx, _value);
+}
+
+static void do_deinterleaveS16x4(const int16_t* _src, size_t _frames, int16_t* const* _dst)
+{
+  size_t idx;
+  for (idx = 0; idx + 8 <= _frames; idx += 8)
+  {
+    const __m128i f01 = _mm_loadu_si128((const __m128i*)(_src + 4*idx));
+    const __m128i f23 = _mm_loadu_si128((const __m128i*)(_src + 4*idx + 8));
+    const __m128i f45 = _mm_loadu_si128((const __m128i*)(_src + 4*idx + 16));
+    const __m128i f67 = _mm_loadu_si128((const __m128i*)(_src + 4*idx + 24));
+
+    // frames 0,2 / 1,3 interleaved per channel, then every channel of frames 0..3 in one half
+    const __m128i a = _mm_unpacklo_epi16(f01, f23);
+    const __m128i b = _mm_unpackhi_epi16(f01, f23);
+    const __m128i c = _mm_unpacklo_epi16(f45, f67);
+    const __m128i d = _mm_unpackhi_epi16(f45, f67);
+    const __m128i ch01lo = _mm_unpacklo_epi16(a, b);
+    const __m128i ch23lo = _mm_unpackhi_epi16(a, b);
+    const __m128i ch01hi = _mm_unpacklo_epi16(c, d);
+    const __m128i ch23hi = _mm_unpackhi_epi16(c, d);
+
+    _mm_storeu_si128((__m128i*)(_dst[0] + idx), _mm_unpacklo_epi64(ch01lo, ch01hi));
+    _mm_storeu_si128((__m128i*)(_dst[1] + idx), _mm_unpackhi_epi64(ch01lo, ch01hi));
+    _mm_storeu_si128((__m128i*)(_dst[2] + idx), _mm_unpacklo_epi64(ch23lo, ch23hi));
+    _mm_storeu_si128((__m128i*)(_dst[3] + idx), _mm_unpackhi_epi64(ch23lo, ch23hi));
+  }
+
+  do_deinterleaveNS16(_src + 4*idx, _frames - idx, 4, _dst, idx);
+}
+
+static void do_deinterleaveS16x8(const int16_t* _src, size_t _frames, int16_t* const* _dst)
+{
+  size_t idx;
+  for (idx = 0; idx + 8 <= _frames; idx += 8)
+  {
+    const __m128i* src = (const __m128i*)(_src + 8*idx);
+    const __m128i f0 = _mm_loadu_si128(src + 0), f1 = _mm_loadu_si128(src + 1);
+    const __m128i f2 = _mm_loadu_si128(src + 2), f3 = _mm_loadu_si128(src + 3);
+    const __m128i f4 = _mm_loadu_si128(src + 4), f5 = _mm_loadu_si128(src + 5);
+    const __m128i f6 = _mm_loadu_si128(src + 6), f7 = _mm_loadu_si128(src + 7);
+
+    // 8x8 transpose in 16, 32 and 64 bit steps
+    const __m128i a0 = _mm_unpacklo_epi16(f0, f1), a1 = _mm_unpackhi_epi16(f0, f1);
+    const __m128i a2 = _mm_unpacklo_epi16(f2, f3), a3 = _mm_unpackhi_epi16(f2, f3);
+    const __m128i a4 = _mm_unpacklo_epi16(f4, f5), a5 = _mm_unpackhi_epi16(f4, f5);
+    const __m128i a6 = _mm_unpacklo_epi16(f6, f7), a7 = _mm_unpackhi_epi16(f6, f7);
+
+    const __m128i b0 = _mm_unpacklo_epi32(a0, a2), b1 = _mm_unpackhi_epi32(a0, a2);
+    const __m128i b2 = _mm_unpacklo_epi32(a1, a3), b3 = _mm_unpackhi_epi32(a1, a3);
+    const __m128i b4 = _mm_unpacklo_epi32(a4, a6), b5 = _mm_unpackhi_epi32(a4, a6);
+    const __m128i b6 = _mm_unpacklo_epi32(a5, a7), b7 = _mm_unpackhi_epi32(a5, a7);
+
+    _mm_storeu_si128((__m128i*)(_dst[0] + idx), _mm_unpacklo_epi64(b0, b4));
+    _mm_storeu_si128((__m128i*)(_dst[1] + idx), _mm_unpackhi_epi64(b0, b4));
+    _mm_storeu_si128((__m128i*)(_dst[2] + idx), _mm_unpacklo_epi64(b1, b5));
+    _mm_storeu_si128((__m128i*)(_dst[3] + idx), _mm_unpackhi_epi64(b1, b5));
+    _mm_storeu_si128((__m128i*)(_dst[4] + idx), _mm_unpacklo_epi64(b2, b6));
+    _mm_storeu_si128((__m128i*)(_dst[5] + idx), _mm_unpackhi_epi64(b2, b6));
+    _mm_storeu_si128((__m128i*)(_dst[6] + idx), _mm_unpacklo_epi64(b3, b7));
+    _mm_storeu_si128((__m128i*)(_dst[7] + idx), _mm_unpackhi_epi64(b3, b7));
+  }
+
+  do_deinterleaveNS16(_src + 8*idx, _frames - idx, 8, _dst, idx);
+}
+
+static void do_levelsS16x2(const int16_t* _src, size_t _frames, uint64_t* _energy, uint32_t* _peak)
+{
+  size_t idx;
+  __m128i energyL = _mm_setzero_si128();
+  __m128i energyR = _mm_setzero_si128();
+  __m128i peakL = _mm_setzero_si128();
+  __m128i peakR = _mm_setzero_si128();
+  const __m128i zero = _mm_setzero_si128();
+
+  for (idx = 0; idx + 8 <= _frames; idx += 8)
+  {
+    const __m128i lr0 = _mm_loadu_si128((const __m128i*)(_src + 2*idx));
+    const __m128i lr1 = _mm_loadu_si128((const __m128i*)(_src + 2*idx + 8));
+    const __m128i l = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(lr0, 16), 16), _mm_srai_epi32(_mm_slli_epi32(lr1, 16), 16));
+    const __m128i r = _mm_packs_epi32(_mm_srai_epi32(lr0, 16), _mm_srai_epi32(lr1, 16));
+
+    // pair sums of squares fit unsigned 32 bits
+    const __m128i squaresL = _mm_madd_epi16(l, l);
+    const __m128i squaresR = _mm_madd_epi16(r, r);
+    energyL = _mm_add_epi64(energyL, _mm_add_epi64(_mm_unpacklo_epi32(squaresL, zero), _mm_unpackhi_epi32(squaresL, zero)));
+    energyR = _mm_add_epi64(energyR, _mm_add_epi64(_mm_unpacklo_epi32(squaresR, zero), _mm_unpackhi_epi32(squaresR, zero)));
+
+    peakL = _mm_max_epi16(peakL, _mm_max_epi16(l, _mm_subs_epi16(zero, l)));
+    peakR = _mm_max_epi16(peakR, _mm_max_epi16(r, _mm_subs_epi16(zero, r)));
+  }
+
+  int16_t lanesL[8];
+  int16_t lanesR[8];
+  uint64_t energy[2];
+  size_t lane;
+  _mm_storeu_si128((__m128i*)lanesL, peakL);
+  _mm_storeu_si128((__m128i*)lanesR, peakR);
+  for (lane = 0; lane < 8; ++lane)
+  {
+    if ((uint32_t)lanesL[lane] > _peak[0])
+      _peak[0] = lanesL[lane];
+    if ((uint32_t)lanesR[lane] > _peak[1])
+      _peak[1] = lanesR[lane];
+  }
+  _mm_storeu_si128((__m128i*)energy, energyL);
+  _energy[0] += energy[0] + energy[1];
+  _mm_storeu_si128((__m128i*)energy, energyR);
+  _energy[1] += energy[0] + energy[1];
+
+  do_levelsS16(_src + 2*idx, _frames - idx, 2, _energy, _peak);
+}
+
+#elif defined(SOUND_KERNELS_ARMV5TE)
+
+// Word loads of sample pairs; samples are little-endian, so bottom halfword is the earlier one
+typedef uint32_t __attribute__((__may_alias__)) SoundKernelsPair;
+
+const char* soundKernelsName()
+{
+  return "armv5te";
+}
+
+// SMLAL<x><y> multiplies selected halfwords and accumulates into 64 bits, two samples per word load
+int64_t soundKernelDotS16(const int16_t* _a, const int16_t* _b, size_t _count)
+{
+  size_t idx = 0;
+  int64_t sum = 0;
+
+  if (((uintptr_t)_a & 2) && _count > 0)
+  {
+    sum = (int32_t)_a[0] * (int32_t)_b[0];
+    ++_a;
+    ++_b;
+    --_count;
+  }
+
+  const SoundKernelsPair* a = (const SoundKernelsPair*)_a;
+  if (((uintptr_t)_b & 2) == 0)
+  {
+    const SoundKernelsPair* b = (const SoundKernelsPair*)_b;
+    for (; idx + 2 <= _count; idx += 2)
+    {
+      const uint32_t wa = *a++;
+      const uint32_t wb = *b++;
+      __asm__ ("smlalbb %Q0, %R0, %1, %2\n\t"
+               "smlaltt %Q0, %R0, %1, %2"
+               : "+r"(sum) : "r"(wa), "r"(wb));
+    }
+  }
+  else if (_count >= 3)
+  {
+    // _b is off by one sample: words hold b[i-1],b[i] and b[i+1],b[i+2]; b[-1] shares aligned word with b[0]
+    const SoundKernelsPair* b = (const SoundKernelsPair*)(_b - 1);
+    uint32_t prev = *b++;
+    for (; idx + 3 <= _count; idx += 2)
+    {
+      const uint32_t wa = *a++;
+      const uint32_t next = *b++;
+      __asm__ ("smlalbt %Q0, %R0, %1, %2\n\t"
+               "smlaltb %Q0, %R0, %1, %3"
+               : "+r"(sum) : "r"(wa), "r"(prev), "r"(next));
+      prev = next;
+    }
+  }
+
+  return sum + do_dotS16(_a + idx, _b + idx, _count - idx);
+}
+
+// QSUB saturates in Q31, so samples are subtracted in upper halfwords
+static void do_subtractSatS16(int16_t* _a, size_t _count, int16_t _value)
+{
+  size_t idx;
+  const int32_t value = (int32_t)_value << 16;
+  for (idx = 0; idx < _count; ++idx)
+  {
+    int32_t sample = (int32_t)_a[idx] << 16;
+    __asm__ ("qsub %0, %0, %1" : "+r"(sample) : "r"(value));
+    _a[idx] = sample >> 16;
+  }
+}
+
+#else
+
+const char* soundKernelsName()
+{
+  return "generic";
+}
+
+int64_t soundKernelDotS16(const int16_t* _a, const int16_t* _b, size_t _count)
+{
+  return do_dotS16(_a, _b, _count);
+}
+
+static void do_subtractSatS16(int16_t* _a, size_t _count, int16_t _value)
+{
+  do_subtractS16(_a, _count, _value);
+}
+
+#endif
+
+
+#if !defined(SOUND_KERNELS_NEON) && !defined(SOUND_KERNELS_SSE2)
+
+static void do_deinterleaveS16x4(const int16_t* _src, size_t _frames, int16_t* const* _dst)
+{
+  do_deinterleaveNS16(_src, _frames, 4, _dst, 0);
+}
+
+static void do_deinterleaveS16x8(const int16_t* _src, size_t _frames, int16_t* const* _dst)
+{
+  do_deinterleaveNS16(_src, _frames, 8, _dst, 0);
+}
+
+static void do_levelsS16x2(const int16_t* _src, size_t _frames, uint64_t* _energy, uint32_t* _peak)
+{
+  do_levelsS16(_src, _frames, 2, _energy, _peak);
+}
+
+void soundKernelDeinterleaveS16(const int16_t* _src, size_t _frames, int16_t* _left, int16_t* _right)
+{
+  do_deinterleaveS16(_src, _frames, _left, _right);
+}
+
+uint64_t soundKernelSumAbsS16(const int16_t* _a, size_t _count)
+{
+  return do_sumAbsS16(_a, _count);
+}
+
+#endif
+
+
+uint64_t soundKernelEnergyS16(const int16_t* _a, size_t _count)
+{
+  return (uint64_t)soundKernelDotS16(_a, _a, _count);
+}
+
+void soundKernelRemoveDCS16(int16_t* _a, size_t _count)
+{
+  if (_count == 0)
+    return;
+
+  const int16_t dc = do_sumS16(_a, _count) / (int64_t)_count;
+  if (dc != 0)
+    do_subtractSatS16(_a, _count, dc);
+}
+
+void soundKernelDeinterleaveNS16(const int16_t* _src, size_t _frames, size_t _channels, int16_t* const* _dst)
+{
+  switch (_channels)
+  {
+    case 2:  soundKernelDeinterleaveS16(_src, _frames, _dst[0], _dst[1]);	break;
+    case 4:  do_deinterleaveS16x4(_src, _frames, _dst);			break;
+    case 8:  do_deinterleaveS16x8(_src, _frames, _dst);			break;
+    default: do_deinterleaveNS16(_src, _frames, _channels, _dst, 0);	break;
+  }
+}
+
+void soundKernelLevelsS16(const int16_t* _src, size_t _frames, size_t _channels, uint64_t* _energy, uint32_t* _peak)
+{
+  size_t channel;
+  for (channel = 0; channel < _channels; ++channel)
+  {
+    _energy[channel] = 0;
+    _peak[channel] = 0;
+  }
+
+  if (_channels == 2)
+    do_levelsS16x2(_src, _frames, _energy, _peak);
+  else
+    do_levelsS16(_src, _frames, _channels, _energy, _peak);
+}
+
@@ -0,0 +1,164 @@
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#include "internal/stats.h"
+
+
+static const char* do_stageName(StatsStage _stage)
+{
+  switch (_stage)
+  {
+    case STATS_STAGE_CAPTURE_WAIT:	return "capture-wait";
+    case STATS_STAGE_PACK:		return "pack";
+    case STATS_STAGE_CMEM_COPY:		return "cmem-copy";
+    case STATS_STAGE_CACHE:		return "cache";
+    case STATS_STAGE_PROCESS:		return "process";
+    case STATS_STAGE_FB_COPY:		return "fb-copy";
+    case STATS_STAGE_REPORT:		return "report";
+    case STATS_STAGE_FRAME:		return "frame";
+    default:				return "unknown";
+  }
+}
+
+static size_t do_bucketIndex(uint64_t _ns)
+{
+  const size_t subBuckets = 1u << STATS_HISTOGRAM_SUB_BITS;
+
+  if (_ns < subBuckets)
+    return _ns;
+
+  const unsigned int exponent = 63 - __builtin_clzll(_ns);
+  const size_t index = (exponent - STATS_HISTOGRAM_SUB_BITS + 1) * subBuckets
+                     + ((_ns >> (exponent - STATS_HISTOGRAM_SUB_BITS)) & (subBuckets - 1));
+
+  return index < STATS_HISTOGRAM_BUCKETS ? index : STATS_HISTOGRAM_BUCKETS - 1;
+}
+
+// Upper bound of bucket values
+static uint64_t do_bucketValue(size_t _index)
+{
+  const size_t subBuckets = 1u << STATS_HISTOGRAM_SUB_BITS;
+
+  if (_index < subBuckets)
+    return _index;
+
+  const unsigned int shift = _index / subBuckets - 1;
+  return (((uint64_t)(subBuckets + _index % subBuckets) + 1) << shift) - 1;
+}
+
+// Bucket upper bound, but not above the largest value seen
+static uint64_t do_percentile(const StatsHistogram* _histogram, unsigned int _count, unsigned int _permille, uint64_t _maxNs)
+{
+  size_t idx;
+  unsigned long long seen = 0;
+  const unsigned long long rank = ((unsigned long long)_count * _permille + 999) / 1000;
+
+  for (idx = 0; idx < STATS_HISTOGRAM_BUCKETS; ++idx)
+  {
+    seen += __atomic_load_n(&_histogram->m_buckets[idx], __ATOMIC_RELAXED);
+    if (seen >= rank)
+      break;
+  }
+
+  const uint64_t value = do_bucketValue(idx < STATS_HISTOGRAM_BUCKETS ? idx : STATS_HISTOGRAM_BUCKETS - 1);
+  return value < _maxNs ? value : _maxNs;
+}
+
+
+
+
+uint64_t statsNowNs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+void statsReset(LatencyStats* _stats)
+{
+  if (_stats == NULL)
+    return;
+
+  memset(_stats, 0, sizeof(*_stats));
+}
+
+void statsRecord(LatencyStats* _stats, StatsStage _stage, uint64_t _ns)
+{
+  if (_stats == NULL || _stage >= STATS_STAGE_COUNT)
+    return;
+
+  // single writer, atomics only keep readers from seeing torn values
+  StatsHistogram* histogram = &_stats->m_stages[_stage];
+  unsigned int* bucket = &histogram->m_buckets[do_bucketIndex(_ns)];
+  __atomic_store_n(bucket, *bucket + 1, __ATOMIC_RELAXED);
+  __atomic_store_n(&histogram->m_count, histogram->m_count + 1, __ATOMIC_RELAXED);
+
+  const uint32_t ns = _ns > UINT32_MAX ? UINT32_MAX : _ns;
+  if (ns > histogram->m_maxNs)
+    __atomic_store_n(&histogram->m_maxNs, ns, __ATOMIC_RELAXED);
+}
+
+size_t statsFormat(const LatencyStats* _stats, char* _buffer, size_t _size)
+{
+  size_t stage;
+  size_t used = 0;
+
+  if (_stats == NULL || _buffer == NULL || _size == 0)
+    return 0;
+
+  _buffer[0] = '\0';
+  for (stage = 0; stage < STATS_STAGE_COUNT && used < _size; ++stage)
+  {
+    const StatsHistogram* histogram = &_stats->m_stages[stage];
+    const unsigned int count = __atomic_load_n(&histogram->m_count, __ATOMIC_RELAXED);
+    const uint32_t maxNs = __atomic_load_n(&histogram->m_maxNs, __ATOMIC_RELAXED);
+    if (count == 0)
+      continue;
+
+    const int res = snprintf(_buffer + used, _size - used,
+                             "stats: %s n=%u p50=%"PRIu64"us p99=%"PRIu64"us p999=%"PRIu64"us max=%"PRIu32"us\n",
+                             do_stageName(stage), count,
+                             do_percentile(histogram, count, 500, maxNs) / 1000,
+                             do_percentile(histogram, count, 990, maxNs) / 1000,
+                             do_percentile(histogram, count, 999, maxNs) / 1000,
+                             maxNs / 1000);
+    if (res < 0)
+      break;
+    used += (size_t)res < _size - used ? (size_t)res : _size - used - 1;
+  }
+
+  return used;
+}
+
+uint64_t statsPercentileNs(const StatsHistogram* _histogram, unsigned int _permille)
+{
+  if (_histogram == NULL)
+    return 0;
+
+  const unsigned int count = __atomic_load_n(&_histogram->m_count, __ATOMIC_RELAXED);
+  if (count == 0)
+    return 0;
+
+  return do_percentile(_histogram, count, _permille, __atomic_load_n(&_histogram->m_maxNs, __ATOMIC_RELAXED));
+}
+
+int statsReport(const LatencyStats* _stats)
+{
+  char buffer[1024];
+
+  if (_stats == NULL)
+    return EINVAL;
+
+  if (statsFormat(_stats, buffer, sizeof(buffer)) == 0)
+    fprintf(stderr, "stats: no frames yet\n");
+  else
+    fputs(buffer, stderr);
+
+  return 0;
+}
+
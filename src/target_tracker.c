@@ -0,0 +1,115 @@
+#include "config.h"
+#include <stdlib.h>
+#include <math.h>
+
+#include "internal/target_tracker.h"
+
+
+static double do_wrapAngle(double _angle)
+{
+  _angle = fmod(_angle, 360.0);
+  if (_angle > 180.0)
+    _angle -= 360.0;
+  else if (_angle <= -180.0)
+    _angle += 360.0;
+
+  return _angle;
+}
+
+static double do_clampRate(double _rate)
+{
+  if (_rate > TARGET_TRACKER_RATE_MAX)
+    return TARGET_TRACKER_RATE_MAX;
+  if (_rate < -TARGET_TRACKER_RATE_MAX)
+    return -TARGET_TRACKER_RATE_MAX;
+
+  return _rate;
+}
+
+static int do_reportAngle(double _angle)
+{
+  const int angle = (int)lround(_angle);
+  return angle == -180 ? 180 : angle;
+}
+
+
+
+
+void targetTrackerReset(TargetTracker* _tracker)
+{
+  if (_tracker == NULL)
+    return;
+
+  _tracker->m_locked = false;
+  _tracker->m_angle  = 0.0;
+  _tracker->m_rate   = 0.0;
+  _tracker->m_misses = 0;
+}
+
+void targetTrackerConfigure(TargetTracker* _tracker, unsigned int _gain, unsigned int _minConfidence)
+{
+  if (_tracker == NULL)
+    return;
+
+  if (_gain > TARGET_TRACKER_GAIN_MAX)
+    _gain = TARGET_TRACKER_GAIN_MAX;
+
+  if (_gain == _tracker->m_gain && _minConfidence == _tracker->m_minConfidence)
+    return;
+
+  _tracker->m_gain          = _gain;
+  _tracker->m_minConfidence = _minConfidence;
+  _tracker->m_alpha         = _gain / 100.0;
+  _tracker->m_beta          = _tracker->m_alpha * _tracker->m_alpha / (2.0 - _tracker->m_alpha);
+
+  targetTrackerReset(_tracker);
+}
+
+bool targetTrackerPredict(const TargetTracker* _tracker, double* _angle)
+{
+  if (_tracker == NULL || _angle == NULL || _tracker->m_gain == 0 || !_tracker->m_locked)
+    return false;
+
+  *_angle = do_wrapAngle(_tracker->m_angle + _tracker->m_rate);
+  return true;
+}
+
+int targetTrackerUpdate(TargetTracker* _tracker, int _angle, unsigned int _confidence)
+{
+  if (_tracker == NULL || _tracker->m_gain == 0)
+    return _angle;
+
+  if (_confidence < _tracker->m_minConfidence)
+  {
+    if (!_tracker->m_locked)
+      return _angle;
+
+    // measurement is not trusted, keep moving along last known rate for a while
+    if (++_tracker->m_misses > TARGET_TRACKER_COAST_FRAMES)
+    {
+      targetTrackerReset(_tracker);
+      return _angle;
+    }
+
+    _tracker->m_angle = do_wrapAngle(_tracker->m_angle + _tracker->m_rate);
+    return do_reportAngle(_tracker->m_angle);
+  }
+
+  if (!_tracker->m_locked)
+  {
+    _tracker->m_locked = true;
+    _tracker->m_angle  = _angle;
+    _tracker->m_rate   = 0.0;
+    _tracker->m_misses = 0;
+    return _angle;
+  }
+
+  const double predicted = _tracker->m_angle + _tracker->m_rate;
+  const double residual  = do_wrapAngle(_angle - predicted);
+
+  _tracker->m_angle  = do_wrapAngle(predicted + _tracker->m_alpha * residual);
+  _tracker->m_rate   = do_clampRate(_tracker->m_rate + _tracker->m_beta * residual);
+  _tracker->m_misses = 0;
+
+  return do_reportAngle(_tracker->m_angle);
+}
@@ -0,0 +1,264 @@
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <alloca.h>
+#include <sched.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "internal/thread_attr.h"
+
+
+static int do_policy(ThreadPolicy _policy)
+{
+  switch (_policy)
+  {
+    case THREAD_POLICY_FIFO:	return SCHED_FIFO;
+    case THREAD_POLICY_RR:	return SCHED_RR;
+    default:			return SCHED_OTHER;
+  }
+}
+
+static const char* do_policyName(int _policy)
+{
+  switch (_policy)
+  {
+    case SCHED_FIFO:	return "fifo";
+    case SCHED_RR:	return "rr";
+    case SCHED_OTHER:	return "other";
+    default:		return "unknown";
+  }
+}
+
+static int do_attrSetup(pthread_attr_t* _attr, const ThreadAttrConfig* _config, bool _sched)
+{
+  int res;
+
+  if ((res = pthread_attr_init(_attr)) != 0)
+  {
+    fprintf(stderr, "pthread_attr_init() failed: %d\n", res);
+    return res;
+  }
+
+  if (_config->m_stackSize != 0 && (res = pthread_attr_setstacksize(_attr, _config->m_stackSize)) != 0)
+  {
+    fprintf(stderr, "pthread_attr_setstacksize(%zu) failed: %d\n", _config->m_stackSize, res);
+    goto exit_destroy;
+  }
+
+  if (_config->m_cpuMask != 0)
+  {
+    size_t cpu;
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (cpu = 0; cpu < 32; ++cpu)
+      if (_config->m_cpuMask & (1u << cpu))
+        CPU_SET(cpu, &cpus);
+
+    if ((res = pthread_attr_setaffinity_np(_attr, sizeof(cpus), &cpus)) != 0)
+    {
+      fprintf(stderr, "pthread_attr_setaffinity_np(0x%x) failed: %d\n", _config->m_cpuMask, res);
+      goto exit_destroy;
+    }
+  }
+
+  if (_sched && _config->m_policy != THREAD_POLICY_DEFAULT)
+  {
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = _config->m_policy == THREAD_POLICY_OTHER ? 0 : _config->m_priority;
+
+    if (   (res = pthread_attr_setinheritsched(_attr, PTHREAD_EXPLICIT_SCHED)) != 0
+        || (res = pthread_attr_setschedpolicy(_attr, do_policy(_config->m_policy))) != 0
+        || (res = pthread_attr_setschedparam(_attr, &param)) != 0)
+    {
+      fprintf(stderr, "pthread_attr_setsched(%s:%d) failed: %d\n",
+              do_policyName(do_policy(_config->m_policy)), param.sched_priority, res);
+      goto exit_destroy;
+    }
+  }
+
+  return 0;
+
+
+ exit_destroy:
+  pthread_attr_destroy(_attr);
+  return res;
+}
+
+// Settings are read back from the thread itself, not from what was requested
+static void do_report(pthread_t _thread, const char* _name)
+{
+  int policy;
+  struct sched_param param;
+  cpu_set_t cpus;
+  pthread_attr_t attr;
+  size_t stackSize = 0;
+  uint32_t cpuMask = 0;
+  size_t cpu;
+
+  if (pthread_getschedparam(_thread, &policy, &param) != 0)
+    return;
+
+  if (pthread_getaffinity_np(_thread, sizeof(cpus), &cpus) == 0)
+    for (cpu = 0; cpu < 32; ++cpu)
+      if (CPU_ISSET(cpu, &cpus))
+        cpuMask |= 1u << cpu;
+
+  if (pthread_getattr_np(_thread, &attr) == 0)
+  {
+    pthread_attr_getstacksize(&attr, &stackSize);
+    pthread_attr_destroy(&attr);
+  }
+
+  printf("Thread %s: policy %s, priority %d, cpus 0x%x, stack %zu KiB\n",
+         _name, do_policyName(policy), param.sched_priority, cpuMask, stackSize / 1024);
+}
+
+
+
+
+int threadAttrCreate(pthread_t* _thread, const char* _name, const ThreadAttrConfig* _config,
+                     void* (*_routine)(void*), void* _arg)
+{
+  int res;
+  pthread_attr_t attr;
+
+  if (_thread == NULL || _name == NULL || _config == NULL || _routine == NULL)
+    return EINVAL;
+
+  if ((res = do_attrSetup(&attr, _config, true)) != 0)
+    return res;
+
+  res = pthread_create(_thread, &attr, _routine, _arg);
+  pthread_attr_destroy(&attr);
+
+  if (res == EPERM && _config->m_policy != THREAD_POLICY_DEFAULT)
+  {
+    fprintf(stderr, "No permission for %s scheduling of %s thread, using default\n",
+            do_policyName(do_policy(_config->m_policy)), _name);
+
+    if ((res = do_attrSetup(&attr, _config, false)) != 0)
+      return res;
+    res = pthread_create(_thread, &attr, _routine, _arg);
+    pthread_attr_destroy(&attr);
+  }
+
+  if (res != 0)
+    return res;
+
+#ifdef HAVE_PTHREAD_SETNAME_NP
+  pthread_setname_np(*_thread, _name);
+#endif
+  do_report(*_thread, _name);
+
+  return 0;
+}
+
+int threadAttrParsePolicy(ThreadAttrConfig* _config, const char* _arg)
+{
+  const char* priority;
+  size_t length;
+
+  if (_config == NULL || _arg == NULL)
+    return EINVAL;
+
+  priority = strchr(_arg, ':');
+  length = priority != NULL ? (size_t)(priority - _arg) : strlen(_arg);
+
+  if      (length == 4 && !strncasecmp(_arg, "fifo", length))	_config->m_policy = THREAD_POLICY_FIFO;
+  else if (length == 2 && !strncasecmp(_arg, "rr", length))	_config->m_policy = THREAD_POLICY_RR;
+  else if (length == 5 && !strncasecmp(_arg, "other", length))	_config->m_policy = THREAD_POLICY_OTHER;
+  else
+    return EINVAL;
+
+  _config->m_priority = 0;
+  if (_config->m_policy == THREAD_POLICY_OTHER)
+    return priority == NULL ? 0 : EINVAL;
+
+  if (priority == NULL)
+    return EINVAL;
+
+  _config->m_priority = atoi(priority + 1);
+  if (   _config->m_priority < sched_get_priority_min(do_policy(_config->m_policy))
+      || _config->m_priority > sched_get_priority_max(do_policy(_config->m_policy)))
+    return ERANGE;
+
+  return 0;
+}
+
+int threadAttrParseCpuList(ThreadAttrConfig* _config, const char* _arg)
+{
+  char* end;
+  uint32_t mask = 0;
+
+  if (_config == NULL || _arg == NULL)
+    return EINVAL;
+
+  while (*_arg != '\0')
+  {
+    unsigned long first = strtoul(_arg, &end, 10);
+    unsigned long last = first;
+    if (end == _arg)
+      return EINVAL;
+
+    if (*end == '-')
+    {
+      _arg = end + 1;
+      last = strtoul(_arg, &end, 10);
+      if (end == _arg || last < first)
+        return EINVAL;
+    }
+
+    if (last >= 32)
+      return ERANGE;
+    for (; first <= last; ++first)
+      mask |= 1u << first;
+
+    if (*end == ',')
+      ++end;
+    else if (*end != '\0')
+      return EINVAL;
+    _arg = end;
+  }
+
+  _config->m_cpuMask = mask;
+
+  return 0;
+}
+
+int threadAttrLockMemory(size_t _prefaultHeap, size_t _prefaultStack)
+{
+  int res;
+
+  // freed memory stays in the process, otherwise it would fault again when reused
+  mallopt(M_TRIM_THRESHOLD, -1);
+  mallopt(M_MMAP_MAX, 0);
+
+  if (mlockall(MCL_CURRENT|MCL_FUTURE) != 0)
+  {
+    res = errno;
+    fprintf(stderr, "mlockall() failed: %d\n", res);
+    return res;
+  }
+
+  char* heap = malloc(_prefaultHeap);
+  if (heap != NULL)
+  {
+    memset(heap, 0, _prefaultHeap);
+    free(heap);
+  }
+
+  // threads get locked stacks through MCL_FUTURE, this one is touched explicitly
+  volatile char* stack = alloca(_prefaultStack);
+  memset((char*)stack, 0, _prefaultStack);
+
+  printf("Memory locked, %zu KiB heap and %zu KiB stack pre-faulted\n",
+         heap != NULL ? _prefaultHeap / 1024 : 0, _prefaultStack / 1024);
+
+  return 0;
+}
+
@@ -7,139 +7,71 @@
 #include <time.h>
 #include <assert.h>
 #include <sys/select.h>
-#include <alsa/asoundlib.h>
+
+#include <linux/videodev2.h>
 
 #include "internal/thread_audio.h"
 #include "internal/runtime.h"
 #include "internal/module_ce.h"
 #include "internal/module_fb.h"
 #include "internal/module_rc.h"
+#include "internal/audio_source.h"
+#include "internal/pcm_ring.h"
+#include "internal/sound_gate.h"
+#include "internal/stats.h"
 
 #define FrameSourceSize		153600
 #define ImageSourceFormat	1448695129
 
-#define NO_ERROR		0
-#define OPEN_ERROR		1
-#define MALLOC_ERROR	2
-#define ANY_ERROR		3
-#define ACCESS_ERROR	4
-#define FORMAT_ERROR	5
-#define RATE_ERROR		6
-#define CHANNELS_ERROR	7
-#define PARAMS_ERROR	8
-#define PREPARE_ERROR	9
-#define FOPEN_ERROR		10
-#define FCLOSE_ERROR	11
-#define SNDREAD_ERROR	12
-#define START_ERROR		13
-
-#define SND_BUF_SIZE	512
-
-static char* snd_device = "default";
-snd_pcm_t* capture_handle;
-snd_pcm_hw_params_t* hw_params;
-snd_pcm_info_t* s_info;
-unsigned int srate = 44100;
-unsigned int nchan = 2;
+// Source frame geometry as seen by codec; matches 320x240 display in video mode
+#define FrameSourceWidth	320
+#define FrameSourceHeight	240
 
 volatile long long proc_frames = 0;
 
-/// Open and init default sound card params
-int init_soundcard()
-{
-	int err = 0;
-
-	if ((err = snd_pcm_open(&capture_handle, snd_device,
-			SND_PCM_STREAM_CAPTURE, 0)) < 0)
-	{
-		fprintf(stderr, "cannot open audio device %s (%s, %d)\n",
-				snd_device, snd_strerror(err), err);
-		return OPEN_ERROR;
-	}
-
-	if ((err = snd_pcm_hw_params_malloc(&hw_params)) < 0)
-	{
-		fprintf(
-				stderr,
-				"cannot allocate hardware parameter structure (%s, %d)\n",
-				snd_strerror(err), err);
-		return MALLOC_ERROR;
-	}
-
-	if ((err = snd_pcm_hw_params_any(capture_handle, hw_params)) < 0)
-	{
-		fprintf(
-				stderr,
-				"cannot initialize hardware parameter structure (%s, %d)\n",
-				snd_strerror(err), err);
-		return ANY_ERROR;
-	}
-
-	if ((err = snd_pcm_hw_params_set_access(capture_handle, hw_params,
-			SND_PCM_ACCESS_RW_INTERLEAVED)) < 0)
-	{
-		fprintf(stderr, "cannot set access type (%s, %d)\n",
-				snd_strerror(err), err);
-		return ACCESS_ERROR;
-	}
+// Command submitted along with frame being processed by DSP, and time that frame was captured
+static TargetDetectCommand s_pendingCommand = { 0 };
+static uint64_t s_pendingTimestampNs = 0;
 
-	if ((err = snd_pcm_hw_params_set_format(capture_handle, hw_params,
-			SND_PCM_FORMAT_S16_LE)) < 0)
-	{
-		fprintf(stderr, "cannot set sample format (%s, %d)\n",
-				snd_strerror(err), err);
-		return FORMAT_ERROR;
-	}
+// Time spent blocked on capture during current frame, the rest of capture is copying
+static uint64_t s_captureWaitNs = 0;
 
-	if ((err = snd_pcm_hw_params_set_rate_near(capture_handle, hw_params,
-			&srate, 0)) < 0)
-	{
-		fprintf(stderr, "cannot set sample rate (%s, %d)\n",
-				snd_strerror(err), err);
-		return RATE_ERROR;
-	}
+// Energy gate, quiet frames are reported without being submitted to DSP
+static SoundGate s_gate;
 
-	if ((err = snd_pcm_hw_params_set_channels(capture_handle, hw_params, nchan))
-			< 0)
-	{
-		fprintf(stderr, "cannot set channel count (%s, %d)\n",
-				snd_strerror(err), err);
-		return CHANNELS_ERROR;
-	}
+// Sliding window history; every period is stored twice, so the latest window is always contiguous
+typedef struct AudioHistory
+{
+  char*  m_buffer; // 2 x m_size
+  size_t m_size;
+  size_t m_pos;
+  size_t m_filled;
+} AudioHistory;
 
-	if ((err = snd_pcm_hw_params(capture_handle, hw_params)) < 0)
-	{
-		fprintf(stderr, "cannot set parameters (%s, %d)\n",
-				snd_strerror(err), err);
-		return PARAMS_ERROR;
-	}
+static AudioHistory s_history = { NULL, 0, 0, 0 };
 
-	if ((err = snd_pcm_prepare(capture_handle)) < 0)
-	{
-		fprintf(
-				stderr,
-				"cannot prepare audio interface for use (%s, %d)\n",
-				snd_strerror(err), err);
-		return PREPARE_ERROR;
-	}
+static int threadAudioHistoryAlloc(size_t _size)
+{
+  if (s_history.m_buffer != NULL && s_history.m_size == _size)
+    return 0;
 
-	// Start reading data from sound card
-	if ((err = snd_pcm_start(capture_handle)) < 0)
-	{
-		fprintf(stderr, "cannot start soundcard (%s, %d)\n", snd_strerror(err),
-				err);
-		return START_ERROR;
-	}
+  free(s_history.m_buffer);
+  memset(&s_history, 0, sizeof(s_history));
 
-	snd_pcm_hw_params_free(hw_params);
+  if ((s_history.m_buffer = malloc(2 * _size)) == NULL)
+  {
+    fprintf(stderr, "malloc(history, %zu) failed\n", 2 * _size);
+    return ENOMEM;
+  }
+  s_history.m_size = _size;
 
-	return NO_ERROR;
+  return 0;
 }
 
-/// Close soundcard
-int close_soundcard()
+static void threadAudioHistoryFree()
 {
-	return snd_pcm_close(capture_handle);
+  free(s_history.m_buffer);
+  memset(&s_history, 0, sizeof(s_history));
 }
 
 // Measure speed in FPS
@@ -154,127 +86,207 @@ int InputReportFPS(long long _ms)
 	return 0;
 }
 
-// Audio thread loop cycle
-static int threadAudioSelectLoop(Runtime* _runtime, CodecEngine* _ce, FBOutput* _fb)
+// Read whole periods either from capture thread ring or right from audio source
+static int threadAudioReadPeriods(Runtime* _runtime, AudioSource* _src, char* _dstPtr, size_t _periods)
 {
-  int res = 0;
-  int err = 0;
+  int res;
+  const CaptureConfig* captureConfig = runtimeCfgCapture(_runtime);
 
-  void* frameDstPtr;
-  size_t frameDstSize;
+  if (!captureConfig->m_threaded)
+  {
+    const uint64_t waitStartNs = statsNowNs();
+    if ((res = audioSourceReadFrames(_src, _dstPtr, _periods * captureConfig->m_periodFrames)) != 0)
+    {
+      if (res != ENODATA)
+        fprintf(stderr, "audioSourceReadFrames(%zu) failed: %d\n", _periods * captureConfig->m_periodFrames, res);
+      return res;
+    }
+    s_captureWaitNs += statsNowNs() - waitStartNs;
+    return 0;
+  }
 
-  const void* frameSrcPtr;
-  size_t frameSrcSize;
+  PCMRing* ring = runtimeModCaptureRing(_runtime);
+  size_t slotSize;
+  if ((res = pcmRingGetSlotSize(ring, &slotSize)) != 0)
+  {
+    fprintf(stderr, "pcmRingGetSlotSize() failed: %d\n", res);
+    return res;
+  }
 
-  TargetDetectParams  targetDetectParams;
-  TargetDetectCommand targetDetectCommand;
-  TargetLocation      targetLocation;
-  TargetDetectParams  targetDetectParamsResult;
+  while (_periods > 0)
+  {
+    const void* slotPtr;
+    const uint64_t waitStartNs = statsNowNs();
+    res = pcmRingPopBegin(ring, &slotPtr, 100);
+    s_captureWaitNs += statsNowNs() - waitStartNs;
+    if (res != 0)
+    {
+      if (res != ETIMEDOUT && res != EAGAIN)
+      {
+        fprintf(stderr, "pcmRingPopBegin() failed: %d\n", res);
+        return res;
+      }
 
-  char buffer1[FrameSourceSize]; // Buffer with sound wave
+      if (runtimeGetTerminate(_runtime))
+        return ECANCELED;
+      continue;
+    }
 
-  //uint32_t ncount = FrameSourceSize / (SND_BUF_SIZE * nchan * 2);
-  // int ncount = 32; // x SND_BUF_SIZE * nchan * 2bytes = 65536 - number of readings data from sound card
+    memcpy(_dstPtr, slotPtr, slotSize);
+    pcmRingPopCommit(ring);
 
-  int n_read_count; // Number of readings data from sound card
+    _dstPtr += slotSize;
+    --_periods;
+  }
 
-  char wav_data[SND_BUF_SIZE * nchan * 2];
+  return 0;
+}
 
-  if (_runtime == NULL || _ce == NULL || _fb == NULL)
-    return EINVAL;
+// Append periods to sliding window history and copy latest window into DSP buffer
+static int threadAudioCaptureSliding(Runtime* _runtime, AudioSource* _src,
+                                     char* _dstPtr, size_t _windowSize, size_t _hopSize, size_t _periodSize)
+{
+  int res;
 
-  if ((res = fbOutputGetFrame(_fb, &frameDstPtr, &frameDstSize)) != 0)
-  {
-    fprintf(stderr, "fbOutputGetFrame() failed: %d\n", res);
-    return res;
-  }
+  // window growth is served by reading more than a hop; history size is the DSP buffer capacity
+  size_t readSize = _hopSize;
+  if (s_history.m_filled + readSize < _windowSize)
+    readSize = _windowSize - s_history.m_filled;
 
-  if ((res = runtimeGetTargetDetectParams(_runtime, &targetDetectParams)) != 0)
+  while (readSize > 0)
   {
-    fprintf(stderr, "runtimeGetTargetDetectParams() failed: %d\n", res);
-    return res;
+    char* periodPtr = s_history.m_buffer + s_history.m_pos;
+    if ((res = threadAudioReadPeriods(_runtime, _src, periodPtr, 1)) != 0)
+      return res;
+
+    memcpy(periodPtr + s_history.m_size, periodPtr, _periodSize);
+    s_history.m_pos = (s_history.m_pos + _periodSize) % s_history.m_size;
+    if (s_history.m_filled < s_history.m_size)
+      s_history.m_filled += _periodSize;
+    readSize -= _periodSize;
   }
 
-  if ((res = runtimeFetchTargetDetectCommand(_runtime, &targetDetectCommand)) != 0)
-  {
-    fprintf(stderr, "runtimeFetchTargetDetectCommand() failed: %d\n", res);
-    return res;
-  }
+  memcpy(_dstPtr, s_history.m_buffer + s_history.m_pos + s_history.m_size - _windowSize, _windowSize);
 
-  if ((res = runtimeGetVideoOutParams(_runtime, &(_ce->m_videoOutEnable))) != 0)
+  return 0;
+}
+
+// Capture next block of samples straight into DSP input buffer
+static int threadAudioCapture(Runtime* _runtime, AudioSource* _src, CodecEngine* _ce,
+                              const TargetDetectParams* _targetDetectParams,
+                              const void** _frameSrcPtr, size_t* _frameSrcSize, size_t* _frameDataSize)
+{
+  int res;
+  void* srcBufferPtr;
+  size_t srcBufferSize;
+  const CaptureConfig* captureConfig = runtimeCfgCapture(_runtime);
+  const size_t frameSize = runtimeCfgAlsaInput(_runtime)->m_channels * sizeof(int16_t);
+  const size_t periodSize = captureConfig->m_periodFrames * frameSize;
+
+  if ((res = codecEngineGetSrcBuffer(_ce, &srcBufferPtr, &srcBufferSize)) != 0)
   {
-    fprintf(stderr, "runtimeGetVideoOutParams() failed: %d\n", res);
+    fprintf(stderr, "codecEngineGetSrcBuffer() failed: %d\n", res);
     return res;
   }
 
-  size_t frameDstUsed = frameDstSize;
-  frameSrcSize = FrameSourceSize;
+  *_frameSrcSize = FrameSourceSize;
+  if (*_frameSrcSize > srcBufferSize)
+    *_frameSrcSize = srcBufferSize;
 
+  // read whole periods only, never more than DSP input buffer holds
+  size_t capturePeriods = _targetDetectParams->m_numSamples / captureConfig->m_periodFrames;
+  if (capturePeriods > *_frameSrcSize / periodSize)
+    capturePeriods = *_frameSrcSize / periodSize;
 
-  if (targetDetectParams.m_numSamples <= FrameSourceSize)
+  const size_t captureSize = capturePeriods * periodSize;
+  const uint64_t captureStartNs = statsNowNs();
+  s_captureWaitNs = 0;
+  if (_targetDetectParams->m_hopSize == 0 || capturePeriods == 0)
   {
-	  //n_read_count = targetDetectParams.m_numSamples / (SND_BUF_SIZE * nchan * 2);
-	  n_read_count = targetDetectParams.m_numSamples / SND_BUF_SIZE;
+    s_history.m_filled = 0;
+    if ((res = threadAudioReadPeriods(_runtime, _src, srcBufferPtr, capturePeriods)) != 0)
+      return res;
   }
   else
   {
-	  //n_read_count = FrameSourceSize / (SND_BUF_SIZE * nchan * 2);
-	  n_read_count = FrameSourceSize / SND_BUF_SIZE;
+    // hop is rounded up to whole periods and never exceeds the window
+    size_t hopPeriods = (_targetDetectParams->m_hopSize + captureConfig->m_periodFrames - 1) / captureConfig->m_periodFrames;
+    if (hopPeriods > capturePeriods)
+      hopPeriods = capturePeriods;
+
+    if ((res = threadAudioHistoryAlloc((*_frameSrcSize / periodSize) * periodSize)) != 0)
+      return res;
+
+    if ((res = threadAudioCaptureSliding(_runtime, _src, srcBufferPtr,
+                                         captureSize, hopPeriods * periodSize, periodSize)) != 0)
+      return res;
   }
 
-  // This is a buffer to send to DSP
-  memset(buffer1, 0, frameSrcSize);
+  LatencyStats* stats = runtimeModStats(_runtime);
+  statsRecord(stats, STATS_STAGE_CAPTURE_WAIT, s_captureWaitNs);
+  statsRecord(stats, STATS_STAGE_PACK, statsNowNs() - captureStartNs - s_captureWaitNs);
 
-  // Reading data
-  for (int i = 0; i < n_read_count; i++)
-	{
-		if ((err = snd_pcm_readi(capture_handle, wav_data, SND_BUF_SIZE)) != SND_BUF_SIZE)
-		{
-			fprintf(stderr, "read from audio interface failed (%s, %d)\n",
-					snd_strerror(err), err);
-			if (err == -32) // Broken pipe
-			{
-				if ((err = snd_pcm_prepare(capture_handle)) < 0)
-				{
-					fprintf(stderr,	"cannot prepare audio interface for use (%s, %d)\n",
-							snd_strerror(err), err);
-					return PREPARE_ERROR;
-				}
-			}
-			else
-			{
-				return SNDREAD_ERROR;
-			}
+  *_frameSrcPtr = srcBufferPtr;
+  *_frameDataSize = captureSize;
 
-		}
-		for (uint32_t j = 0; j < (SND_BUF_SIZE * nchan * 2); j++)
-		{
-			buffer1[i * SND_BUF_SIZE * nchan * 2 + j] = wav_data[j];
-		}
-	}
+  return 0;
+}
 
-  frameSrcPtr = buffer1;
+// Formats used without framebuffer; codec is asked for 1x1 output so dst buffer stays minimal
+static void threadAudioHeadlessFormat(ImageDescription* _srcImageDesc, ImageDescription* _dstImageDesc)
+{
+  _dstImageDesc->m_width      = 1;
+  _dstImageDesc->m_height     = 1;
+  _dstImageDesc->m_lineLength = 2;
+  _dstImageDesc->m_imageSize  = 2;
+  _dstImageDesc->m_format     = V4L2_PIX_FMT_RGB565X;
+
+  _srcImageDesc->m_width      = FrameSourceWidth;
+  _srcImageDesc->m_height     = FrameSourceHeight;
+  _srcImageDesc->m_lineLength = FrameSourceSize / FrameSourceHeight;
+}
+
+// Fetch results of frame processed by DSP and report them
+static int threadAudioCompleteFrame(Runtime* _runtime, CodecEngine* _ce, FBOutput* _fb)
+{
+  int res = 0;
+
+  void* frameDstPtr = NULL;
+  size_t frameDstSize = 0;
+  size_t frameDstUsed;
 
-  if ((res = codecEngineTranscodeFrame(_ce,
-                                       frameSrcPtr, frameSrcSize,
-                                       frameDstPtr, frameDstSize, &frameDstUsed,
-                                       &targetDetectParams,
-                                       &targetDetectCommand,
-                                       &targetLocation,
-                                       &targetDetectParamsResult)) != 0)
+  TargetLocation      targetLocation;
+  TargetDetectParams  targetDetectParamsResult;
+
+  if (_fb != NULL && (res = fbOutputGetFrame(_fb, &frameDstPtr, &frameDstSize)) != 0)
   {
-    fprintf(stderr, "codecEngineTranscodeFrame(%p[%zu] -> %p[%zu]) failed: %d\n",
-            frameSrcPtr, frameSrcSize, frameDstPtr, frameDstSize, res);
+    fprintf(stderr, "fbOutputGetFrame() failed: %d\n", res);
     return res;
   }
 
-  if ((res = fbOutputPutFrame(_fb)) != 0)
+  frameDstUsed = frameDstSize;
+
+  if ((res = codecEngineCompleteFrame(_ce,
+                                      frameDstPtr, frameDstSize, &frameDstUsed,
+                                      &targetLocation,
+                                      &targetDetectParamsResult)) != 0)
+  {
+    fprintf(stderr, "codecEngineCompleteFrame(-> %p[%zu]) failed: %d\n",
+            frameDstPtr, frameDstSize, res);
+    return res;
+  }
+
+  if (_fb != NULL && (res = fbOutputPutFrame(_fb)) != 0)
   {
     fprintf(stderr, "fbOutputPutFrame() failed: %d\n", res);
     return res;
   }
 
-  switch (targetDetectCommand.m_cmd)
+  targetLocation.m_timestampNs = s_pendingTimestampNs;
+  targetLocation.m_gated = false;
+
+  const uint64_t reportStartNs = statsNowNs();
+  switch (s_pendingCommand.m_cmd)
   {
     case 1:
       if ((res = runtimeReportTargetDetectParams(_runtime, &targetDetectParamsResult)) != 0)
@@ -293,12 +305,154 @@ static int threadAudioSelectLoop(Runtime* _runtime, CodecEngine* _ce, FBOutput*
       }
       break;
   }
+  statsRecord(runtimeModStats(_runtime), STATS_STAGE_REPORT, statsNowNs() - reportStartNs);
+
+  proc_frames ++;
+
+  return 0;
+}
+
+// Report frame rejected by energy gate; volumes follow codec scaling, but are RMS rather than mean absolute
+static int threadAudioReportGated(Runtime* _runtime, const SoundGateLevels* _levels,
+                                  const TargetDetectParams* _targetDetectParams, uint64_t _timestampNs)
+{
+  int res;
+  TargetLocation targetLocation;
+  size_t ch;
+
+  memset(&targetLocation, 0, sizeof(targetLocation));
+  targetLocation.m_channels = _levels->m_channels < TARGET_CHANNELS_MAX ? _levels->m_channels : TARGET_CHANNELS_MAX;
+  for (ch = 0; ch < targetLocation.m_channels; ++ch)
+  {
+    targetLocation.m_channelVolume[ch] = _levels->m_rms[ch];
+    if (_targetDetectParams->m_volumeCoefficient != 0)
+      targetLocation.m_channelVolume[ch] = (targetLocation.m_channelVolume[ch] * _targetDetectParams->m_volumeCoefficient) / 100;
+  }
+  if (targetLocation.m_channels == 1)
+    targetLocation.m_channelVolume[1] = targetLocation.m_channelVolume[0];
+
+  targetLocation.m_targetLeftVolume  = targetLocation.m_channelVolume[0];
+  targetLocation.m_targetRightVolume = targetLocation.m_channelVolume[1];
+  targetLocation.m_timestampNs       = _timestampNs;
+  targetLocation.m_gated             = true;
+
+  const uint64_t reportStartNs = statsNowNs();
+  if ((res = runtimeReportTargetLocation(_runtime, &targetLocation)) != 0)
+  {
+    fprintf(stderr, "runtimeReportTargetLocation() failed: %d\n", res);
+    return res;
+  }
+  statsRecord(runtimeModStats(_runtime), STATS_STAGE_REPORT, statsNowNs() - reportStartNs);
 
   proc_frames ++;
 
   return 0;
 }
 
+// Audio thread loop cycle
+static int threadAudioSelectLoop(Runtime* _runtime, CodecEngine* _ce, FBOutput* _fb, AudioSource* _src)
+{
+  int res = 0;
+
+  void* frameDstPtr;
+  size_t frameDstSize;
+
+  const void* frameSrcPtr;
+  size_t frameSrcSize;
+  size_t frameDataSize;
+
+  RuntimeSnapshot     snapshot;
+  TargetDetectParams  targetDetectParams;
+  TargetDetectCommand targetDetectCommand;
+
+  if (_runtime == NULL || _ce == NULL)
+    return EINVAL;
+
+  const uint64_t frameStartNs = statsNowNs();
+
+  // headless: nothing is rendered, only target location is produced
+  if (_fb == NULL)
+  {
+    frameDstPtr = NULL;
+    frameDstSize = 0;
+  }
+  else if ((res = fbOutputGetFrame(_fb, &frameDstPtr, &frameDstSize)) != 0)
+  {
+    fprintf(stderr, "fbOutputGetFrame() failed: %d\n", res);
+    return res;
+  }
+
+  if ((res = runtimeGetSnapshot(_runtime, &snapshot)) != 0)
+  {
+    fprintf(stderr, "runtimeGetSnapshot() failed: %d\n", res);
+    return res;
+  }
+  targetDetectParams = snapshot.m_targetDetectParams;
+
+  if ((res = runtimeFetchTargetDetectCommand(_runtime, &targetDetectCommand)) != 0)
+  {
+    fprintf(stderr, "runtimeFetchTargetDetectCommand() failed: %d\n", res);
+    return res;
+  }
+
+  _ce->m_videoOutEnable = _fb != NULL && snapshot.m_videoOutEnable;
+
+  // with async codec engine this captures next frame while DSP still processes previous one
+  if ((res = threadAudioCapture(_runtime, _src, _ce, &targetDetectParams,
+                                &frameSrcPtr, &frameSrcSize, &frameDataSize)) != 0)
+    return res == ECANCELED ? 0 : res; // ENODATA is passed up, replayed file is over
+
+  struct timespec captureTime;
+  clock_gettime(CLOCK_MONOTONIC, &captureTime);
+
+  // parameter requests always go to codec, only plain localization frames may be gated
+  const size_t channels = runtimeCfgAlsaInput(_runtime)->m_channels;
+  SoundGateLevels levels;
+  soundGateConfigure(&s_gate, targetDetectParams.m_gateThreshold, targetDetectParams.m_gateHysteresis);
+  const bool localize = soundGateUpdate(&s_gate, frameSrcPtr, frameDataSize / (channels * sizeof(int16_t)), channels, &levels)
+                     || targetDetectCommand.m_cmd != 0;
+
+  if (codecEngineFramePending(_ce) && (res = threadAudioCompleteFrame(_runtime, _ce, _fb)) != 0)
+    return res;
+
+  if (!localize)
+  {
+    if ((res = codecEngineDiscardSrcBuffer(_ce, frameDataSize)) != 0)
+    {
+      fprintf(stderr, "codecEngineDiscardSrcBuffer() failed: %d\n", res);
+      return res;
+    }
+
+    if ((res = threadAudioReportGated(_runtime, &levels, &targetDetectParams,
+                                      (uint64_t)captureTime.tv_sec * 1000000000ull + captureTime.tv_nsec)) != 0)
+      return res;
+
+    statsRecord(runtimeModStats(_runtime), STATS_STAGE_FRAME, statsNowNs() - frameStartNs);
+    return 0;
+  }
+
+  if ((res = codecEngineSubmitFrame(_ce,
+                                    frameSrcPtr, frameSrcSize, frameDataSize,
+                                    frameDstSize,
+                                    &targetDetectParams,
+                                    &targetDetectCommand)) != 0)
+  {
+    fprintf(stderr, "codecEngineSubmitFrame(%p[%zu] -> [%zu]) failed: %d\n",
+            frameSrcPtr, frameSrcSize, frameDstSize, res);
+    return res;
+  }
+  s_pendingCommand = targetDetectCommand;
+  s_pendingTimestampNs = (uint64_t)captureTime.tv_sec * 1000000000ull + captureTime.tv_nsec;
+
+  // single src buffer is busy until frame is completed, next capture could not get it
+  if (!codecEngineIsAsync(_ce) && (res = threadAudioCompleteFrame(_runtime, _ce, _fb)) != 0)
+    return res;
+
+  statsRecord(runtimeModStats(_runtime), STATS_STAGE_FRAME, statsNowNs() - frameStartNs);
+
+  return 0;
+}
+
 // Audio thread
 void* threadAudio(void* _arg)
 {
@@ -306,12 +460,14 @@ void* threadAudio(void* _arg)
 	Runtime* runtime = (Runtime*)_arg;
 	CodecEngine* ce;
 	FBOutput* fb;
+	AudioSource* src;
 	int res = 0;
 
 	struct timespec last_fps_report_time;
 
 	ImageDescription srcImageDesc;
 	ImageDescription dstImageDesc;
+	AudioDescription srcAudioDesc;
 
 	if (runtime == NULL)
 	{
@@ -320,12 +476,18 @@ void* threadAudio(void* _arg)
 	}
 
 	if ((ce   = runtimeModCodecEngine(runtime)) == NULL
-			|| (fb   = runtimeModFBOutput(runtime))    == NULL)
+			|| (fb   = runtimeModFBOutput(runtime))    == NULL
+			|| (src  = runtimeModAudioSource(runtime)) == NULL)
 	{
 		exit_code = EINVAL;
 		goto exit;
 	}
 
+	if (runtimeCfgHeadless(runtime))
+		fb = NULL;
+
+	ce->m_stats = runtimeModStats(runtime);
+
 	if ((res = codecEngineOpen(ce, runtimeCfgCodecEngine(runtime))) != 0)
 	{
 		fprintf(stderr, "codecEngineOpen() failed: %d\n", res);
@@ -333,32 +495,40 @@ void* threadAudio(void* _arg)
 		goto exit;
 	}
 
-	if ((res = fbOutputOpen(fb, runtimeCfgFBOutput(runtime))) != 0)
+	if (fb != NULL && (res = fbOutputOpen(fb, runtimeCfgFBOutput(runtime))) != 0)
 	{
 		fprintf(stderr, "fbOutputOpen() failed: %d\n", res);
 		exit_code = res;
 		goto exit_ce_close;
 	}
 
-	if ((res = fbOutputGetFormat(fb, &dstImageDesc)) != 0)
+	if (fb == NULL)
+		threadAudioHeadlessFormat(&srcImageDesc, &dstImageDesc);
+	else if ((res = fbOutputGetFormat(fb, &dstImageDesc)) != 0)
 	{
 		fprintf(stderr, "fbOutputGetFormat() failed: %d\n", res);
 		exit_code = res;
 		goto exit_fb_close;
 	}
+	else
+		memcpy(&srcImageDesc, &dstImageDesc, sizeof(srcImageDesc));
 
-	memcpy(&srcImageDesc, &dstImageDesc, sizeof(srcImageDesc));
 	srcImageDesc.m_format = ImageSourceFormat;
 	srcImageDesc.m_imageSize = FrameSourceSize;
 
-	if ((res = codecEngineStart(ce, runtimeCfgCodecEngine(runtime), &srcImageDesc, &dstImageDesc)) != 0)
+	srcAudioDesc.m_rate = runtimeCfgAlsaInput(runtime)->m_rate;
+	srcAudioDesc.m_channels = runtimeCfgAlsaInput(runtime)->m_channels;
+
+	if ((res = codecEngineStart(ce, runtimeCfgCodecEngine(runtime), &srcImageDesc, &dstImageDesc, &srcAudioDesc)) != 0)
 	{
 		fprintf(stderr, "codecEngineStart() failed: %d\n", res);
 		exit_code = res;
 		goto exit_fb_close;
 	}
+	s_pendingCommand.m_cmd = 0;
+	soundGateReset(&s_gate);
 
-	if ((res = fbOutputStart(fb)) != 0)
+	if (fb != NULL && (res = fbOutputStart(fb)) != 0)
 	{
 		fprintf(stderr, "fbOutputStart() failed: %d\n", res);
 		exit_code = res;
@@ -372,8 +542,23 @@ void* threadAudio(void* _arg)
 		goto exit_fb_stop;
 	}
 
-	printf("Open default soundcard\n");
-	init_soundcard();
+	// with dedicated capture thread audio source belongs to it
+	if (runtimeCfgCapture(runtime)->m_threaded)
+		src = NULL;
+
+	if (src != NULL && (res = audioSourceOpen(src, runtimeCfgAudioSource(runtime), runtimeCfgAlsaInput(runtime))) != 0)
+	{
+		fprintf(stderr, "audioSourceOpen() failed: %d\n", res);
+		exit_code = res;
+		goto exit_fb_stop;
+	}
+
+	if (src != NULL && (res = audioSourceStart(src)) != 0)
+	{
+		fprintf(stderr, "audioSourceStart() failed: %d\n", res);
+		exit_code = res;
+		goto exit_source_close;
+	}
 
 	printf("Entering audio thread loop\n");
 	while (!runtimeGetTerminate(runtime))
@@ -385,7 +570,7 @@ void* threadAudio(void* _arg)
 		{
 			fprintf(stderr, "clock_gettime(CLOCK_MONOTONIC) failed: %d\n", errno);
 			exit_code = res;
-			goto exit_fb_stop;
+			goto exit_source_stop;
 		}
 
 		last_fps_report_elapsed_ms = (now.tv_sec  - last_fps_report_time.tv_sec )*1000
@@ -401,19 +586,43 @@ void* threadAudio(void* _arg)
 			if ((res = InputReportFPS(last_fps_report_elapsed_ms)) != 0)
 				fprintf(stderr, "InputReportFPS() failed: %d\n", res);
 
+			if (src == NULL && (res = pcmRingReportStats(runtimeModCaptureRing(runtime))) != 0)
+				fprintf(stderr, "pcmRingReportStats() failed: %d\n", res);
+
+			if ((res = resultQueueReportStats(runtimeModResultQueue(runtime))) != 0)
+				fprintf(stderr, "resultQueueReportStats() failed: %d\n", res);
+
+			if ((res = soundGateReport(&s_gate)) != 0)
+				fprintf(stderr, "soundGateReport() failed: %d\n", res);
 		}
 
-		if ((res = threadAudioSelectLoop(runtime, ce, fb)) != 0)
+		if ((res = threadAudioSelectLoop(runtime, ce, fb, src)) != 0)
 		{
+			if (res == ENODATA)
+			{
+				printf("Audio file is over\n");
+				break;
+			}
+
 			fprintf(stderr, "threadAudioSelectLoop() failed: %d\n", res);
 			exit_code = res;
-			goto exit_fb_stop;
+			goto exit_source_stop;
 		}
 	}
 	printf("Left audio thread loop\n");
 
+	exit_source_stop:
+	if (src != NULL && (res = audioSourceStop(src)) != 0)
+		fprintf(stderr, "audioSourceStop() failed: %d\n", res);
+
+	exit_source_close:
+	if (src != NULL && (res = audioSourceClose(src)) != 0)
+		fprintf(stderr, "audioSourceClose() failed: %d\n", res);
+
 	exit_fb_stop:
-	if ((res = fbOutputStop(fb)) != 0)
+	threadAudioHistoryFree();
+
+	if (fb != NULL && (res = fbOutputStop(fb)) != 0)
 		fprintf(stderr, "fbOutputStop() failed: %d\n", res);
 
 	exit_ce_stop:
@@ -421,7 +630,7 @@ void* threadAudio(void* _arg)
 		fprintf(stderr, "codecEngineStop() failed: %d\n", res);
 
 	exit_fb_close:
-	if ((res = fbOutputClose(fb)) != 0)
+	if (fb != NULL && (res = fbOutputClose(fb)) != 0)
 		fprintf(stderr, "fbOutputClose() failed: %d\n", res);
 
 	exit_ce_close:
@@ -431,9 +640,6 @@ void* threadAudio(void* _arg)
 	exit:
 	runtimeSetTerminate(runtime);
 
-	printf("Close default soundcard\n");
-	close_soundcard();
-
 	return (void*)exit_code;
 }
 
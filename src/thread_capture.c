@@ -0,0 +1,153 @@
+#include "config.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <assert.h>
+
+#include "internal/thread_capture.h"
+#include "internal/runtime.h"
+#include "internal/audio_source.h"
+#include "internal/pcm_ring.h"
+
+// Read one period from audio source into the ring; never waits for the consumer
+static int threadCaptureReadLoop(Runtime* _runtime, AudioSource* _src, PCMRing* _ring, void* _discardPtr)
+{
+  int res;
+  void* slotPtr;
+  size_t frameSize;
+  size_t slotSize;
+  bool overrun = false;
+
+  if (_runtime == NULL || _src == NULL || _ring == NULL || _discardPtr == NULL)
+    return EINVAL;
+
+  if ((res = audioSourceGetFrameSize(_src, &frameSize)) != 0)
+  {
+    fprintf(stderr, "audioSourceGetFrameSize() failed: %d\n", res);
+    return res;
+  }
+
+  if ((res = pcmRingGetSlotSize(_ring, &slotSize)) != 0)
+  {
+    fprintf(stderr, "pcmRingGetSlotSize() failed: %d\n", res);
+    return res;
+  }
+
+  if ((res = pcmRingPushBegin(_ring, &slotPtr)) != 0)
+  {
+    if (res != ENOSPC)
+    {
+      fprintf(stderr, "pcmRingPushBegin() failed: %d\n", res);
+      return res;
+    }
+
+    // consumer is late - keep draining source anyway, period is lost
+    slotPtr = _discardPtr;
+    overrun = true;
+  }
+
+  if ((res = audioSourceReadFrames(_src, slotPtr, slotSize / frameSize)) != 0)
+  {
+    if (res != ENODATA)
+      fprintf(stderr, "audioSourceReadFrames() failed: %d\n", res);
+    return res;
+  }
+
+  if (overrun)
+    return pcmRingPushOverrun(_ring);
+
+  if ((res = pcmRingPushCommit(_ring)) != 0)
+  {
+    fprintf(stderr, "pcmRingPushCommit() failed: %d\n", res);
+    return res;
+  }
+
+  return 0;
+}
+
+void* threadCapture(void* _arg)
+{
+  int res = 0;
+  intptr_t exit_code = 0;
+  Runtime* runtime = (Runtime*)_arg;
+  AudioSource* src;
+  PCMRing* ring;
+  size_t slotSize;
+  void* discardPtr = NULL;
+
+  if (runtime == NULL)
+  {
+    exit_code = EINVAL;
+    goto exit;
+  }
+
+  if (   (src = runtimeModAudioSource(runtime)) == NULL
+      || (ring = runtimeModCaptureRing(runtime)) == NULL)
+  {
+    exit_code = EINVAL;
+    goto exit;
+  }
+
+  if ((res = pcmRingGetSlotSize(ring, &slotSize)) != 0)
+  {
+    fprintf(stderr, "pcmRingGetSlotSize() failed: %d\n", res);
+    exit_code = res;
+    goto exit;
+  }
+
+  if ((discardPtr = malloc(slotSize)) == NULL)
+  {
+    exit_code = ENOMEM;
+    goto exit;
+  }
+
+  if ((res = audioSourceOpen(src, runtimeCfgAudioSource(runtime), runtimeCfgAlsaInput(runtime))) != 0)
+  {
+    fprintf(stderr, "audioSourceOpen() failed: %d\n", res);
+    exit_code = res;
+    goto exit_free;
+  }
+
+  if ((res = audioSourceStart(src)) != 0)
+  {
+    fprintf(stderr, "audioSourceStart() failed: %d\n", res);
+    exit_code = res;
+    goto exit_source_close;
+  }
+
+  printf("Entering capture thread loop\n");
+  while (!runtimeGetTerminate(runtime))
+  {
+    if ((res = threadCaptureReadLoop(runtime, src, ring, discardPtr)) != 0)
+    {
+      if (res == ENODATA)
+      {
+        printf("Audio file is over\n");
+        break;
+      }
+
+      fprintf(stderr, "threadCaptureReadLoop() failed: %d\n", res);
+      exit_code = res;
+      goto exit_source_stop;
+    }
+  }
+  printf("Left capture thread loop\n");
+
+ exit_source_stop:
+  if ((res = audioSourceStop(src)) != 0)
+    fprintf(stderr, "audioSourceStop() failed: %d\n", res);
+
+ exit_source_close:
+  if ((res = audioSourceClose(src)) != 0)
+    fprintf(stderr, "audioSourceClose() failed: %d\n", res);
+
+ exit_free:
+  free(discardPtr);
+
+ exit:
+  runtimeSetTerminate(runtime);
+  return (void*)exit_code;
+}
+
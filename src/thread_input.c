@@ -6,48 +6,26 @@
 #include <errno.h>
 #include <time.h>
 #include <assert.h>
-#include <sys/select.h>
 
 #include "internal/thread_input.h"
 #include "internal/runtime.h"
 #include "internal/module_rc.h"
+#include "internal/module_rc_server.h"
 
-static int threadInputSelectLoop(Runtime* _runtime, RCInput* _rc)
+static int threadInputPollLoop(Runtime* _runtime, RCInput* _rc, RCServer* _server)
 {
   int res;
-  int maxFd = 0;
-  fd_set fdsIn;
-  static const struct timespec s_selectTimeout = { .tv_sec=1, .tv_nsec=0 };
 
-  if (_runtime == NULL || _rc == NULL)
+  if (_runtime == NULL || _rc == NULL || _server == NULL)
     return EINVAL;
 
-  FD_ZERO(&fdsIn);
-
-  if (_rc->m_fifoInputFd != -1)
-  {
-    FD_SET(_rc->m_fifoInputFd, &fdsIn);
-    if (maxFd < _rc->m_fifoInputFd)
-      maxFd = _rc->m_fifoInputFd;
-  }
-
-  if ((res = pselect(maxFd+1, &fdsIn, NULL, NULL, &s_selectTimeout, NULL)) < 0)
+  // no timeout, runtimeSetTerminate() wakes us up
+  if ((res = rcServerPoll(_server, _rc, -1)) != 0)
   {
-    res = errno;
-    fprintf(stderr, "pselect() failed: %d\n", res);
+    fprintf(stderr, "rcServerPoll() failed: %d\n", res);
     return res;
   }
 
-
-  if (_rc->m_fifoInputFd != -1 && FD_ISSET(_rc->m_fifoInputFd, &fdsIn))
-  {
-    if ((res = rcInputReadFifoInput(_rc)) != 0)
-    {
-      fprintf(stderr, "rcInputReadFifoInput() failed: %d\n", res);
-      return res;
-    }
-  }
-
   TargetDetectParams targetDetectParams;
   if ((res = rcInputGetTargetDetectParams(_rc, &targetDetectParams)) != 0)
   {
@@ -102,6 +80,15 @@ static int threadInputSelectLoop(Runtime* _runtime, RCInput* _rc)
     }
   }
 
+  // fifo has no reply channel, so stats go to log
+  if ((res = rcInputGetStatsRequest(_rc)) == 0)
+    statsReport(runtimeModStats(_runtime));
+  else if (res != ENODATA)
+  {
+    fprintf(stderr, "rcInputGetStatsRequest() failed: %d\n", res);
+    return res;
+  }
+
   return 0;
 }
 
@@ -111,6 +98,7 @@ void* threadInput(void* _arg)
   intptr_t exit_code = 0;
   Runtime* runtime = (Runtime*)_arg;
   RCInput* rc;
+  RCServer* server;
 
   if (runtime == NULL)
   {
@@ -118,7 +106,8 @@ void* threadInput(void* _arg)
     goto exit;
   }
 
-  if ((rc = runtimeModRCInput(runtime)) == NULL)
+  if (   (rc     = runtimeModRCInput(runtime))  == NULL
+      || (server = runtimeModRCServer(runtime)) == NULL)
   {
     exit_code = EINVAL;
     goto exit;
@@ -141,9 +130,9 @@ void* threadInput(void* _arg)
   printf("Entering input thread loop\n");
   while (!runtimeGetTerminate(runtime))
   {
-    if ((res = threadInputSelectLoop(runtime, rc)) != 0)
+    if ((res = threadInputPollLoop(runtime, rc, server)) != 0)
     {
-      fprintf(stderr, "threadInputSelectLoop() failed: %d\n", res);
+      fprintf(stderr, "threadInputPollLoop() failed: %d\n", res);
       exit_code = res;
       goto exit_rc_stop;
     }
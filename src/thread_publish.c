@@ -0,0 +1,119 @@
+#include "config.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#include "internal/thread_publish.h"
+#include "internal/runtime.h"
+#include "internal/module_rc.h"
+#include "internal/module_rc_server.h"
+#include "internal/result_queue.h"
+
+// Producer never signals, so this bounds delivery latency of a result reported into empty queue
+static const long s_publishWaitMs = 5;
+
+// Write out everything queued so far, in batches
+static int threadPublishDrain(RCInput* _rc, RCServer* _server, ResultQueue* _queue, bool* _drained)
+{
+  int res;
+  ResultRecord batch[RC_OUTPUT_BATCH_MAX];
+  size_t batchSize;
+
+  *_drained = false;
+  do
+  {
+    batchSize = 0;
+    while (batchSize < RC_OUTPUT_BATCH_MAX && (res = resultQueuePop(_queue, &batch[batchSize])) == 0)
+      ++batchSize;
+
+    if (batchSize == RC_OUTPUT_BATCH_MAX)
+      res = 0;
+    else if (res != ENODATA)
+    {
+      fprintf(stderr, "resultQueuePop() failed: %d\n", res);
+      return res;
+    }
+
+    if (batchSize > 0)
+    {
+      *_drained = true;
+      if ((res = rcInputUnsafeReportResults(_rc, batch, batchSize)) != 0)
+      {
+        fprintf(stderr, "rcInputUnsafeReportResults() failed: %d\n", res);
+        return res;
+      }
+
+      if ((res = rcServerReportResults(_server, batch, batchSize)) != 0)
+      {
+        fprintf(stderr, "rcServerReportResults() failed: %d\n", res);
+        return res;
+      }
+    }
+  } while (batchSize == RC_OUTPUT_BATCH_MAX);
+
+  return 0;
+}
+
+void* threadPublish(void* _arg)
+{
+  int res = 0;
+  intptr_t exit_code = 0;
+  Runtime* runtime = (Runtime*)_arg;
+  RCInput* rc;
+  RCServer* server;
+  ResultQueue* queue;
+  bool drained;
+
+  if (runtime == NULL)
+  {
+    exit_code = EINVAL;
+    goto exit;
+  }
+
+  if (   (rc     = runtimeModRCInput(runtime))     == NULL
+      || (server = runtimeModRCServer(runtime))    == NULL
+      || (queue  = runtimeModResultQueue(runtime)) == NULL)
+  {
+    exit_code = EINVAL;
+    goto exit;
+  }
+
+  // opened here rather than with input side, so no other thread ever sees the fd change
+  if ((res = rcInputOpenOutput(rc, runtimeCfgRCInput(runtime))) != 0)
+  {
+    fprintf(stderr, "rcInputOpenOutput() failed: %d\n", res);
+    exit_code = res;
+    goto exit;
+  }
+
+  printf("Entering publish thread loop\n");
+  while (!runtimeGetTerminate(runtime))
+  {
+    if ((res = threadPublishDrain(rc, server, queue, &drained)) != 0)
+    {
+      fprintf(stderr, "threadPublishDrain() failed: %d\n", res);
+      exit_code = res;
+      goto exit_rc_close_output;
+    }
+
+    // runtimeSetTerminate() cuts the wait short
+    if (!drained && (res = resultQueueWait(queue, s_publishWaitMs)) != 0)
+    {
+      fprintf(stderr, "resultQueueWait() failed: %d\n", res);
+      exit_code = res;
+      goto exit_rc_close_output;
+    }
+  }
+  printf("Left publish thread loop\n");
+
+ exit_rc_close_output:
+  if ((res = rcInputCloseOutput(rc)) != 0)
+    fprintf(stderr, "rcInputCloseOutput() failed: %d\n", res);
+
+ exit:
+  runtimeSetTerminate(runtime);
+  return (void*)exit_code;
+}
+
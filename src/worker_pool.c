@@ -0,0 +1,253 @@
+#include "config.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "internal/worker_pool.h"
+
+
+static WorkerPoolQueue do_queue(uint32_t _next, uint32_t _end)
+{
+  return ((WorkerPoolQueue)_end << 32) | _next;
+}
+
+static bool do_popTask(WorkerPoolQueue* _queue, size_t* _task)
+{
+  WorkerPoolQueue queue = __atomic_load_n(_queue, __ATOMIC_ACQUIRE);
+
+  while (true)
+  {
+    const uint32_t next = (uint32_t)queue;
+    const uint32_t end  = (uint32_t)(queue >> 32);
+    if (next >= end)
+      return false;
+
+    if (__atomic_compare_exchange_n(_queue, &queue, do_queue(next + 1, end), true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+      *_task = next;
+      return true;
+    }
+  }
+}
+
+// Takes back half of victim's queue, single remaining task included
+static bool do_stealTasks(WorkerPoolQueue* _victim, uint32_t* _first, uint32_t* _end)
+{
+  WorkerPoolQueue queue = __atomic_load_n(_victim, __ATOMIC_ACQUIRE);
+
+  while (true)
+  {
+    const uint32_t next = (uint32_t)queue;
+    const uint32_t end  = (uint32_t)(queue >> 32);
+    if (next >= end)
+      return false;
+
+    const uint32_t middle = next + (end - next) / 2;
+    if (__atomic_compare_exchange_n(_victim, &queue, do_queue(next, middle), true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+      *_first = middle;
+      *_end   = end;
+      return true;
+    }
+  }
+}
+
+static void do_runTasks(WorkerPool* _pool, size_t _worker)
+{
+  WorkerPoolQueue* own = &_pool->m_threads[_worker].m_queue;
+  size_t task;
+
+  while (true)
+  {
+    while (do_popTask(own, &task))
+      _pool->m_task(_pool->m_ctx, task, _worker);
+
+    // tasks are never added during run, so all queues found empty means nothing is left to take
+    size_t idx;
+    uint32_t first = 0, end = 0;
+    for (idx = 1; idx < _pool->m_size; ++idx)
+      if (do_stealTasks(&_pool->m_threads[(_worker + idx) % _pool->m_size].m_queue, &first, &end))
+        break;
+    if (idx == _pool->m_size)
+      break;
+
+    __atomic_fetch_add(&_pool->m_steals, 1, __ATOMIC_RELAXED);
+
+    // own queue is empty, so thieves only see the stolen range after this store
+    __atomic_store_n(own, do_queue(first + 1, end), __ATOMIC_RELEASE);
+    _pool->m_task(_pool->m_ctx, first, _worker);
+  }
+}
+
+static void* do_workerThread(void* _arg)
+{
+  WorkerPoolThread* thread = (WorkerPoolThread*)_arg;
+  WorkerPool* pool = thread->m_pool;
+  unsigned int generation = 0;
+
+  while (true)
+  {
+    pthread_mutex_lock(&pool->m_mutex);
+    while (!pool->m_terminate && pool->m_generation == generation)
+      pthread_cond_wait(&pool->m_startCond, &pool->m_mutex);
+    if (pool->m_terminate)
+    {
+      pthread_mutex_unlock(&pool->m_mutex);
+      break;
+    }
+    generation = pool->m_generation;
+    pthread_mutex_unlock(&pool->m_mutex);
+
+    do_runTasks(pool, thread->m_index);
+
+    pthread_mutex_lock(&pool->m_mutex);
+    if (--pool->m_running == 0)
+      pthread_cond_signal(&pool->m_doneCond);
+    pthread_mutex_unlock(&pool->m_mutex);
+  }
+
+  return NULL;
+}
+
+static void do_terminate(WorkerPool* _pool, size_t _threads)
+{
+  size_t idx;
+
+  pthread_mutex_lock(&_pool->m_mutex);
+  _pool->m_terminate = true;
+  pthread_cond_broadcast(&_pool->m_startCond);
+  pthread_mutex_unlock(&_pool->m_mutex);
+
+  for (idx = 1; idx < _threads; ++idx)
+    pthread_join(_pool->m_threads[idx].m_thread, NULL);
+
+  pthread_cond_destroy(&_pool->m_doneCond);
+  pthread_cond_destroy(&_pool->m_startCond);
+  pthread_mutex_destroy(&_pool->m_mutex);
+}
+
+
+
+
+int workerPoolOpen(WorkerPool* _pool, size_t _size, const ThreadAttrConfig* _threadAttr)
+{
+  int res;
+  size_t idx;
+  char name[16];
+
+  if (_pool == NULL || _size == 0 || _size > WORKER_POOL_SIZE_MAX)
+    return EINVAL;
+  if (_pool->m_size != 0)
+    return EALREADY;
+
+  memset(_pool, 0, sizeof(*_pool));
+  pthread_mutex_init(&_pool->m_mutex, NULL);
+  pthread_cond_init(&_pool->m_startCond, NULL);
+  pthread_cond_init(&_pool->m_doneCond, NULL);
+
+  for (idx = 1; idx < _size; ++idx)
+  {
+    _pool->m_threads[idx].m_pool  = _pool;
+    _pool->m_threads[idx].m_index = idx;
+    snprintf(name, sizeof(name), "worker%zu", idx);
+    if (_threadAttr != NULL)
+      res = threadAttrCreate(&_pool->m_threads[idx].m_thread, name, _threadAttr, &do_workerThread, &_pool->m_threads[idx]);
+    else
+      res = pthread_create(&_pool->m_threads[idx].m_thread, NULL, &do_workerThread, &_pool->m_threads[idx]);
+    if (res != 0)
+    {
+      fprintf(stderr, "pthread_create(worker %zu) failed: %d\n", idx, res);
+      do_terminate(_pool, idx);
+      return res;
+    }
+  }
+
+  _pool->m_size = _size;
+
+  return 0;
+}
+
+int workerPoolClose(WorkerPool* _pool)
+{
+  if (_pool == NULL)
+    return EINVAL;
+  if (_pool->m_size == 0)
+    return EALREADY;
+
+  do_terminate(_pool, _pool->m_size);
+  _pool->m_size = 0;
+
+  return 0;
+}
+
+int workerPoolRun(WorkerPool* _pool, size_t _taskCount, WorkerPoolTask _task, void* _ctx)
+{
+  size_t idx;
+
+  if (_pool == NULL || _task == NULL || _taskCount > UINT32_MAX)
+    return EINVAL;
+  if (_pool->m_size == 0)
+    return ENOTCONN;
+
+  _pool->m_task      = _task;
+  _pool->m_ctx       = _ctx;
+  _pool->m_taskCount = _taskCount;
+
+  // single task or no helpers, waking threads would only add latency
+  if (_pool->m_size == 1 || _taskCount <= 1)
+  {
+    _pool->m_threads[0].m_queue = do_queue(0, _taskCount);
+    for (idx = 1; idx < _pool->m_size; ++idx)
+      _pool->m_threads[idx].m_queue = do_queue(0, 0);
+
+    do_runTasks(_pool, 0);
+    return 0;
+  }
+
+  // neighbouring tasks tend to share data, so initial shares are contiguous
+  for (idx = 0; idx < _pool->m_size; ++idx)
+    _pool->m_threads[idx].m_queue = do_queue(_taskCount * idx / _pool->m_size, _taskCount * (idx + 1) / _pool->m_size);
+
+  pthread_mutex_lock(&_pool->m_mutex);
+  _pool->m_running = _pool->m_size - 1;
+  ++_pool->m_generation;
+  pthread_cond_broadcast(&_pool->m_startCond);
+  pthread_mutex_unlock(&_pool->m_mutex);
+
+  do_runTasks(_pool, 0);
+
+  pthread_mutex_lock(&_pool->m_mutex);
+  while (_pool->m_running > 0)
+    pthread_cond_wait(&_pool->m_doneCond, &_pool->m_mutex);
+  pthread_mutex_unlock(&_pool->m_mutex);
+
+  return 0;
+}
+
+size_t workerPoolSize(const WorkerPool* _pool)
+{
+  if (_pool == NULL)
+    return 0;
+
+  return _pool->m_size;
+}
+
+unsigned long workerPoolTakeSteals(WorkerPool* _pool)
+{
+  if (_pool == NULL)
+    return 0;
+
+  return __atomic_exchange_n(&_pool->m_steals, 0, __ATOMIC_RELAXED);
+}
+
+size_t workerPoolOnlineCPUs()
+{
+  const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if (cpus < 1)
+    return 1;
+  if (cpus > WORKER_POOL_SIZE_MAX)
+    return WORKER_POOL_SIZE_MAX;
+
+  return cpus;
+}
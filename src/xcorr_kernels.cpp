@@ -0,0 +1,238 @@
+#include "config.h"
+#include <stdio.h>
+#include <math.h>
+#include <errno.h>
+
+// Same test sound_kernels.c picks vector implementation by
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define XCORR_KERNELS_NEON 1
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#define XCORR_KERNELS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#include "internal/sound_kernels.h"
+#include "internal/xcorr_kernels.h"
+
+
+namespace {
+
+void do_correlateGeneric(const int16_t* _first, const int16_t* _second, size_t _window, size_t _maxLag,
+                         size_t _lagBegin, size_t _lagEnd, double* _xcorr)
+{
+  const size_t count = _window - 2*_maxLag;
+  const int16_t* first = _first + _maxLag;
+  size_t lag;
+
+  for (lag = _lagBegin; lag < _lagEnd; ++lag)
+    _xcorr[lag] += soundKernelDotS16(first, _second + lag, count);
+}
+
+/*
+ * Dot products of _first with _second shifted by 0..3 samples over Count samples.
+ * Every load of first channel serves whole lag block; Count is a multiple of 8.
+ */
+#if defined(XCORR_KERNELS_NEON)
+
+template <size_t Count>
+inline void do_dotLagBlock(const int16_t* _first, const int16_t* _second, int64_t* _sums)
+{
+  int64x2_t acc[XCORR_KERNEL_LAG_BLOCK];
+  size_t idx, lag;
+
+  for (lag = 0; lag < XCORR_KERNEL_LAG_BLOCK; ++lag)
+    acc[lag] = vdupq_n_s64(0);
+
+  for (idx = 0; idx < Count; idx += 8)
+  {
+    const int16x8_t a = vld1q_s16(_first + idx);
+    for (lag = 0; lag < XCORR_KERNEL_LAG_BLOCK; ++lag)
+    {
+      const int16x8_t b = vld1q_s16(_second + idx + lag);
+      acc[lag] = vpadalq_s32(acc[lag], vmull_s16(vget_low_s16(a),  vget_low_s16(b)));
+      acc[lag] = vpadalq_s32(acc[lag], vmull_s16(vget_high_s16(a), vget_high_s16(b)));
+    }
+  }
+
+  for (lag = 0; lag < XCORR_KERNEL_LAG_BLOCK; ++lag)
+    _sums[lag] = vgetq_lane_s64(acc[lag], 0) + vgetq_lane_s64(acc[lag], 1);
+}
+
+#elif defined(XCORR_KERNELS_SSE2)
+
+template <size_t Count>
+inline void do_dotLagBlock(const int16_t* _first, const int16_t* _second, int64_t* _sums)
+{
+  __m128i acc[XCORR_KERNEL_LAG_BLOCK];
+  const __m128i wrapped = _mm_set1_epi32(INT32_MIN);
+  size_t idx, lag;
+
+  for (lag = 0; lag < XCORR_KERNEL_LAG_BLOCK; ++lag)
+    acc[lag] = _mm_setzero_si128();
+
+  for (idx = 0; idx < Count; idx += 8)
+  {
+    const __m128i a = _mm_loadu_si128((const __m128i*)(_first + idx));
+    for (lag = 0; lag < XCORR_KERNEL_LAG_BLOCK; ++lag)
+    {
+      const __m128i b    = _mm_loadu_si128((const __m128i*)(_second + idx + lag));
+      const __m128i prod = _mm_madd_epi16(a, b);
+      // only two -32768*-32768 products reach INT32_MIN, real pair sum is +2^31 then
+      const __m128i sign = _mm_andnot_si128(_mm_cmpeq_epi32(prod, wrapped), _mm_srai_epi32(prod, 31));
+      acc[lag] = _mm_add_epi64(acc[lag], _mm_unpacklo_epi32(prod, sign));
+      acc[lag] = _mm_add_epi64(acc[lag], _mm_unpackhi_epi32(prod, sign));
+    }
+  }
+
+  for (lag = 0; lag < XCORR_KERNEL_LAG_BLOCK; ++lag)
+  {
+    int64_t lanes[2];
+    _mm_storeu_si128((__m128i*)lanes, acc[lag]);
+    _sums[lag] = lanes[0] + lanes[1];
+  }
+}
+
+#else
+
+template <size_t Count>
+inline void do_dotLagBlock(const int16_t* _first, const int16_t* _second, int64_t* _sums)
+{
+  int64_t sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+  size_t idx;
+
+  for (idx = 0; idx < Count; ++idx)
+  {
+    const int32_t sample = _first[idx];
+    sum0 += sample * _second[idx];
+    sum1 += sample * _second[idx + 1];
+    sum2 += sample * _second[idx + 2];
+    sum3 += sample * _second[idx + 3];
+  }
+
+  _sums[0] = sum0;
+  _sums[1] = sum1;
+  _sums[2] = sum2;
+  _sums[3] = sum3;
+}
+
+#endif
+
+/*
+ * Window size and upper bound of pair lag are compile-time constants, so the bulk of every
+ * lag block, Window - 2*MaxLag samples, has a fixed trip count the compiler unrolls. Pairs
+ * narrower than MaxLag correlate longer windows; their few extra samples and lags outside
+ * whole blocks go through generic dot product. Integer sums are exact, so results match
+ * generic loop bit for bit.
+ */
+template <size_t Window, size_t MaxLag>
+void do_correlateFixed(const int16_t* _first, const int16_t* _second, size_t /*_window*/, size_t _maxLag,
+                       size_t _lagBegin, size_t _lagEnd, double* _xcorr)
+{
+  static_assert(Window > 2*MaxLag && (Window - 2*MaxLag) % 8 == 0, "bulk must be whole vectors");
+  const size_t bulk  = Window - 2*MaxLag;
+  const size_t count = Window - 2*_maxLag;
+  const int16_t* first = _first + _maxLag;
+  size_t lag = _lagBegin;
+  size_t idx;
+
+  for (; lag + XCORR_KERNEL_LAG_BLOCK <= _lagEnd; lag += XCORR_KERNEL_LAG_BLOCK)
+  {
+    int64_t sums[XCORR_KERNEL_LAG_BLOCK];
+    do_dotLagBlock<bulk>(first, _second + lag, sums);
+
+    for (idx = 0; idx < XCORR_KERNEL_LAG_BLOCK; ++idx)
+    {
+      if (count > bulk)
+        sums[idx] += soundKernelDotS16(first + bulk, _second + lag + idx + bulk, count - bulk);
+      _xcorr[lag + idx] += sums[idx];
+    }
+  }
+
+  for (; lag < _lagEnd; ++lag)
+    _xcorr[lag] += soundKernelDotS16(first, _second + lag, count);
+}
+
+struct XCorrSpecialization
+{
+  size_t          m_window;
+  size_t          m_maxLag; // widest pair served
+  XCorrWindowFunc m_correlate;
+  const char*     m_name;
+};
+
+// Window sizes used in deployment; lag bounds cover pairs spaced up to 12, 25 and 50 cm at 44.1 kHz
+const XCorrSpecialization s_specializations[] =
+{
+  {   64, 16, &do_correlateFixed<64,   16>, "xcorr64/16"   },
+  {  128, 16, &do_correlateFixed<128,  16>, "xcorr128/16"  },
+  {  128, 32, &do_correlateFixed<128,  32>, "xcorr128/32"  },
+  {  256, 16, &do_correlateFixed<256,  16>, "xcorr256/16"  },
+  {  256, 32, &do_correlateFixed<256,  32>, "xcorr256/32"  },
+  {  256, 64, &do_correlateFixed<256,  64>, "xcorr256/64"  },
+  {  512, 16, &do_correlateFixed<512,  16>, "xcorr512/16"  },
+  {  512, 32, &do_correlateFixed<512,  32>, "xcorr512/32"  },
+  {  512, 64, &do_correlateFixed<512,  64>, "xcorr512/64"  },
+  { 1024, 16, &do_correlateFixed<1024, 16>, "xcorr1024/16" },
+  { 1024, 32, &do_correlateFixed<1024, 32>, "xcorr1024/32" },
+  { 1024, 64, &do_correlateFixed<1024, 64>, "xcorr1024/64" },
+};
+
+} // namespace
+
+
+
+
+int xcorrKernelGeneric(XCorrKernel* _kernel, size_t _window, size_t _maxLag)
+{
+  if (_kernel == NULL || _window == 0)
+    return EINVAL;
+
+  _kernel->m_window    = _window;
+  _kernel->m_maxLag    = _maxLag;
+  _kernel->m_correlate = &do_correlateGeneric;
+  _kernel->m_name      = "generic";
+
+  return 0;
+}
+
+int xcorrKernelSelect(XCorrKernel* _kernel, size_t _window, size_t _maxLag)
+{
+  int res;
+
+  if ((res = xcorrKernelGeneric(_kernel, _window, _maxLag)) != 0)
+    return res;
+
+  // table is sorted by lag bound within window, tightest bound leaves the shortest runtime tail
+  for (size_t idx = 0; idx < sizeof(s_specializations)/sizeof(*s_specializations); ++idx)
+    if (s_specializations[idx].m_window == _window && s_specializations[idx].m_maxLag >= _maxLag)
+    {
+      _kernel->m_correlate = s_specializations[idx].m_correlate;
+      _kernel->m_name      = s_specializations[idx].m_name;
+      break;
+    }
+
+  return 0;
+}
+
+int xcorrKernelSpecialization(XCorrKernel* _kernel, size_t _index)
+{
+  if (_kernel == NULL)
+    return EINVAL;
+  if (_index >= sizeof(s_specializations)/sizeof(*s_specializations))
+    return ENOENT;
+
+  _kernel->m_window    = s_specializations[_index].m_window;
+  _kernel->m_maxLag    = s_specializations[_index].m_maxLag;
+  _kernel->m_correlate = s_specializations[_index].m_correlate;
+  _kernel->m_name      = s_specializations[_index].m_name;
+
+  return 0;
+}
+
+double xcorrWindowNorm(const int16_t* _first, const int16_t* _second, size_t _window, size_t _maxLag)
+{
+  const size_t count = _window - 2*_maxLag;
+
+  return sqrt((double)soundKernelEnergyS16(_first + _maxLag, count) * (double)soundKernelEnergyS16(_second + _maxLag, count));
+}